@@ -0,0 +1,529 @@
+#include "ascii_parser.h"
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <igl/parallel_for.h>
+
+
+namespace
+{
+	static const size_t CHUNK_SIZE = 1 << 20;	// bytes of text parsed per task
+	static const size_t LINES_PER_TASK = 4096;
+	static const size_t HEAD_SIZE = 512;	// bytes read to tell ASCII files from binary ones
+	static const std::uintmax_t STL_BINARY_HEADER_SIZE = 84;	// 80-byte header and the number of triangles
+	static const std::uintmax_t STL_BINARY_TRIANGLE_SIZE = 50;
+
+
+	bool ReadFile(const std::filesystem::path& path, std::string& text)
+	{
+		std::ifstream in(path, std::ios::binary | std::ios::ate);
+		if (!in)
+		{
+			return false;
+		}
+		text.resize(static_cast<size_t>(in.tellg()));
+		in.seekg(0);
+		in.read(&text[0], static_cast<std::streamsize>(text.size()));
+		return static_cast<bool>(in);
+	}
+
+
+	/**
+	 * @brief Read the beginning of a file
+	 * @param path path to the file
+	 * @param head [o] up to HEAD_SIZE bytes from the beginning
+	 * @param size [o] size of the whole file
+	 * @return true if read, false otherwise
+	 */
+	bool ReadHead(const std::filesystem::path& path, std::string& head, std::uintmax_t& size)
+	{
+		std::ifstream in(path, std::ios::binary | std::ios::ate);
+		if (!in)
+		{
+			return false;
+		}
+		size = static_cast<std::uintmax_t>(in.tellg());
+		head.resize(static_cast<size_t>(std::min<std::uintmax_t>(size, HEAD_SIZE)));
+		in.seekg(0);
+		in.read(&head[0], static_cast<std::streamsize>(head.size()));
+		return static_cast<bool>(in);
+	}
+
+
+	/**
+	 * @brief Tell an ASCII PLY from the beginning of the file: "ply", then "format ascii" after any comments
+	 */
+	bool IsAsciiPlyHead(const std::string& head)
+	{
+		std::istringstream ss(head);
+		std::string line;
+		if (!std::getline(ss, line) || line.compare(0, 3, "ply") != 0)
+		{
+			return false;
+		}
+		while (std::getline(ss, line) && !ss.eof())
+		{
+			std::istringstream words(line);
+			std::string keyword;
+			words >> keyword;
+			if (keyword == "comment" || keyword == "obj_info")
+			{
+				continue;
+			}
+			std::string format;
+			words >> format;
+			return keyword == "format" && format == "ascii";
+		}
+		return false;
+	}
+
+
+	/**
+	 * @brief Tell an ASCII STL from the beginning of the file and its size
+	 *        binary STL may also start with "solid", but then its size follows from the number of triangles after the 80-byte header.
+	 */
+	bool IsAsciiStlHead(const std::string& head, std::uintmax_t size)
+	{
+		if (head.compare(0, 5, "solid") != 0)
+		{
+			return false;
+		}
+		if (size >= STL_BINARY_HEADER_SIZE)
+		{
+			std::uint32_t num_triangles = 0;
+			std::memcpy(&num_triangles, head.data() + 80, sizeof(num_triangles));	// little endian, as written by every exporter
+			if (size == STL_BINARY_HEADER_SIZE + STL_BINARY_TRIANGLE_SIZE * num_triangles)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+
+	inline bool IsSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+
+
+	/**
+	 * @brief Cursor over one line of text
+	 */
+	struct Tokenizer
+	{
+		const char* p;
+		const char* end;
+
+		void SkipSpaces()
+		{
+			while (p < end && IsSpace(*p))
+			{
+				++p;
+			}
+		}
+
+		template <typename T>
+		bool Get(T& value)
+		{
+			SkipSpaces();
+			if (p < end && *p == '+')
+			{
+				++p;
+			}
+			auto result = std::from_chars(p, end, value);
+			if (result.ec != std::errc())
+			{
+				return false;
+			}
+			p = result.ptr;
+			return true;
+		}
+
+		bool Skip()
+		{
+			SkipSpaces();
+			const auto begin = p;
+			while (p < end && !IsSpace(*p))
+			{
+				++p;
+			}
+			return p != begin;
+		}
+
+		bool StartsWith(const char* word)
+		{
+			SkipSpaces();
+			const auto length = std::strlen(word);
+			if (static_cast<size_t>(end - p) < length || std::memcmp(p, word, length) != 0)
+			{
+				return false;
+			}
+			p += length;
+			return true;
+		}
+	};
+
+
+	/**
+	 * @brief Offsets of the beginning of each line in text[begin..), found in parallel
+	 */
+	std::vector<size_t> FindLines(const std::string& text, size_t begin)
+	{
+		const auto size = text.size() - begin;
+		const auto num_chunks = std::max<size_t>(1, (size + CHUNK_SIZE - 1) / CHUNK_SIZE);
+		std::vector<std::vector<size_t>> chunk_lines(num_chunks);
+		igl::parallel_for(num_chunks, [&](size_t chunk)
+			{
+				const auto first = begin + chunk * CHUNK_SIZE;
+				const auto last = std::min(text.size(), first + CHUNK_SIZE);
+				auto& lines = chunk_lines[chunk];
+				for (auto i = first; i < last; ++i)
+				{
+					if (text[i] == '\n' && i + 1 < text.size())
+					{
+						lines.push_back(i + 1);
+					}
+				}
+			}, 1);
+
+		std::vector<size_t> lines{ begin };
+		for (const auto& chunk : chunk_lines)
+		{
+			lines.insert(lines.end(), chunk.begin(), chunk.end());
+		}
+		return lines;
+	}
+
+
+	/**
+	 * @brief Property of a PLY element
+	 */
+	struct PlyProperty
+	{
+		std::string name;
+		bool is_list = false;
+	};
+
+
+	/**
+	 * @brief Element of a PLY header
+	 */
+	struct PlyElement
+	{
+		std::string name;
+		size_t count = 0;
+		std::vector<PlyProperty> properties;
+	};
+
+
+	/**
+	 * @brief Parse a PLY header
+	 * @param text [i] file content
+	 * @param elements [o] elements in order
+	 * @param body [o] offset of the first line after end_header
+	 * @return true if the file is an ASCII PLY, false otherwise
+	 */
+	bool ParsePlyHeader(const std::string& text, std::vector<PlyElement>& elements, size_t& body)
+	{
+		const auto header_end = text.find("end_header");
+		if (text.compare(0, 3, "ply") != 0 || header_end == std::string::npos)
+		{
+			return false;
+		}
+		body = text.find('\n', header_end);
+		if (body == std::string::npos)
+		{
+			return false;
+		}
+		++body;
+
+		std::istringstream header(text.substr(0, header_end));
+		header.imbue(std::locale::classic());
+		std::string line;
+		auto is_ascii = false;
+		while (std::getline(header, line))
+		{
+			std::istringstream ss(line);
+			std::string keyword;
+			ss >> keyword;
+			if (keyword == "format")
+			{
+				std::string format;
+				ss >> format;
+				is_ascii = format == "ascii";
+			}
+			else if (keyword == "element")
+			{
+				PlyElement element;
+				ss >> element.name >> element.count;
+				elements.push_back(element);
+			}
+			else if (keyword == "property" && !elements.empty())
+			{
+				PlyProperty property;
+				std::string type;
+				ss >> type;
+				if (type == "list")
+				{
+					std::string count_type, value_type;
+					ss >> count_type >> value_type;
+					property.is_list = true;
+				}
+				ss >> property.name;
+				elements.back().properties.push_back(property);
+			}
+		}
+		return is_ascii;
+	}
+
+
+	/**
+	 * @brief Parse the lines of the vertex element
+	 */
+	bool ParsePlyVertices(const std::string& text, const std::vector<size_t>& lines, size_t first_line, const PlyElement& element, VectorArray& V)
+	{
+		int columns[3] = { -1, -1, -1 };
+		for (size_t j = 0; j < element.properties.size(); ++j)
+		{
+			const auto& property = element.properties[j];
+			if (property.is_list)
+			{
+				return false;
+			}
+			if (property.name.size() == 1 && property.name[0] >= 'x' && property.name[0] <= 'z')
+			{
+				columns[property.name[0] - 'x'] = static_cast<int>(j);
+			}
+		}
+		if (columns[0] < 0 || columns[1] < 0 || columns[2] < 0)
+		{
+			return false;
+		}
+
+		const auto num_properties = static_cast<int>(element.properties.size());
+		V.resize(static_cast<Eigen::Index>(element.count), 3);
+		std::atomic<bool> is_valid(true);
+		igl::parallel_for(element.count, [&](size_t i)
+			{
+				const auto line = first_line + i;
+				Tokenizer tokenizer{ text.data() + lines[line], text.data() + (line + 1 < lines.size() ? lines[line + 1] : text.size()) };
+				double xyz[3];
+				for (int j = 0; j < num_properties; ++j)
+				{
+					double value;
+					if (!tokenizer.Get(value))
+					{
+						is_valid = false;
+						return;
+					}
+					for (int k = 0; k < 3; ++k)
+					{
+						if (columns[k] == j)
+						{
+							xyz[k] = value;
+						}
+					}
+				}
+				V.row(i) << xyz[0], xyz[1], xyz[2];
+			}, LINES_PER_TASK);
+		return is_valid;
+	}
+
+
+	/**
+	 * @brief Parse the lines of the face element, triangles only
+	 */
+	bool ParsePlyFaces(const std::string& text, const std::vector<size_t>& lines, size_t first_line, const PlyElement& element, Eigen::Index num_vertices, IndicesArray& F)
+	{
+		auto indices_property = std::find_if(element.properties.begin(), element.properties.end(), [](const PlyProperty& property)
+			{
+				return property.is_list && (property.name == "vertex_indices" || property.name == "vertex_index");
+			});
+		if (indices_property == element.properties.end())
+		{
+			return false;
+		}
+
+		F.resize(static_cast<Eigen::Index>(element.count), 3);
+		std::atomic<bool> is_valid(true);
+		igl::parallel_for(element.count, [&](size_t i)
+			{
+				const auto line = first_line + i;
+				Tokenizer tokenizer{ text.data() + lines[line], text.data() + (line + 1 < lines.size() ? lines[line + 1] : text.size()) };
+				for (const auto& property : element.properties)
+				{
+					if (!property.is_list)
+					{
+						tokenizer.Skip();
+						continue;
+					}
+					int count = 0;
+					if (!tokenizer.Get(count))
+					{
+						is_valid = false;
+						return;
+					}
+					if (&property != &*indices_property)
+					{
+						for (int k = 0; k < count; ++k)
+						{
+							tokenizer.Skip();
+						}
+						continue;
+					}
+					if (count != 3)
+					{
+						is_valid = false;
+						return;
+					}
+					for (int k = 0; k < 3; ++k)
+					{
+						int index = -1;
+						if (!tokenizer.Get(index) || index < 0 || index >= num_vertices)
+						{
+							is_valid = false;
+							return;
+						}
+						F(i, k) = index;
+					}
+				}
+			}, LINES_PER_TASK);
+		return is_valid;
+	}
+}
+
+
+bool LoadAsciiPly(const std::filesystem::path& path, VectorArray& V, IndicesArray& F)
+{
+	// binary files are told from the header, before the whole file is read
+	std::string text;
+	std::uintmax_t size = 0;
+	if (!ReadHead(path, text, size) || !IsAsciiPlyHead(text))
+	{
+		return false;
+	}
+
+	std::vector<PlyElement> elements;
+	size_t body = 0;
+	if (!ReadFile(path, text) || !ParsePlyHeader(text, elements, body))
+	{
+		return false;
+	}
+
+	// one element per line in ASCII PLY
+	const auto lines = FindLines(text, body);
+	size_t first_line = 0;
+	auto has_vertices = false;
+	auto has_faces = false;
+	for (const auto& element : elements)
+	{
+		if (first_line + element.count > lines.size())
+		{
+			return false;
+		}
+		if (element.name == "vertex")
+		{
+			if (!ParsePlyVertices(text, lines, first_line, element, V))
+			{
+				return false;
+			}
+			has_vertices = true;
+		}
+		else if (element.name == "face")
+		{
+			if (!has_vertices || !ParsePlyFaces(text, lines, first_line, element, V.rows(), F))
+			{
+				return false;
+			}
+			has_faces = true;
+		}
+		first_line += element.count;
+	}
+	return has_vertices && has_faces;
+}
+
+
+bool LoadAsciiStl(const std::filesystem::path& path, VectorArray& V, IndicesArray& F)
+{
+	// binary files are told from the header and the size, before the whole file is read
+	std::string text;
+	std::uintmax_t size = 0;
+	if (!ReadHead(path, text, size) || !IsAsciiStlHead(text, size) || !ReadFile(path, text))
+	{
+		return false;
+	}
+
+	// chunks are cut at line boundaries and keep the vertices in file order
+	const auto num_chunks = std::max<size_t>(1, (text.size() + CHUNK_SIZE - 1) / CHUNK_SIZE);
+	std::vector<std::vector<double>> chunk_vertices(num_chunks);
+	std::atomic<bool> is_valid(true);
+	igl::parallel_for(num_chunks, [&](size_t chunk)
+		{
+			auto begin = chunk * CHUNK_SIZE;
+			if (begin > 0)
+			{
+				begin = text.find('\n', begin - 1);
+				begin = begin == std::string::npos ? text.size() : begin + 1;
+			}
+			auto end = std::min(text.size(), (chunk + 1) * CHUNK_SIZE);
+			end = text.find('\n', end - 1);
+			end = end == std::string::npos ? text.size() : end + 1;
+
+			auto& vertices = chunk_vertices[chunk];
+			auto line = begin;
+			while (line < end)
+			{
+				auto line_end = text.find('\n', line);
+				line_end = line_end == std::string::npos || line_end > end ? end : line_end;
+				Tokenizer tokenizer{ text.data() + line, text.data() + line_end };
+				if (tokenizer.StartsWith("vertex"))
+				{
+					double xyz[3];
+					if (!tokenizer.Get(xyz[0]) || !tokenizer.Get(xyz[1]) || !tokenizer.Get(xyz[2]))
+					{
+						is_valid = false;
+						return;
+					}
+					vertices.insert(vertices.end(), xyz, xyz + 3);
+				}
+				line = line_end + 1;
+			}
+		}, 1);
+	if (!is_valid)
+	{
+		return false;
+	}
+
+	size_t num_values = 0;
+	for (const auto& vertices : chunk_vertices)
+	{
+		num_values += vertices.size();
+	}
+	if (num_values == 0 || num_values % 9 != 0)
+	{
+		return false;
+	}
+
+	const auto num_vertices = static_cast<Eigen::Index>(num_values / 3);
+	V.resize(num_vertices, 3);
+	Eigen::Index row = 0;
+	for (const auto& vertices : chunk_vertices)
+	{
+		const auto n = static_cast<Eigen::Index>(vertices.size() / 3);
+		V.middleRows(row, n) = Eigen::Map<const PackedVectorArray>(vertices.data(), n, 3);
+		row += n;
+	}
+	F.resize(num_vertices / 3, 3);
+	for (Eigen::Index f = 0; f < F.rows(); ++f)
+	{
+		F.row(f) << 3 * f, 3 * f + 1, 3 * f + 2;
+	}
+	return true;
+}
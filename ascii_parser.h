@@ -0,0 +1,27 @@
+#pragma once
+#include <filesystem>
+#include "type.h"
+
+
+/**
+ * @brief Load an ASCII PLY file with a chunked parallel parser
+ *        the body is split at line boundaries and parsed with std::from_chars, independent of the locale.
+ *        only triangle meshes are handled; binary files, polygons and other layouts return false so that the caller can fall back to igl::readPLY.
+ * @param path path to the model file
+ * @param V [o] vertices
+ * @param F [o] faces
+ * @return true if the model is loaded, false otherwise
+ */
+bool LoadAsciiPly(const std::filesystem::path& path, VectorArray& V, IndicesArray& F);
+
+
+/**
+ * @brief Load an ASCII STL file with a chunked parallel parser
+ *        faces are a triangle soup with three new vertices each, like igl::readSTL, but coordinates are parsed as double.
+ *        binary files return false so that the caller can fall back to igl::readSTL.
+ * @param path path to the model file
+ * @param V [o] vertices
+ * @param F [o] faces
+ * @return true if the model is loaded, false otherwise
+ */
+bool LoadAsciiStl(const std::filesystem::path& path, VectorArray& V, IndicesArray& F);
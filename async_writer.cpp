@@ -0,0 +1,99 @@
+#include "async_writer.h"
+#include <exception>
+#include <iostream>
+
+
+AsyncWriter::AsyncWriter(std::size_t capacity)
+	: capacity_(capacity > 0 ? capacity : 1)
+{
+}
+
+
+AsyncWriter::~AsyncWriter()
+{
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		is_stopping_ = true;
+	}
+	cv_.notify_all();
+	if (thread_.joinable())
+	{
+		thread_.join();
+	}
+}
+
+
+void AsyncWriter::Enqueue(const std::string& name, Job job)
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	if (!thread_.joinable())
+	{
+		thread_ = std::thread(&AsyncWriter::Work, this);
+	}
+	cv_.wait(lock, [this]() { return tasks_.size() < capacity_; });
+	tasks_.push_back(Task{ name, std::move(job) });
+	lock.unlock();
+	cv_.notify_all();
+}
+
+
+bool AsyncWriter::Flush()
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	cv_.wait(lock, [this]() { return tasks_.empty() && !is_busy_; });
+	auto is_succeeded = errors_.empty();
+	errors_.clear();
+	return is_succeeded;
+}
+
+
+std::vector<std::string> AsyncWriter::TakeErrors()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	std::vector<std::string> errors;
+	errors.swap(errors_);
+	return errors;
+}
+
+
+void AsyncWriter::Work()
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	while (true)
+	{
+		// pending jobs are still run when stopping
+		cv_.wait(lock, [this]() { return !tasks_.empty() || is_stopping_; });
+		if (tasks_.empty())
+		{
+			break;
+		}
+
+		auto task = std::move(tasks_.front());
+		tasks_.pop_front();
+		is_busy_ = true;
+		lock.unlock();
+		cv_.notify_all();
+
+		auto is_succeeded = false;
+		try
+		{
+			is_succeeded = task.job();
+		}
+		catch (const std::exception& e)
+		{
+			std::cout << e.what() << "\n";
+		}
+		if (!is_succeeded)
+		{
+			std::cout << "failed to write " << task.name << "\n";
+		}
+
+		lock.lock();
+		is_busy_ = false;
+		if (!is_succeeded)
+		{
+			errors_.push_back(task.name);
+		}
+		cv_.notify_all();
+	}
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+/**
+ * @brief Background writer for outputs and debug dumps
+ *        jobs own (a snapshot of) their data and run serialization and I/O on a single background thread, in order.
+ *        the queue is bounded: Enqueue blocks while it is full, so a slow disk slows producers down instead of growing memory.
+ *        pending jobs are flushed on destruction.
+ */
+class AsyncWriter
+{
+public:
+	using Job = std::function<bool()>;	///< returns false on failure
+
+private:
+	struct Task
+	{
+		std::string name;
+		Job job;
+	};
+
+	mutable std::mutex mutex_;
+	std::condition_variable cv_;
+	std::deque<Task> tasks_;
+	std::size_t capacity_;
+	bool is_busy_ = false;
+	bool is_stopping_ = false;
+	std::vector<std::string> errors_;
+	std::thread thread_;
+
+	void Work();
+
+public:
+	/**
+	 * @brief Constructor, the background thread starts with the first job
+	 * @param capacity maximum number of pending jobs
+	 */
+	explicit AsyncWriter(std::size_t capacity = 16);
+	~AsyncWriter();
+	AsyncWriter(const AsyncWriter&) = delete;
+	AsyncWriter& operator=(const AsyncWriter&) = delete;
+
+	/**
+	 * @brief Queue a job, blocking while the queue is full
+	 * @param name name reported on failure, like the file path
+	 * @param job job to run on the background thread
+	 * @return void
+	 */
+	void Enqueue(const std::string& name, Job job);
+
+	/**
+	 * @brief Wait until all queued jobs are done
+	 * @return true if no job has failed since the last call, false otherwise
+	 */
+	bool Flush();
+
+	/**
+	 * @brief Names of the jobs failed since the last call
+	 * @return names of the failed jobs
+	 */
+	std::vector<std::string> TakeErrors();
+};
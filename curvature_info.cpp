@@ -1,8 +1,197 @@
 #include "curvature_info.h"
-#include <igl/cotmatrix.h>
-#include <igl/gaussian_curvature.h>
-#include <igl/invert_diag.h>
-#include <igl/principal_curvature.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <thread>
+#include <unordered_map>
+#include "discrete_curvature.h"
+#include "geometry_utils.h"
+#include "normal_cycle.h"
+#include "quadric_fitting.h"
+#include "reorder.h"
+#include "shared_memory.h"
+
+
+namespace
+{
+	static const int QUADRIC_FITTING_K_RING = 5;	// same as the default radius of igl::principal_curvature
+	static const int NORMAL_CYCLE_RINGS = 1;	// the tensors of the 1-ring are summed, the halo of the tiles is wide enough
+	const char CURVATURE_FILE_MAGIC[8] = { 'G', 'E', 'C', 'U', 'R', 'V', '\0', '\0' };
+
+
+	/**
+	 * @brief Vertices of a tile with their halo, as a mesh of its own
+	 */
+	struct Tile
+	{
+		std::vector<int> vertices;	// vertex indices in the whole mesh of the local vertices, sorted
+		std::vector<int> core;	// local indices of the vertices of the tile, the others are the halo
+		VectorArray V;
+		IndicesArray F;
+		std::vector<std::vector<int>> adjacency_list;
+	};
+
+
+	/**
+	 * @brief Copy a tile and its halo out of the mesh
+	 *        the halo holds the k-ring of the quadric fitting and one ring more, so that the normals in the k-ring see all their faces.
+	 * @param V vertex array
+	 * @param F face array
+	 * @param adjacency_list adjacency list
+	 * @param vertex_faces faces incident to each vertex
+	 * @param core_vertices vertices of the tile
+	 * @return tile
+	 */
+	Tile BuildTile(
+		const VectorArray& V,
+		const IndicesArray& F,
+		const std::vector<std::vector<int>>& adjacency_list,
+		const std::vector<std::vector<int>>& vertex_faces,
+		const std::vector<int>& core_vertices)
+	{
+		Tile tile;
+		tile.vertices = ExpandRings(adjacency_list, core_vertices, QUADRIC_FITTING_K_RING + 1);
+		std::unordered_map<int, int> local;
+		local.reserve(tile.vertices.size());
+		for (size_t i = 0; i < tile.vertices.size(); ++i)
+		{
+			local.emplace(tile.vertices[i], static_cast<int>(i));
+		}
+
+		tile.V.resize(tile.vertices.size(), 3);
+		for (size_t i = 0; i < tile.vertices.size(); ++i)
+		{
+			tile.V.row(i) = V.row(tile.vertices[i]);
+		}
+
+		// each face is taken once, from its first corner, when all its corners are local
+		std::vector<int> faces;
+		for (auto v : tile.vertices)
+		{
+			for (auto f : vertex_faces[v])
+			{
+				if (F(f, 0) == v && local.count(F(f, 1)) && local.count(F(f, 2)))
+				{
+					faces.push_back(f);
+				}
+			}
+		}
+		tile.F.resize(faces.size(), 3);
+		for (size_t i = 0; i < faces.size(); ++i)
+		{
+			for (Eigen::Index k = 0; k < 3; ++k)
+			{
+				tile.F(i, k) = local[F(faces[i], k)];
+			}
+		}
+
+		// local indices follow the global ones, so the neighbours stay sorted
+		tile.adjacency_list.resize(tile.vertices.size());
+		for (size_t i = 0; i < tile.vertices.size(); ++i)
+		{
+			for (auto neighbor : adjacency_list[tile.vertices[i]])
+			{
+				auto found = local.find(neighbor);
+				if (found != local.end())
+				{
+					tile.adjacency_list[i].push_back(found->second);
+				}
+			}
+		}
+
+		tile.core.reserve(core_vertices.size());
+		for (auto v : core_vertices)
+		{
+			tile.core.push_back(local[v]);
+		}
+		return tile;
+	}
+
+
+	/**
+	 * @brief Calculate curvature tile by tile
+	 * @param V vertex array
+	 * @param F face array
+	 * @param adjacency_list adjacency list
+	 * @param vertex_faces faces incident to each vertex
+	 * @param options tile size and concurrency
+	 * @param write called with each tile and its curvature, from several threads at once for disjoint tiles
+	 * @param deadline deadline checked while computing
+	 * @return false if the deadline is exceeded, true otherwise
+	 */
+	bool ForEachTile(
+		const VectorArray& V,
+		const IndicesArray& F,
+		const std::vector<std::vector<int>>& adjacency_list,
+		const std::vector<std::vector<int>>& vertex_faces,
+		const TiledCurvatureOptions& options,
+		const std::function<void(const Tile&, const CurvatureInfo&)>& write,
+		const Deadline& deadline)
+	{
+		// consecutive vertices along a Morton curve are close in space, so tiles are compact and halos thin
+		const auto order = ComputeVertexOrdering(V, adjacency_list, VertexOrdering::kMorton);
+		const auto tile_vertices = static_cast<size_t>(std::max(options.tile_vertices, 1));
+		const auto num_tiles = (order.size() + tile_vertices - 1) / tile_vertices;
+
+		std::atomic<size_t> next(0);
+		std::atomic<bool> is_exceeded(false);
+		auto work = [&]()
+			{
+				for (auto t = next++; t < num_tiles && !is_exceeded; t = next++)
+				{
+					if (deadline.IsExceeded())
+					{
+						is_exceeded = true;
+						return;
+					}
+					const auto begin = order.begin() + t * tile_vertices;
+					const auto end = order.begin() + std::min(order.size(), (t + 1) * tile_vertices);
+					const auto tile = BuildTile(V, F, adjacency_list, vertex_faces, std::vector<int>(begin, end));
+					CurvatureInfo info;
+					if (!CalcCurvatures(tile.V, tile.F, tile.adjacency_list, options.estimator, info, deadline))
+					{
+						is_exceeded = true;
+						return;
+					}
+					write(tile, info);
+				}
+			};
+
+		std::vector<std::thread> workers;
+		for (int i = 1; i < options.concurrent_tiles && static_cast<size_t>(i) < num_tiles; ++i)
+		{
+			workers.emplace_back(work);
+		}
+		work();
+		for (auto& worker : workers)
+		{
+			worker.join();
+		}
+		return !is_exceeded;
+	}
+
+
+	bool IsInRange(std::uint64_t offset, std::uint64_t length, std::size_t size)
+	{
+		return offset <= size && length <= size - offset;
+	}
+}
+
+
+CurvatureEstimator ToCurvatureEstimator(const std::string& name)
+{
+	if (name.empty() || name == "quadric")
+	{
+		return CurvatureEstimator::kQuadricFitting;
+	}
+	if (name == "normal_cycle")
+	{
+		return CurvatureEstimator::kNormalCycle;
+	}
+	throw std::invalid_argument("unknown curvature estimator: " + name + " (expected: quadric or normal_cycle)");
+}
 
 
 void Initialize(CurvatureInfo& curvature_info)
@@ -16,34 +205,262 @@ void Initialize(CurvatureInfo& curvature_info)
 }
 
 
-void CalcCurvatures(const VectorArray& V, const IndicesArray& F, CurvatureInfo& curvature_info)
+bool CalcCurvatures(
+	const VectorArray& V,
+	const IndicesArray& F,
+	const std::vector<std::vector<int>>& adjacency_list,
+	CurvatureInfo& curvature_info,
+	const Deadline& deadline)
+{
+	return CalcCurvatures(V, F, adjacency_list, CurvatureEstimator::kQuadricFitting, curvature_info, deadline);
+}
+
+
+bool CalcCurvatures(
+	const VectorArray& V,
+	const IndicesArray& F,
+	const std::vector<std::vector<int>>& adjacency_list,
+	CurvatureEstimator estimator,
+	CurvatureInfo& curvature_info,
+	const Deadline& deadline)
 {
-	// Alternative discrete mean curvature
-	VectorArray HN;
-	Eigen::SparseMatrix<VectorArray::value_type> L, M, Minv;
-	igl::cotmatrix(V, F, L);
-	igl::massmatrix(V, F, igl::MASSMATRIX_TYPE_VORONOI, M);
-	igl::invert_diag(M, Minv);
-
-	// Laplace-Beltrami of position
-	HN = -Minv * (L * V);
-
-	// Extract magnitude as mean curvature
-	// Compute curvature directions via quadric fitting
-	igl::principal_curvature(V, F,
-		curvature_info.principal_directions1,
-		curvature_info.principal_directions2,
-		curvature_info.principal_value1,
-		curvature_info.principal_value2);
-	curvature_info.mean = HN.rowwise().norm();
+	// the normal cycles are built from face normals, only the quadric fitting reads the vertex normals
+	if (estimator == CurvatureEstimator::kNormalCycle)
+	{
+		return CalcCurvatures(V, PackedVectorArray(), F, adjacency_list, PackedVectorArray(), estimator, curvature_info, deadline);
+	}
+	PackedVectorArray N;
+	CalcVertexNormals(V, F, N);
+	return CalcCurvatures(V, ToPacked(V), F, adjacency_list, N, estimator, curvature_info, deadline);
+}
+
+
+bool CalcCurvatures(
+	const VectorArray& V,
+	const PackedVectorView& packed_V,
+	const IndicesArray& F,
+	const std::vector<std::vector<int>>& adjacency_list,
+	const PackedVectorArray& N,
+	CurvatureEstimator estimator,
+	CurvatureInfo& curvature_info,
+	const Deadline& deadline)
+{
+	// angle defect in one pass over the faces. the mean curvature is taken from the principal values below,
+	// so the Laplace-Beltrami of position, which the same pass can accumulate, is not computed
+	if (!CalcDiscreteCurvatures(V, F, nullptr, curvature_info.gaussian, deadline))
+	{
+		return false;
+	}
+
+	// Compute curvature directions via quadric fitting, or normal cycles when speed matters more than accuracy
+	auto is_calculated = false;
+	if (estimator == CurvatureEstimator::kNormalCycle)
+	{
+		is_calculated = CalcNormalCycleCurvatures(V, F, adjacency_list, BuildVertexFaces(F, V.rows()), NORMAL_CYCLE_RINGS,
+			curvature_info.principal_directions1,
+			curvature_info.principal_directions2,
+			curvature_info.principal_value1,
+			curvature_info.principal_value2,
+			deadline);
+	}
+	else
+	{
+		is_calculated = CalcPrincipalCurvatures(packed_V, N, adjacency_list, QUADRIC_FITTING_K_RING,
+			curvature_info.principal_directions1,
+			curvature_info.principal_directions2,
+			curvature_info.principal_value1,
+			curvature_info.principal_value2,
+			deadline);
+	}
+	if (!is_calculated)
+	{
+		return false;
+	}
 	curvature_info.mean = static_cast<VectorArray::value_type>(0.5) * (curvature_info.principal_value1 + curvature_info.principal_value2);
-	igl::gaussian_curvature(V, F, curvature_info.gaussian);
+	return true;
+}
+
+
+void UpdateCurvatures(
+	const VectorArray& V,
+	const PackedVectorArray& packed_V,
+	const IndicesArray& F,
+	const std::vector<std::vector<int>>& adjacency_list,
+	const std::vector<std::vector<int>>& vertex_faces,
+	const std::vector<int>& dirty_vertices,
+	PackedVectorArray& N,
+	CurvatureInfo& curvature_info)
+{
+	// normals and angle defects change on the faces around the dirty vertices
+	auto one_ring = ExpandRings(adjacency_list, dirty_vertices, 1);
+	CalcVertexNormals(V, F, vertex_faces, one_ring, N);
+
+	ScalarArray K;
+	CalcDiscreteCurvatures(V, F, vertex_faces, one_ring, nullptr, K);
+	for (size_t i = 0; i < one_ring.size(); ++i)
+	{
+		curvature_info.gaussian(one_ring[i]) = K(i);
+	}
+
+	// quadric fits see those normals and positions within their k-ring
+	auto region = ExpandRings(adjacency_list, dirty_vertices, QUADRIC_FITTING_K_RING + 1);
+	PackedVectorArray PD1, PD2;
+	ScalarArray PV1, PV2;
+	CalcPrincipalCurvatures(packed_V, N, adjacency_list, QUADRIC_FITTING_K_RING, region, PD1, PD2, PV1, PV2);
+	for (size_t i = 0; i < region.size(); ++i)
+	{
+		auto v = region[i];
+		curvature_info.principal_directions1.row(v) = PD1.row(i);
+		curvature_info.principal_directions2.row(v) = PD2.row(i);
+		curvature_info.principal_value1(v) = PV1(i);
+		curvature_info.principal_value2(v) = PV2(i);
+		curvature_info.mean(v) = 0.5 * (PV1(i) + PV2(i));
+	}
+}
+
+
+bool CalcCurvaturesTiled(
+	const VectorArray& V,
+	const IndicesArray& F,
+	const std::vector<std::vector<int>>& adjacency_list,
+	const std::vector<std::vector<int>>& vertex_faces,
+	const TiledCurvatureOptions& options,
+	CurvatureInfo& curvature_info,
+	const Deadline& deadline)
+{
+	const auto num_vertices = V.rows();
+	curvature_info.mean.resize(num_vertices);
+	curvature_info.gaussian.resize(num_vertices);
+	curvature_info.principal_value1.resize(num_vertices);
+	curvature_info.principal_directions1.resize(num_vertices, 3);
+	curvature_info.principal_value2.resize(num_vertices);
+	curvature_info.principal_directions2.resize(num_vertices, 3);
+
+	return ForEachTile(V, F, adjacency_list, vertex_faces, options, [&curvature_info](const Tile& tile, const CurvatureInfo& info)
+		{
+			for (auto i : tile.core)
+			{
+				const auto v = tile.vertices[i];
+				curvature_info.mean(v) = info.mean(i);
+				curvature_info.gaussian(v) = info.gaussian(i);
+				curvature_info.principal_value1(v) = info.principal_value1(i);
+				curvature_info.principal_directions1.row(v) = info.principal_directions1.row(i);
+				curvature_info.principal_value2(v) = info.principal_value2(i);
+				curvature_info.principal_directions2.row(v) = info.principal_directions2.row(i);
+			}
+		}, deadline);
+}
+
+
+bool CalcCurvaturesTiled(
+	const VectorArray& V,
+	const IndicesArray& F,
+	const std::vector<std::vector<int>>& adjacency_list,
+	const std::vector<std::vector<int>>& vertex_faces,
+	const TiledCurvatureOptions& options,
+	const std::string& name,
+	const std::vector<int>& rows,
+	const Deadline& deadline)
+{
+	const auto num_vertices = static_cast<std::uint64_t>(V.rows());
+	if (!rows.empty() && rows.size() != num_vertices)
+	{
+		std::cout << "rows of the curvature file must be given for every vertex\n";
+		return false;
+	}
+
+	CurvatureFileHeader header;
+	std::memcpy(header.magic, CURVATURE_FILE_MAGIC, sizeof(header.magic));
+	header.version = CURVATURE_FILE_VERSION;
+	header.reserved = 0;
+	header.num_vertices = num_vertices;
+	header.values_offset = sizeof(header);
+	header.directions_offset = header.values_offset + 4 * num_vertices * sizeof(double);
+
+	SharedMemory memory;
+	if (!memory.Create(name, header.directions_offset + 6 * num_vertices * sizeof(double)))
+	{
+		return false;
+	}
+	auto* base = static_cast<char*>(memory.data());
+	auto* values = reinterpret_cast<double*>(base + header.values_offset);
+	auto* directions = reinterpret_cast<double*>(base + header.directions_offset);
+	Eigen::Map<ScalarArray> mean(values, num_vertices);
+	Eigen::Map<ScalarArray> gaussian(values + num_vertices, num_vertices);
+	Eigen::Map<ScalarArray> principal_value1(values + 2 * num_vertices, num_vertices);
+	Eigen::Map<ScalarArray> principal_value2(values + 3 * num_vertices, num_vertices);
+	Eigen::Map<PackedVectorArray> principal_directions1(directions, num_vertices, 3);
+	Eigen::Map<PackedVectorArray> principal_directions2(directions + 3 * num_vertices, num_vertices, 3);
+
+	const auto is_completed = ForEachTile(V, F, adjacency_list, vertex_faces, options, [&](const Tile& tile, const CurvatureInfo& info)
+		{
+			for (auto i : tile.core)
+			{
+				const auto v = tile.vertices[i];
+				const auto row = rows.empty() ? v : rows[v];
+				mean(row) = info.mean(i);
+				gaussian(row) = info.gaussian(i);
+				principal_value1(row) = info.principal_value1(i);
+				principal_directions1.row(row) = info.principal_directions1.row(i);
+				principal_value2(row) = info.principal_value2(i);
+				principal_directions2.row(row) = info.principal_directions2.row(i);
+			}
+		}, deadline);
+
+	// the header is written last, so an interrupted segment is never taken for a complete one
+	if (is_completed)
+	{
+		std::memcpy(base, &header, sizeof(header));
+	}
+	return is_completed;
+}
+
+
+bool MapCurvatures(const std::string& name, const std::vector<int>& rows, SharedMemory& memory, CurvatureView& view)
+{
+	if (!memory.OpenReadOnly(name))
+	{
+		return false;
+	}
+
+	CurvatureFileHeader header;
+	if (memory.size() < sizeof(header))
+	{
+		std::cout << "segment is too small for a curvature header\n";
+		memory.Close();
+		return false;
+	}
+	std::memcpy(&header, memory.data(), sizeof(header));
+	if (std::memcmp(header.magic, CURVATURE_FILE_MAGIC, sizeof(header.magic)) != 0 || header.version != CURVATURE_FILE_VERSION)
+	{
+		std::cout << "segment does not hold curvature of version " << CURVATURE_FILE_VERSION << "\n";
+		memory.Close();
+		return false;
+	}
+	const auto num_vertices = header.num_vertices;
+	if (num_vertices > memory.size()
+		|| (!rows.empty() && rows.size() != num_vertices)
+		|| !IsInRange(header.values_offset, 4 * num_vertices * sizeof(double), memory.size())
+		|| !IsInRange(header.directions_offset, 6 * num_vertices * sizeof(double), memory.size())
+		|| header.values_offset % alignof(double) != 0
+		|| header.directions_offset % alignof(double) != 0)
+	{
+		std::cout << "invalid curvature layout in the segment\n";
+		memory.Close();
+		return false;
+	}
+
+	const auto* base = static_cast<const char*>(memory.data());
+	const auto* values = reinterpret_cast<const double*>(base + header.values_offset);
+	const auto* directions = reinterpret_cast<const double*>(base + header.directions_offset);
+	view = CurvatureView(values, directions, static_cast<Eigen::Index>(num_vertices), rows.empty() ? nullptr : rows.data());
+	return true;
 }
 
 
 void to_json(nlohmann::json& j, const CurvatureInfo& info)
 {
-	auto convert = [](const VectorArray& vec) -> std::vector<std::vector<double>>
+	auto convert = [](const PackedVectorArray& vec) -> std::vector<std::vector<double>>
 		{
 			std::vector<std::vector<double>> result(vec.rows());
 			for (Eigen::Index i = 0; i < vec.rows(); i++)
@@ -1,5 +1,9 @@
 #pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
 #include <nlohmann/json.hpp>
+#include "deadline.h"
 #include "type.h"
 
 
@@ -10,13 +14,98 @@ struct CurvatureInfo
 {
 	ScalarArray mean;	///< mean curvature
 	ScalarArray gaussian;	///< gaussian curvature
-	ScalarArray principal_value1;	///< principal curvature value 1
-	VectorArray principal_directions1;	///< principal curvature direction 1
-	ScalarArray principal_value2;	///< principal curvature value 2
-	VectorArray principal_directions2;	///< principal curvature direction 2
+	ScalarArray principal_value1;	///< principal curvature value 1, the smaller one as in igl::principal_curvature (along a convex ridge)
+	PackedVectorArray principal_directions1;	///< principal curvature direction 1, packed for per-vertex lookups while tracing. the min curvature direction
+	ScalarArray principal_value2;	///< principal curvature value 2, the larger one as in igl::principal_curvature (across a convex ridge)
+	PackedVectorArray principal_directions2;	///< principal curvature direction 2, packed for per-vertex lookups while tracing. the max curvature direction
 };
 
 
+class SharedMemory;
+
+
+/**
+ * @brief Read-only per-vertex view of curvature information, the arrays the tracers read
+ *        it views a CurvatureInfo, or a segment written by CalcCurvaturesTiled in place, see MapCurvatures.
+ *        a vertex is looked up through its row in the viewed arrays, which lets the segment stay in the order of the model file.
+ */
+class CurvatureView
+{
+	const double* mean_ = nullptr;
+	const double* principal_value1_ = nullptr;
+	const double* principal_value2_ = nullptr;
+	const double* principal_directions1_ = nullptr;	// xyz rows
+	const double* principal_directions2_ = nullptr;	// xyz rows
+	const int* rows_ = nullptr;	// row of each vertex, nullptr for the vertex order
+	Eigen::Index num_vertices_ = 0;
+
+	Eigen::Index Row(int vertex) const { return rows_ != nullptr ? rows_[vertex] : vertex; }
+
+public:
+	CurvatureView() = default;
+
+	/**
+	 * @brief View of curvature information, valid while it is not resized
+	 * @param info curvature information
+	 */
+	CurvatureView(const CurvatureInfo& info)
+		: mean_(info.mean.data()),
+		principal_value1_(info.principal_value1.data()),
+		principal_value2_(info.principal_value2.data()),
+		principal_directions1_(info.principal_directions1.data()),
+		principal_directions2_(info.principal_directions2.data()),
+		num_vertices_(info.mean.size())
+	{
+	}
+
+	/**
+	 * @brief View of arrays laid out as in a segment, see CurvatureFileHeader
+	 * @param values mean, gaussian, principal_value1 and principal_value2 of num_vertices rows each
+	 * @param directions principal_directions1 and principal_directions2 of num_vertices xyz rows each
+	 * @param num_vertices number of vertices
+	 * @param rows row of each vertex, nullptr for the vertex order
+	 */
+	CurvatureView(const double* values, const double* directions, Eigen::Index num_vertices, const int* rows)
+		: mean_(values),
+		principal_value1_(values + 2 * num_vertices),
+		principal_value2_(values + 3 * num_vertices),
+		principal_directions1_(directions),
+		principal_directions2_(directions + 3 * num_vertices),
+		rows_(rows),
+		num_vertices_(num_vertices)
+	{
+	}
+
+	Eigen::Index size() const { return num_vertices_; }
+	bool empty() const { return num_vertices_ == 0; }
+
+	double mean(int vertex) const { return mean_[Row(vertex)]; }
+	double principal_value1(int vertex) const { return principal_value1_[Row(vertex)]; }
+	double principal_value2(int vertex) const { return principal_value2_[Row(vertex)]; }
+	Eigen::Map<const Eigen::RowVector3d> principal_direction1(int vertex) const { return Eigen::Map<const Eigen::RowVector3d>(principal_directions1_ + 3 * Row(vertex)); }
+	Eigen::Map<const Eigen::RowVector3d> principal_direction2(int vertex) const { return Eigen::Map<const Eigen::RowVector3d>(principal_directions2_ + 3 * Row(vertex)); }
+};
+
+
+/**
+ * @brief Estimator of the principal curvatures
+ */
+enum class CurvatureEstimator
+{
+	kQuadricFitting,	///< quadric fitted to the 5-ring of each vertex, as igl::principal_curvature
+	kNormalCycle,	///< normal cycle tensors of the 1-ring edges, faster and coarser, see CalcNormalCycleCurvatures
+};
+
+
+/**
+ * @brief Convert the name of an estimator
+ *        the function will raise an std::invalid_argument exception for an unknown name.
+ * @param name "quadric" or "normal_cycle", empty for "quadric"
+ * @return estimator
+ */
+CurvatureEstimator ToCurvatureEstimator(const std::string& name);
+
+
 /**
 * @brief Initialize curvature information
 * @param curvature_info curvature information
@@ -28,10 +117,176 @@ void Initialize(CurvatureInfo& curvature_info);
  * @brief Calculate curvature information
  * @param V vertex array
  * @param F face array
+ * @param adjacency_list adjacency list
+ * @param curvature_info curvature information
+ * @param deadline deadline checked while computing
+ * @return false if the deadline is exceeded and curvature_info is incomplete, true otherwise
+ */
+bool CalcCurvatures(
+	const VectorArray& V,
+	const IndicesArray& F,
+	const std::vector<std::vector<int>>& adjacency_list,
+	CurvatureInfo& curvature_info,
+	const Deadline& deadline = Deadline());
+
+
+/**
+ * @brief Calculate curvature information with a given estimator of the principal curvatures
+ *        mean and gaussian curvatures are derived the same way for both estimators.
+ * @param V vertex array
+ * @param F face array
+ * @param adjacency_list adjacency list
+ * @param estimator estimator of the principal curvatures
+ * @param curvature_info curvature information
+ * @param deadline deadline checked while computing
+ * @return false if the deadline is exceeded and curvature_info is incomplete, true otherwise
+ */
+bool CalcCurvatures(
+	const VectorArray& V,
+	const IndicesArray& F,
+	const std::vector<std::vector<int>>& adjacency_list,
+	CurvatureEstimator estimator,
+	CurvatureInfo& curvature_info,
+	const Deadline& deadline = Deadline());
+
+
+/**
+ * @brief Calculate curvature information with the packed vertices and vertex normals the caller already has
+ * @param V vertex array
+ * @param packed_V vertex array in packed layout, read by the quadric fitting. it may view vertices owned by the caller
+ * @param F face array
+ * @param adjacency_list adjacency list
+ * @param N vertex normals, see CalcVertexNormals. read by the quadric fitting
+ * @param estimator estimator of the principal curvatures
  * @param curvature_info curvature information
+ * @param deadline deadline checked while computing
+ * @return false if the deadline is exceeded and curvature_info is incomplete, true otherwise
+ */
+bool CalcCurvatures(
+	const VectorArray& V,
+	const PackedVectorView& packed_V,
+	const IndicesArray& F,
+	const std::vector<std::vector<int>>& adjacency_list,
+	const PackedVectorArray& N,
+	CurvatureEstimator estimator,
+	CurvatureInfo& curvature_info,
+	const Deadline& deadline = Deadline());
+
+
+/**
+ * @brief Update curvature information around edited vertices
+ *        only the vertices whose curvature depends on the dirty vertices are recomputed:
+ *        the 1-ring for normals and discrete curvatures, and one ring more than the quadric fitting neighbourhood for principal curvatures.
+ * @param V vertex array
+ * @param packed_V vertex array in packed layout
+ * @param F face array
+ * @param adjacency_list adjacency list, already updated for the edit
+ * @param vertex_faces faces incident to each vertex, already updated for the edit
+ * @param dirty_vertices vertices whose position or incident faces changed
+ * @param N [i/o] vertex normals, updated around the dirty vertices
+ * @param curvature_info [i/o] curvature information
  * @return void
  */
-void CalcCurvatures(const VectorArray& V, const IndicesArray& F, CurvatureInfo& curvature_info);
+void UpdateCurvatures(
+	const VectorArray& V,
+	const PackedVectorArray& packed_V,
+	const IndicesArray& F,
+	const std::vector<std::vector<int>>& adjacency_list,
+	const std::vector<std::vector<int>>& vertex_faces,
+	const std::vector<int>& dirty_vertices,
+	PackedVectorArray& N,
+	CurvatureInfo& curvature_info);
+
+
+/**
+ * @brief Options of the tiled curvature computation
+ */
+struct TiledCurvatureOptions
+{
+	int tile_vertices = 65536;	///< vertices per tile, without the halo
+	int concurrent_tiles = 2;	///< tiles processed at the same time, each one in parallel over its vertices
+	CurvatureEstimator estimator = CurvatureEstimator::kQuadricFitting;	///< estimator of the principal curvatures of each tile
+};
+
+
+/**
+ * @brief Header of per-vertex curvature written to a mapped segment
+ *        the values are doubles, one array after the other: mean, gaussian, principal_value1 and principal_value2
+ *        from values_offset, then principal_directions1 and principal_directions2 as xyz rows from directions_offset.
+ */
+struct CurvatureFileHeader
+{
+	char magic[8];	// "GECURV\0\0"
+	std::uint32_t version;	// CURVATURE_FILE_VERSION
+	std::uint32_t reserved;
+	std::uint64_t num_vertices;
+	std::uint64_t values_offset;	// in bytes, aligned to 8
+	std::uint64_t directions_offset;	// in bytes, aligned to 8
+};
+
+
+constexpr std::uint32_t CURVATURE_FILE_VERSION = 1;
+
+
+/**
+ * @brief Calculate curvature information tile by tile, for meshes too large to process at once
+ *        vertices are split into tiles along a Morton curve. each tile is extended with a halo of the rings
+ *        the quadric fitting reads (and one more for the normals), copied into a small mesh of its own
+ *        and processed with CalcCurvatures, so the values of the tile vertices are the same as over the whole mesh.
+ *        peak working memory scales with tile_vertices * concurrent_tiles instead of the mesh size. the inputs are not tiled:
+ *        V, F, adjacency_list and vertex_faces of the whole mesh stay in memory, and so does curvature_info in this overload.
+ * @param V vertex array
+ * @param F face array
+ * @param adjacency_list adjacency list
+ * @param vertex_faces faces incident to each vertex
+ * @param options tile size and concurrency
+ * @param curvature_info [o] curvature information
+ * @param deadline deadline checked while computing
+ * @return false if the deadline is exceeded and curvature_info is incomplete, true otherwise
+ */
+bool CalcCurvaturesTiled(
+	const VectorArray& V,
+	const IndicesArray& F,
+	const std::vector<std::vector<int>>& adjacency_list,
+	const std::vector<std::vector<int>>& vertex_faces,
+	const TiledCurvatureOptions& options,
+	CurvatureInfo& curvature_info,
+	const Deadline& deadline = Deadline());
+
+
+/**
+ * @brief Calculate curvature information tile by tile and stream it to a mapped segment, see CurvatureFileHeader
+ *        results are written to the mapping as tiles complete and are not held in memory. the inputs stay in memory, as above.
+ * @param V vertex array
+ * @param F face array
+ * @param adjacency_list adjacency list
+ * @param vertex_faces faces incident to each vertex
+ * @param options tile size and concurrency
+ * @param name segment name, like "file:<path>", see SharedMemory
+ * @param rows row of each vertex in the segment, empty to keep the vertex order
+ * @param deadline deadline checked while computing
+ * @return false if the segment is not created or the deadline is exceeded, true otherwise
+ */
+bool CalcCurvaturesTiled(
+	const VectorArray& V,
+	const IndicesArray& F,
+	const std::vector<std::vector<int>>& adjacency_list,
+	const std::vector<std::vector<int>>& vertex_faces,
+	const TiledCurvatureOptions& options,
+	const std::string& name,
+	const std::vector<int>& rows = {},
+	const Deadline& deadline = Deadline());
+
+
+/**
+ * @brief Map a segment written by CalcCurvaturesTiled and view it in place, nothing is copied
+ * @param name segment name
+ * @param rows row of each vertex in the segment, empty to keep the vertex order. it is referenced by the view
+ * @param memory [o] mapping, the view is valid while it stays open
+ * @param view [o] view of the segment
+ * @return true if the segment holds curvature of the expected size, false otherwise
+ */
+bool MapCurvatures(const std::string& name, const std::vector<int>& rows, SharedMemory& memory, CurvatureView& view);
 
 
 // serialize functions
@@ -0,0 +1,52 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+
+
+/**
+ * @brief Deadline and cancel token of a request
+ *        long running stages check it cooperatively and stop early when it is exceeded.
+ *        a default constructed deadline never expires.
+ */
+class Deadline
+{
+	using Clock = std::chrono::steady_clock;
+
+	Clock::time_point time_ = Clock::time_point::max();
+	const std::atomic<bool>* cancel_ = nullptr;
+
+public:
+	Deadline() = default;
+
+	/**
+	 * @brief Deadline after a time limit from now
+	 * @param milliseconds time limit, 0 or less for no limit
+	 * @param cancel cancel token set by another thread, may be null
+	 */
+	Deadline(double milliseconds, const std::atomic<bool>* cancel)
+		: cancel_(cancel)
+	{
+		if (milliseconds > 0.0)
+		{
+			time_ = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(milliseconds));
+		}
+	}
+
+	bool IsCancelled() const
+	{
+		return cancel_ != nullptr && cancel_->load(std::memory_order_relaxed);
+	}
+
+	bool IsExpired() const
+	{
+		return time_ != Clock::time_point::max() && Clock::now() >= time_;
+	}
+
+	/**
+	 * @brief Whether the request should stop, either cancelled or expired
+	 */
+	bool IsExceeded() const
+	{
+		return IsCancelled() || IsExpired();
+	}
+};
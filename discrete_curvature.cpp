@@ -0,0 +1,244 @@
+#include "discrete_curvature.h"
+#include <atomic>
+#include <cmath>
+#include <vector>
+#include <Eigen/Geometry>
+#include <igl/PI.h>
+#include <igl/parallel_for.h>
+
+
+namespace
+{
+	/**
+	 * @brief Per-vertex sums accumulated over the faces
+	 */
+	struct Accumulator
+	{
+		PackedVectorArray LV;	// L * V
+		ScalarArray area;	// diagonal of the voronoi mass matrix
+		ScalarArray angle;	// sum of the corner angles
+
+		void Reset(Eigen::Index num_vertices, bool with_laplacian)
+		{
+			LV.setZero(with_laplacian ? num_vertices : 0, 3);
+			area.setZero(with_laplacian ? num_vertices : 0);
+			angle.setZero(num_vertices);
+		}
+	};
+
+
+	/**
+	 * @brief Contribution of one face to each of its corners
+	 */
+	struct FaceContribution
+	{
+		Eigen::RowVector3d LV[3];
+		double area[3];
+		double angle[3];
+	};
+
+
+	/**
+	 * @brief Contribution of one face, the laplacian and the areas only when with_laplacian is true
+	 */
+	FaceContribution CalcFaceContribution(const VectorArray& V, const IndicesArray& F, Eigen::Index f, bool with_laplacian)
+	{
+		FaceContribution c;
+		const int i[3] = { F(f, 0), F(f, 1), F(f, 2) };
+		const Eigen::RowVector3d p[3] = { V.row(i[0]), V.row(i[1]), V.row(i[2]) };
+
+		// edge k is opposite to corner k
+		const Eigen::RowVector3d e[3] = { p[2] - p[1], p[0] - p[2], p[1] - p[0] };
+		const double l2[3] = { e[0].squaredNorm(), e[1].squaredNorm(), e[2].squaredNorm() };
+		const double l[3] = { std::sqrt(l2[0]), std::sqrt(l2[1]), std::sqrt(l2[2]) };
+		const auto dblA = e[2].cross(-e[1]).norm();
+
+		double cosines[3], cotangents[3];
+		for (int k = 0; k < 3; ++k)
+		{
+			const auto& a = e[(k + 2) % 3];	// from corner k to corner k+1
+			const auto& b = e[(k + 1) % 3];	// from corner k+2 to corner k
+			const auto dot = -a.dot(b);
+			cosines[k] = dot / (l[(k + 1) % 3] * l[(k + 2) % 3]);
+			cotangents[k] = dot / dblA;
+			c.angle[k] = std::atan2(dblA, dot);
+			c.LV[k].setZero();
+		}
+		if (!with_laplacian)
+		{
+			return c;
+		}
+
+		// cotangent laplacian, w = cot / 2 on the edge opposite to each corner
+		for (int k = 0; k < 3; ++k)
+		{
+			const auto w = 0.5 * cotangents[k];
+			c.LV[(k + 1) % 3] += w * e[k];
+			c.LV[(k + 2) % 3] -= w * e[k];
+		}
+
+		// mixed voronoi area, as igl::massmatrix with MASSMATRIX_TYPE_VORONOI
+		if (cosines[0] < 0.0 || cosines[1] < 0.0 || cosines[2] < 0.0)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				c.area[k] = (cosines[k] < 0.0 ? 0.25 : 0.125) * dblA;
+			}
+		}
+		else
+		{
+			double barycentric[3];
+			double sum = 0.0;
+			for (int k = 0; k < 3; ++k)
+			{
+				barycentric[k] = cosines[k] * l[k];
+				sum += barycentric[k];
+			}
+			double partial[3];
+			for (int k = 0; k < 3; ++k)
+			{
+				partial[k] = barycentric[k] / sum * dblA * 0.5;
+			}
+			for (int k = 0; k < 3; ++k)
+			{
+				c.area[k] = (partial[(k + 1) % 3] + partial[(k + 2) % 3]) * 0.5;
+			}
+		}
+		return c;
+	}
+
+
+	void AccumulateFace(const VectorArray& V, const IndicesArray& F, Eigen::Index f, bool with_laplacian, Accumulator& acc)
+	{
+		const auto c = CalcFaceContribution(V, F, f, with_laplacian);
+		for (int k = 0; k < 3; ++k)
+		{
+			const auto v = F(f, k);
+			if (with_laplacian)
+			{
+				acc.LV.row(v) += c.LV[k];
+				acc.area(v) += c.area[k];
+			}
+			acc.angle(v) += c.angle[k];
+		}
+	}
+
+
+	static const Eigen::Index FACES_PER_DEADLINE_CHECK = 4096;
+
+
+	Eigen::RowVector3d MeanCurvatureNormal(const Eigen::RowVector3d& LV, double area)
+	{
+		return area != 0.0 ? Eigen::RowVector3d(-LV / area) : Eigen::RowVector3d::Zero();
+	}
+
+
+	double AngleDefect(double angle)
+	{
+		return 2.0 * igl::PI - angle;
+	}
+}
+
+
+bool CalcDiscreteCurvatures(const VectorArray& V, const IndicesArray& F, VectorArray* HN, ScalarArray& K, const Deadline& deadline)
+{
+	const auto num_vertices = V.rows();
+	const auto with_laplacian = HN != nullptr;
+	Accumulator total;
+	total.Reset(num_vertices, with_laplacian);
+
+	std::atomic<bool> is_exceeded(false);
+	std::vector<Accumulator> accumulators;
+	igl::parallel_for(
+		F.rows(),
+		[&accumulators, num_vertices, with_laplacian](size_t num_threads)
+		{
+			accumulators.resize(num_threads);
+			for (auto& acc : accumulators)
+			{
+				acc.Reset(num_vertices, with_laplacian);
+			}
+		},
+		[&V, &F, &accumulators, &deadline, &is_exceeded, with_laplacian](Eigen::Index f, size_t thread)
+		{
+			if (f % FACES_PER_DEADLINE_CHECK == 0 && deadline.IsExceeded())
+			{
+				is_exceeded = true;
+			}
+			if (is_exceeded.load(std::memory_order_relaxed))
+			{
+				return;
+			}
+			AccumulateFace(V, F, f, with_laplacian, accumulators[thread]);
+		},
+		[&total, &accumulators, with_laplacian](size_t thread)
+		{
+			if (with_laplacian)
+			{
+				total.LV += accumulators[thread].LV;
+				total.area += accumulators[thread].area;
+			}
+			total.angle += accumulators[thread].angle;
+		});
+	if (is_exceeded)
+	{
+		return false;
+	}
+
+	if (with_laplacian)
+	{
+		HN->resize(num_vertices, 3);
+		for (Eigen::Index v = 0; v < num_vertices; ++v)
+		{
+			HN->row(v) = MeanCurvatureNormal(total.LV.row(v), total.area(v));
+		}
+	}
+	K.resize(num_vertices);
+	for (Eigen::Index v = 0; v < num_vertices; ++v)
+	{
+		K(v) = AngleDefect(total.angle(v));
+	}
+	return true;
+}
+
+
+void CalcDiscreteCurvatures(
+	const VectorArray& V,
+	const IndicesArray& F,
+	const std::vector<std::vector<int>>& vertex_faces,
+	const std::vector<int>& vertices,
+	VectorArray* HN,
+	ScalarArray& K)
+{
+	const auto with_laplacian = HN != nullptr;
+	if (with_laplacian)
+	{
+		HN->resize(vertices.size(), 3);
+	}
+	K.resize(vertices.size());
+	igl::parallel_for(vertices.size(), [&](size_t i)
+		{
+			const auto v = vertices[i];
+			Eigen::RowVector3d LV = Eigen::RowVector3d::Zero();
+			double area = 0.0;
+			double angle = 0.0;
+			for (auto f : vertex_faces[v])
+			{
+				const auto c = CalcFaceContribution(V, F, f, with_laplacian);
+				for (int k = 0; k < 3; ++k)
+				{
+					if (F(f, k) == v)
+					{
+						LV += c.LV[k];
+						area += c.area[k];
+						angle += c.angle[k];
+					}
+				}
+			}
+			if (with_laplacian)
+			{
+				HN->row(i) = MeanCurvatureNormal(LV, area);
+			}
+			K(i) = AngleDefect(angle);
+		}, 1000);
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <vector>
+#include "deadline.h"
+#include "type.h"
+
+
+/**
+ * @brief Calculate the mean curvature normal and the gaussian curvature in a single pass over the faces
+ *        each face contributes its cotangent weights, mixed voronoi areas and corner angles at once,
+ *        so the result equals -M^-1 (L V) with igl::cotmatrix and igl::massmatrix (voronoi), and igl::gaussian_curvature,
+ *        without assembling sparse matrices. faces are processed in parallel with per-thread accumulators.
+ * @param V [i] vertices
+ * @param F [i] faces
+ * @param HN [o] mean curvature normal, nullptr to skip the laplacian and the areas, then the pass sums the angles only
+ * @param K [o] gaussian curvature as angle defect (not divided by area)
+ * @param deadline [i] deadline checked every few thousand faces
+ * @return false if the deadline is exceeded and the outputs are incomplete, true otherwise
+ */
+bool CalcDiscreteCurvatures(const VectorArray& V, const IndicesArray& F, VectorArray* HN, ScalarArray& K, const Deadline& deadline = Deadline());
+
+
+/**
+ * @brief Calculate the mean curvature normal and the gaussian curvature of some vertices only, for local updates after an edit
+ *        each vertex sums the contributions of its incident faces.
+ * @param V [i] vertices
+ * @param F [i] faces
+ * @param vertex_faces [i] faces incident to each vertex
+ * @param vertices [i] vertices to compute
+ * @param HN [o] mean curvature normal, one row per element of vertices. nullptr to skip it
+ * @param K [o] gaussian curvature as angle defect, one row per element of vertices
+ * @return void
+ */
+void CalcDiscreteCurvatures(
+	const VectorArray& V,
+	const IndicesArray& F,
+	const std::vector<std::vector<int>>& vertex_faces,
+	const std::vector<int>& vertices,
+	VectorArray* HN,
+	ScalarArray& K);
@@ -0,0 +1,372 @@
+#include "gem_format.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <igl/adjacency_list.h>
+#include "shared_memory.h"
+
+
+namespace
+{
+	const char GEM_MAGIC[4] = { 'G', 'E', 'M', '1' };
+
+
+	std::uint64_t AlignTo8(std::uint64_t offset)
+	{
+		return (offset + 7) & ~static_cast<std::uint64_t>(7);
+	}
+
+
+	std::uint64_t ZigZag(std::int64_t value)
+	{
+		return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+	}
+
+
+	std::int64_t UnZigZag(std::uint64_t value)
+	{
+		return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+	}
+
+
+	void PutVarint(std::uint64_t value, std::vector<unsigned char>& out)
+	{
+		while (value >= 0x80)
+		{
+			out.push_back(static_cast<unsigned char>(value | 0x80));
+			value >>= 7;
+		}
+		out.push_back(static_cast<unsigned char>(value));
+	}
+
+
+	/**
+	 * @brief Reader of varints in a section, reports overruns instead of reading past the end
+	 */
+	struct VarintReader
+	{
+		const unsigned char* p;
+		const unsigned char* end;
+		bool is_valid = true;
+
+		std::uint64_t Get()
+		{
+			std::uint64_t value = 0;
+			for (int shift = 0; shift < 64; shift += 7)
+			{
+				if (p == end)
+				{
+					is_valid = false;
+					return 0;
+				}
+				const auto byte = *p++;
+				value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+				if ((byte & 0x80) == 0)
+				{
+					return value;
+				}
+			}
+			is_valid = false;
+			return 0;
+		}
+	};
+
+
+	std::vector<unsigned char> EncodePositions(const VectorArray& V, const GemHeader& header)
+	{
+		const auto levels = static_cast<double>((1u << header.position_bits) - 1);
+		double scale[3];
+		for (int k = 0; k < 3; ++k)
+		{
+			const auto extent = header.max[k] - header.min[k];
+			scale[k] = extent > 0.0 ? levels / extent : 0.0;
+		}
+		auto quantize = [&](Eigen::Index i, int k) -> std::uint64_t
+			{
+				return static_cast<std::uint64_t>(std::llround((V(i, k) - header.min[k]) * scale[k]));
+			};
+
+		const auto n = static_cast<size_t>(V.rows());
+		std::vector<unsigned char> out;
+		if (header.position_bits == 16)
+		{
+			std::vector<std::uint16_t> planes(3 * n);
+			for (int k = 0; k < 3; ++k)
+			{
+				for (size_t i = 0; i < n; ++i)
+				{
+					planes[k * n + i] = static_cast<std::uint16_t>(quantize(i, k));
+				}
+			}
+			out.resize(planes.size() * sizeof(std::uint16_t));
+			std::memcpy(out.data(), planes.data(), out.size());
+		}
+		else
+		{
+			std::vector<std::uint64_t> words(n);
+			for (size_t i = 0; i < n; ++i)
+			{
+				words[i] = quantize(i, 0) | (quantize(i, 1) << 21) | (quantize(i, 2) << 42);
+			}
+			out.resize(words.size() * sizeof(std::uint64_t));
+			std::memcpy(out.data(), words.data(), out.size());
+		}
+		return out;
+	}
+
+
+	void DecodePositions(const unsigned char* data, const GemHeader& header, VectorArray& V)
+	{
+		const auto n = static_cast<Eigen::Index>(header.num_vertices);
+		const auto levels = static_cast<double>((1u << header.position_bits) - 1);
+		V.resize(n, 3);
+		if (header.position_bits == 16)
+		{
+			// one plane per column of V, dequantized with vectorized expressions straight from the mapping
+			for (int k = 0; k < 3; ++k)
+			{
+				const Eigen::Map<const Eigen::Array<std::uint16_t, Eigen::Dynamic, 1>> q(reinterpret_cast<const std::uint16_t*>(data) + k * n, n);
+				const auto step = (header.max[k] - header.min[k]) / levels;
+				V.col(k) = (q.cast<double>() * step + header.min[k]).matrix();
+			}
+		}
+		else
+		{
+			// one pass per column of V, so that each writes contiguously. the fields fit in 32 bits,
+			// which the compiler converts to double in vector registers, unlike 64-bit integers before AVX-512
+			static const std::uint64_t MASK = (1u << 21) - 1;
+			const auto* words = reinterpret_cast<const std::uint64_t*>(data);
+			for (int k = 0; k < 3; ++k)
+			{
+				const auto shift = 21 * k;
+				const auto step = (header.max[k] - header.min[k]) / levels;
+				const auto min = header.min[k];
+				auto* out = V.col(k).data();
+				for (Eigen::Index i = 0; i < n; ++i)
+				{
+					out[i] = static_cast<double>(static_cast<std::int32_t>((words[i] >> shift) & MASK)) * step + min;
+				}
+			}
+		}
+	}
+
+
+	std::vector<unsigned char> EncodeIndices(const IndicesArray& F)
+	{
+		std::vector<unsigned char> out;
+		out.reserve(static_cast<size_t>(F.size()) * 2);
+		std::int64_t previous = 0;
+		for (Eigen::Index f = 0; f < F.rows(); ++f)
+		{
+			for (Eigen::Index k = 0; k < 3; ++k)
+			{
+				PutVarint(ZigZag(F(f, k) - previous), out);
+				previous = F(f, k);
+			}
+		}
+		return out;
+	}
+
+
+	std::vector<unsigned char> EncodeAdjacency(const std::vector<std::vector<int>>& adjacency_list)
+	{
+		std::vector<unsigned char> out;
+		for (size_t v = 0; v < adjacency_list.size(); ++v)
+		{
+			const auto& neighbors = adjacency_list[v];
+			PutVarint(neighbors.size(), out);
+			for (size_t j = 0; j < neighbors.size(); ++j)
+			{
+				if (j == 0)
+				{
+					PutVarint(ZigZag(static_cast<std::int64_t>(neighbors[0]) - static_cast<std::int64_t>(v)), out);
+				}
+				else
+				{
+					PutVarint(static_cast<std::uint64_t>(neighbors[j] - neighbors[j - 1] - 1), out);
+				}
+			}
+		}
+		return out;
+	}
+}
+
+
+bool SaveGem(const std::filesystem::path& filepath, const VectorArray& V, const IndicesArray& F, const GemOptions& options)
+{
+	if (options.position_bits != 16 && options.position_bits != 21)
+	{
+		std::cout << "position bits must be 16 or 21\n";
+		return false;
+	}
+	if (V.rows() == 0 || V.cols() != 3 || F.cols() != 3)
+	{
+		std::cout << "mesh must have vertices and triangles\n";
+		return false;
+	}
+
+	GemHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, GEM_MAGIC, sizeof(header.magic));
+	header.version = GEM_VERSION;
+	header.position_bits = static_cast<std::uint32_t>(options.position_bits);
+	header.num_vertices = static_cast<std::uint64_t>(V.rows());
+	header.num_faces = static_cast<std::uint64_t>(F.rows());
+	for (int k = 0; k < 3; ++k)
+	{
+		header.min[k] = V.col(k).minCoeff();
+		header.max[k] = V.col(k).maxCoeff();
+	}
+
+	const auto positions = EncodePositions(V, header);
+	const auto indices = EncodeIndices(F);
+	std::vector<unsigned char> adjacency;
+	if (options.with_adjacency)
+	{
+		std::vector<std::vector<int>> adjacency_list;
+		igl::adjacency_list(F, adjacency_list);
+		adjacency_list.resize(V.rows());
+		// the gap coding needs the sorted unique neighbours igl::adjacency_list produces
+		auto is_sorted = std::all_of(adjacency_list.begin(), adjacency_list.end(), [](const std::vector<int>& neighbors)
+			{
+				return std::adjacent_find(neighbors.begin(), neighbors.end(), std::greater_equal<int>()) == neighbors.end();
+			});
+		if (is_sorted)
+		{
+			adjacency = EncodeAdjacency(adjacency_list);
+			header.flags |= GEM_FLAG_ADJACENCY;
+		}
+		else
+		{
+			std::cout << "adjacency is not stored since neighbours are not sorted\n";
+		}
+	}
+
+	header.positions_offset = AlignTo8(sizeof(header));
+	header.positions_size = positions.size();
+	header.indices_offset = AlignTo8(header.positions_offset + header.positions_size);
+	header.indices_size = indices.size();
+	header.adjacency_offset = AlignTo8(header.indices_offset + header.indices_size);
+	header.adjacency_size = adjacency.size();
+
+	std::ofstream out(filepath, std::ios::binary);
+	if (!out)
+	{
+		return false;
+	}
+	auto write_at = [&out](std::uint64_t offset, const void* data, size_t size)
+		{
+			static const char PADDING[8] = {};
+			const auto position = static_cast<std::uint64_t>(out.tellp());
+			out.write(PADDING, static_cast<std::streamsize>(offset - position));
+			out.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+		};
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	write_at(header.positions_offset, positions.data(), positions.size());
+	write_at(header.indices_offset, indices.data(), indices.size());
+	write_at(header.adjacency_offset, adjacency.data(), adjacency.size());
+	return static_cast<bool>(out);
+}
+
+
+bool LoadGem(const std::filesystem::path& filepath, VectorArray& V, IndicesArray& F, std::vector<std::vector<int>>* adjacency_list)
+{
+	// the sections are decoded straight from the mapped file, which is unmapped on return
+	SharedMemory memory;
+	if (!memory.OpenReadOnly("file:" + filepath.string()))
+	{
+		return false;
+	}
+	const auto size = static_cast<std::uint64_t>(memory.size());
+	const auto* data = static_cast<const unsigned char*>(memory.data());
+	if (size < sizeof(GemHeader))
+	{
+		std::cout << "failed to read the gem file\n";
+		return false;
+	}
+
+	GemHeader header;
+	std::memcpy(&header, data, sizeof(header));
+	auto is_in_file = [size](std::uint64_t offset, std::uint64_t length)
+		{
+			return offset <= size && length <= size - offset;
+		};
+	const auto bytes_per_vertex = header.position_bits == 16 ? 3 * sizeof(std::uint16_t) : sizeof(std::uint64_t);
+	if (std::memcmp(header.magic, GEM_MAGIC, sizeof(header.magic)) != 0 || header.version != GEM_VERSION
+		|| (header.position_bits != 16 && header.position_bits != 21)
+		|| header.num_vertices > size || header.num_faces > size
+		|| header.positions_offset % sizeof(std::uint64_t) != 0
+		|| header.positions_size != header.num_vertices * bytes_per_vertex
+		|| !is_in_file(header.positions_offset, header.positions_size)
+		|| !is_in_file(header.indices_offset, header.indices_size)
+		|| !is_in_file(header.adjacency_offset, header.adjacency_size))
+	{
+		std::cout << "invalid gem file\n";
+		return false;
+	}
+
+	DecodePositions(data + header.positions_offset, header, V);
+
+	const auto num_vertices = static_cast<std::int64_t>(header.num_vertices);
+	F.resize(static_cast<Eigen::Index>(header.num_faces), 3);
+	VarintReader indices{ data + header.indices_offset, data + header.indices_offset + header.indices_size };
+	std::int64_t previous = 0;
+	for (Eigen::Index f = 0; f < F.rows(); ++f)
+	{
+		for (Eigen::Index k = 0; k < 3; ++k)
+		{
+			previous += UnZigZag(indices.Get());
+			if (previous < 0 || previous >= num_vertices)
+			{
+				indices.is_valid = false;
+			}
+			F(f, k) = static_cast<int>(previous);
+		}
+	}
+	if (!indices.is_valid)
+	{
+		std::cout << "invalid indices in the gem file\n";
+		return false;
+	}
+
+	if (adjacency_list != nullptr)
+	{
+		adjacency_list->clear();
+		if (header.flags & GEM_FLAG_ADJACENCY)
+		{
+			adjacency_list->resize(static_cast<size_t>(num_vertices));
+			VarintReader adjacency{ data + header.adjacency_offset, data + header.adjacency_offset + header.adjacency_size };
+			for (std::int64_t v = 0; v < num_vertices && adjacency.is_valid; ++v)
+			{
+				auto& neighbors = (*adjacency_list)[v];
+				const auto count = adjacency.Get();
+				if (count > static_cast<std::uint64_t>(num_vertices))
+				{
+					adjacency.is_valid = false;
+					break;
+				}
+				neighbors.resize(static_cast<size_t>(count));
+				std::int64_t neighbor = v;
+				for (size_t j = 0; j < neighbors.size(); ++j)
+				{
+					neighbor = j == 0 ? v + UnZigZag(adjacency.Get()) : neighbor + static_cast<std::int64_t>(adjacency.Get()) + 1;
+					if (neighbor < 0 || neighbor >= num_vertices)
+					{
+						adjacency.is_valid = false;
+					}
+					neighbors[j] = static_cast<int>(neighbor);
+				}
+			}
+			if (!adjacency.is_valid)
+			{
+				std::cout << "invalid adjacency in the gem file\n";
+				adjacency_list->clear();
+				return false;
+			}
+		}
+	}
+	return true;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+#include "type.h"
+
+
+/**
+ * @brief Header of a .gem file, the native mesh format of the engine
+ *        sections follow the header at 8-byte aligned offsets so that the file can be memory-mapped:
+ *        - positions: quantized over the bounding box. 16 bits: three planes of uint16 (x..., y..., z...),
+ *                     21 bits: one uint64 per vertex holding x | y << 21 | z << 42
+ *        - indices: face indices in order, each as the zigzag varint of the delta from the previous index
+ *        - adjacency (optional): per vertex, the varint count of sorted neighbours, the zigzag varint of the first one
+ *                     relative to the vertex, then the varint gaps minus one, as produced by igl::adjacency_list
+ *        all values are little endian.
+ */
+struct GemHeader
+{
+	char magic[4];	// "GEM1"
+	std::uint32_t version;	// GEM_VERSION
+	std::uint32_t position_bits;	// 16 or 21
+	std::uint32_t flags;	// GEM_FLAG_*
+	std::uint64_t num_vertices;
+	std::uint64_t num_faces;
+	double min[3];	// bounding box
+	double max[3];
+	std::uint64_t positions_offset;
+	std::uint64_t positions_size;
+	std::uint64_t indices_offset;
+	std::uint64_t indices_size;
+	std::uint64_t adjacency_offset;
+	std::uint64_t adjacency_size;
+};
+
+
+constexpr std::uint32_t GEM_VERSION = 1;
+constexpr std::uint32_t GEM_FLAG_ADJACENCY = 1;
+
+
+/**
+ * @brief Options to write a .gem file
+ */
+struct GemOptions
+{
+	int position_bits = 16;	// 16 or 21, the error is at most half of the bounding box extent / (2^bits - 1) per axis
+	bool with_adjacency = false;	// store the adjacency list so that loading skips igl::adjacency_list
+};
+
+
+/**
+ * @brief Save a mesh to a .gem file
+ * @param filepath file path
+ * @param V vertices
+ * @param F faces
+ * @param options options
+ * @return true if the file is saved successfully, false otherwise
+ */
+bool SaveGem(const std::filesystem::path& filepath, const VectorArray& V, const IndicesArray& F, const GemOptions& options);
+
+
+/**
+ * @brief Load a mesh from a .gem file
+ *        the file is memory-mapped read-only and its sections are decoded from the mapping, nothing else is read into memory.
+ * @param filepath file path
+ * @param V [o] vertices, dequantized
+ * @param F [o] faces
+ * @param adjacency_list [o] adjacency list if the file has one, may be null
+ * @return true if the file is loaded successfully, false otherwise
+ */
+bool LoadGem(const std::filesystem::path& filepath, VectorArray& V, IndicesArray& F, std::vector<std::vector<int>>* adjacency_list);
@@ -1,18 +1,43 @@
 #include "geometry_engine.h"
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <fstream>
+#include <memory>
+#include <set>
+#include <unordered_set>
 #include <igl/adjacency_list.h>
+#include "deadline.h"
+#include "gem_format.h"
 #include "geometry_utils.h"
 #include "return_code.h"
 #include "io_utils.h"
 #include "marginline.h"
+#include "perf_counters.h"
+#include "reorder.h"
+#include "result_cache.h"
+#include "shared_memory.h"
+#include "smoothing.h"
 
 
 namespace
 {
-	std::vector<std::vector<double>> Convert(const VectorArray& V, const std::vector<int>& indices)
+	static const int MAX_SMOOTHING_ITERATIONS = 10;
+
+
+	using Clock = std::chrono::steady_clock;
+
+
+	double ElapsedMs(Clock::time_point since)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - since).count();
+	}
+
+
+	std::vector<std::vector<double>> Convert(const PackedVectorArray& V, const std::vector<int>& indices)
 	{
 		std::vector<std::vector<double>> result;
+		result.reserve(indices.size());
 		for (auto i : indices)
 		{
 			result.push_back({ V(i, 0), V(i, 1), V(i, 2) });
@@ -21,6 +46,27 @@ namespace
 	}
 
 
+	/**
+	 * @brief Send the final progress event of a run
+	 * @param callback progress callback, may be empty
+	 * @param points downsampled margin line
+	 */
+	void SendFinalProgress(const GeometryEngine::ProgressCallback& callback, const std::vector<std::vector<double>>& points)
+	{
+		if (!callback)
+		{
+			return;
+		}
+		std::vector<double> values;
+		values.reserve(3 * points.size());
+		for (const auto& point : points)
+		{
+			values.insert(values.end(), point.begin(), point.end());
+		}
+		callback(values.data(), points.size(), true);
+	}
+
+
 	std::filesystem::path GetOutputPath(const std::filesystem::path& input_json)
 	{
 		std::filesystem::path output_path = input_json.parent_path() / "output.json";
@@ -47,23 +93,62 @@ namespace
 }
 
 
-bool GeometryEngine::Initialize(const std::filesystem::path& input_json)
+void GeometryEngine::Reset()
 {
 	is_initialized_ = false;
-	input_json_ = input_json;
+	input_json_.clear();
+	// the result segment of the previous job must not receive the errors of this one
+	input_ = GeometryEngineInput();
 	adjacency_list_.clear();
+	vertex_faces_.clear();
+	original_vertex_indices_.clear();
+	vertex_indices_.clear();
 	::Initialize(curvature_info_);
+	curvature_memory_.Close();
+	mapped_curvature_ = CurvatureView();
+	is_curvature_valid_ = false;
+	dirty_vertices_.clear();
+	ridge_graph_ = RidgeGraph();
+	is_ridge_graph_valid_ = false;
+	picker_.Clear();	// the tree refers to the mesh that is replaced
+	load_ms_ = 0.0;
+	::Initialize(output_);
+}
+
+
+void GeometryEngine::SaveOutputIfNeeded()
+{
+	// engines initialized from memory have no output file
+	if (!input_json_.empty())
+	{
+		const auto output_path = GetOutputPath(input_json_);
+		writer_.Enqueue(output_path.string(), [output_path, output = output_]()
+			{
+				return SaveOutput(output_path, output);
+			});
+	}
+	if (!input_.result_shm.empty() && !SaveSharedMarginline(input_.result_shm, output_))
+	{
+		std::cout << "failed to write the result to shared memory\n";
+	}
+}
+
+
+bool GeometryEngine::Initialize(const std::filesystem::path& input_json)
+{
+	Reset();
+	input_json_ = input_json;
+	const auto start = Clock::now();
 
 	try
 	{
-		::Initialize(output_);
 		std::ifstream ifs(input_json);
 		if (!ifs.is_open())
 		{
 			output_.return_code = ToInt(ReturnCode::kInvalidInput);
 			output_.message = "failed to open input json: " + input_json.string();
 
-			SaveOutput(GetOutputPath(input_json_), output_);
+			SaveOutputIfNeeded();
 
 			return false;
 		}
@@ -71,34 +156,80 @@ bool GeometryEngine::Initialize(const std::filesystem::path& input_json)
 		ifs.close();
 		std::cout << "input json is loaded\n";
 
+		if (input_.model.type == "shm")
+		{
+			if (!LoadSharedMesh(input_.model.data, V_, F_))
+			{
+				output_.return_code = ToInt(ReturnCode::kInvalidModel);
+				output_.message = "failed to load model from shared memory: " + input_.model.data;
+
+				SaveOutputIfNeeded();
+
+				return false;
+			}
+			std::cout << "model is loaded from shared memory\n";
+
+			return InitializeMesh(start);
+		}
+
 		std::stringstream model_filename;
 		model_filename << "model" << input_.model.type;
 		auto filepath = input_json.parent_path() / model_filename.str();
-		if (!LoadModel(filepath, V_, F_))
+		// .gem files may hold the adjacency list, igl::adjacency_list is skipped then
+		auto is_loaded = input_.model.type == ".gem" ? LoadGem(filepath, V_, F_, &adjacency_list_) : LoadModel(filepath, V_, F_);
+		if (!is_loaded)
 		{
 			output_.return_code = ToInt(ReturnCode::kInvalidInput);
 			output_.message = "failed to open model: " + filepath.string();
 
-			SaveOutput(GetOutputPath(input_json_), output_);
+			SaveOutputIfNeeded();
 
 			return false;
 		}
 		std::cout << "model is loaded\n";
 
-		igl::adjacency_list(F_, adjacency_list_);
-		std::cout << "adjacency list is created\n";
+		return InitializeMesh(start);
+	}
+	catch (const std::exception& e)
+	{
+		output_.return_code = ToInt(ReturnCode::kUnknownError);
+		output_.message = e.what();
+
+		SaveOutputIfNeeded();
+
+		std::cout << "failed to initialize geometry engine\n";
+		return false;
+	}
+}
+
+
+bool GeometryEngine::Initialize(const GeometryEngineInput& input, VectorArray V, IndicesArray F)
+{
+	Reset();
+	const auto start = Clock::now();
+	input_ = input;
+	V_ = std::move(V);
+	F_ = std::move(F);
+
+	try
+	{
+		if (V_.cols() != 3 || F_.cols() != 3 || (F_.size() > 0 && (F_.minCoeff() < 0 || F_.maxCoeff() >= V_.rows())))
+		{
+			output_.return_code = ToInt(ReturnCode::kInvalidModel);
+			output_.message = "invalid mesh: vertices must have 3 coordinates and faces must be triangles of existing vertices";
 
-		std::cout << "done to initialize geometry engine\n";
+			SaveOutputIfNeeded();
 
-		is_initialized_ = true;
-		return true;
+			return false;
+		}
+		return InitializeMesh(start);
 	}
 	catch (const std::exception& e)
 	{
 		output_.return_code = ToInt(ReturnCode::kUnknownError);
 		output_.message = e.what();
 
-		SaveOutput(GetOutputPath(input_json_), output_);
+		SaveOutputIfNeeded();
 
 		std::cout << "failed to initialize geometry engine\n";
 		return false;
@@ -106,17 +237,90 @@ bool GeometryEngine::Initialize(const std::filesystem::path& input_json)
 }
 
 
+bool GeometryEngine::InitializeMesh(std::chrono::steady_clock::time_point start)
+{
+	auto ordering = VertexOrdering::kNone;
+	try
+	{
+		ordering = ToVertexOrdering(input_.model.reorder);
+	}
+	catch (const std::invalid_argument& e)
+	{
+		output_.return_code = ToInt(ReturnCode::kInvalidInput);
+		output_.message = e.what();
+
+		SaveOutputIfNeeded();
+
+		return false;
+	}
+
+	if (adjacency_list_.empty())
+	{
+		igl::adjacency_list(F_, adjacency_list_);
+		// igl sizes the list by the largest index in F, vertices after it that no face uses have no neighbours
+		adjacency_list_.resize(V_.rows());
+		std::cout << "adjacency list is created\n";
+	}
+
+	original_vertex_indices_ = ComputeVertexOrdering(V_, adjacency_list_, ordering);
+	if (ordering != VertexOrdering::kNone)
+	{
+		ReorderMesh(original_vertex_indices_, V_, F_, adjacency_list_);
+		std::cout << "model is reordered (" << input_.model.reorder << ")\n";
+	}
+	packed_V_ = ToPacked(V_);
+	vertex_indices_.resize(original_vertex_indices_.size());
+	for (size_t i = 0; i < original_vertex_indices_.size(); ++i)
+	{
+		vertex_indices_[original_vertex_indices_[i]] = static_cast<int>(i);
+	}
+	vertex_faces_ = BuildVertexFaces(F_, V_.rows());
+	is_mesh_hash_valid_ = false;
+	picker_.Clear();
+	load_ms_ = ElapsedMs(start);
+
+	std::cout << "done to initialize geometry engine\n";
+
+	is_initialized_ = true;
+	return true;
+}
+
+
+
+std::uint64_t GeometryEngine::MeshHash()
+{
+	if (!is_mesh_hash_valid_)
+	{
+		mesh_hash_ = HashMesh(V_, F_);
+		is_mesh_hash_valid_ = true;
+	}
+	return mesh_hash_;
+}
+
+
+const MeshPicker& GeometryEngine::picker()
+{
+	if (picker_.empty() && is_initialized_)
+	{
+		picker_.Build(V_, F_);
+		std::cout << "done to build the picking tree of " << F_.rows() << " faces\n";
+	}
+	return picker_;
+}
+
 
 GeometryEngineOutput GeometryEngine::Run()
 {
 	::Initialize(output_);
+	const auto start = Clock::now();
+	output_.metrics.load_ms = load_ms_;
 
 	if (!is_initialized_)
 	{
 		output_.return_code = ToInt(ReturnCode::kInvalidModel);
 		output_.message = " is not initialized";
 
-		SaveOutput(GetOutputPath(input_json_), output_);
+		SaveOutputIfNeeded();
 
 		return output_;
 	}
@@ -126,50 +330,347 @@ GeometryEngineOutput GeometryEngine::Run()
 		output_.return_code = ToInt(ReturnCode::kInvalidInput);
 		output_.message = "invalid operation type: " + input_.operation.type + " (expected: marginline)";
 
-		SaveOutput(GetOutputPath(input_json_), output_);
+		SaveOutputIfNeeded();
+
+		return output_;
+	}
+
+	if (input_.operation.marginline.smoothing_iterations < 0 || input_.operation.marginline.smoothing_iterations > MAX_SMOOTHING_ITERATIONS)
+	{
+		output_.return_code = ToInt(ReturnCode::kInvalidInput);
+		output_.message = "smoothing_iterations must be in [0, " + std::to_string(MAX_SMOOTHING_ITERATIONS) + "]";
+
+		SaveOutputIfNeeded();
+
+		return output_;
+	}
+
+	const auto& tracer = input_.operation.marginline.tracer;
+	if (tracer != "greedy" && tracer != "ridge" && tracer != "bidirectional")
+	{
+		output_.return_code = ToInt(ReturnCode::kInvalidInput);
+		output_.message = "invalid tracer: " + tracer + " (expected: greedy, ridge or bidirectional)";
+
+		SaveOutputIfNeeded();
 
 		return output_;
 	}
 
+	// the segment is written by the tiled computation only
+	if (!input_.operation.curvature.output.empty() && input_.operation.curvature.tile_vertices <= 0)
+	{
+		output_.return_code = ToInt(ReturnCode::kInvalidInput);
+		output_.message = "curvature.output needs curvature.tile_vertices > 0";
+
+		SaveOutputIfNeeded();
+
+		return output_;
+	}
+
+	auto estimator = CurvatureEstimator::kQuadricFitting;
 	try
 	{
-		CalcCurvatures(V_, F_, curvature_info_);
-		auto minH = curvature_info_.mean.minCoeff();
-		auto maxH = curvature_info_.mean.maxCoeff();
-		std::cout << "done to calculate curvatures\n";
+		estimator = ToCurvatureEstimator(input_.operation.curvature.estimator);
+	}
+	catch (const std::invalid_argument& e)
+	{
+		output_.return_code = ToInt(ReturnCode::kInvalidInput);
+		output_.message = e.what();
 
-#ifdef _DEBUG
-		std::cout << "minH: " << minH << "\n";
-		std::cout << "maxH: " << maxH << "\n";
+		SaveOutputIfNeeded();
+
+		return output_;
+	}
+
+	// streaming the curvature is a side effect of the run, and the bidirectional tracer may give another line on each run,
+	// so such runs are neither looked up nor stored
+	std::string cache_key;
+	if (result_cache_ != nullptr && input_.operation.curvature.output.empty() && tracer != "bidirectional")
+	{
+		cache_key = MakeResultCacheKey(MeshHash(), input_.operation);
 
-		auto json_filepath = input_json_.parent_path() / "curvatures.json";
-		if (!SaveCurvatures(json_filepath, curvature_info_))
+		std::string cached;
+		if (result_cache_->Find(cache_key, cached))
 		{
-			std::cout << "failed to save curvatures\n";
+			output_ = nlohmann::json::parse(cached);
+			output_.metrics = GeometryEngineOutput::Metrics{ load_ms_, 0.0, 0.0, 0.0, ElapsedMs(start), 0, {} };
+			std::cout << "result is found in the cache\n";
+			SendFinalProgress(progress_callback_, output_.result.marginline.points);
+
+			SaveOutputIfNeeded();
+
+			return output_;
 		}
+	}
 
-		auto vtk_filepath = std::filesystem::path(input_json_).replace_extension(".vtk");
-		if (!SaveVtk(vtk_filepath, V_, F_, curvature_info_))
+	// counters follow the thread that opened them, so they are opened by each run
+	std::unique_ptr<PerfCounters> counters;
+	if (is_perf_enabled_)
+	{
+		counters = std::make_unique<PerfCounters>();
+		if (!counters->IsAvailable())
 		{
-			std::cout << "failed to save vtk file\n";
+			std::cout << "event counters are not available: " << counters->error() << "\n";
+			counters.reset();
+		}
+	}
+	auto start_counters = [&counters]()
+		{
+			if (counters)
+			{
+				counters->Start();
+			}
+		};
+	auto stop_counters = [this, &counters](const std::string& stage)
+		{
+			if (counters)
+			{
+				const auto c = counters->Stop();
+				output_.metrics.counters.push_back({ stage, c.cycles, c.instructions, c.cache_misses, c.branch_misses, c.page_faults });
+			}
+		};
+
+	const Deadline deadline(input_.operation.deadline_ms, cancel_);
+	try
+	{
+		// scratch containers below take their memory from the arena, released in one go when the try block ends
+		JobArena::Job job(arena_);
+
+		// curvature of another estimator is recalculated, edits are updated locally for the quadric fitting only.
+		// curvature is streamed again on every run that asks for it, and mapped curvature is not updated in place
+		const auto& curvature_operation = input_.operation.curvature;
+		if (estimator != curvature_estimator_
+			|| (estimator != CurvatureEstimator::kQuadricFitting && !dirty_vertices_.empty())
+			|| !curvature_operation.output.empty()
+			|| (curvature_memory_.is_open() && !dirty_vertices_.empty()))
+		{
+			is_curvature_valid_ = false;
 		}
-#endif
 
+		auto stage_start = Clock::now();
+		start_counters();
+		if (!is_curvature_valid_)
+		{
+			// the tiles compute their own normals, the vertex normals of the whole mesh are built for the untiled path only
+			N_.resize(0, 3);
+			curvature_memory_.Close();
+			bool is_calculated = false;
+			if (curvature_operation.tile_vertices > 0)
+			{
+				TiledCurvatureOptions options;
+				options.tile_vertices = curvature_operation.tile_vertices;
+				options.estimator = estimator;
+				// the streamed rows follow the model file, the tracers read them in place through the row of each engine vertex
+				if (curvature_operation.output.empty())
+				{
+					is_calculated = CalcCurvaturesTiled(V_, F_, adjacency_list_, vertex_faces_, options, curvature_info_, deadline);
+				}
+				else
+				{
+					::Initialize(curvature_info_);
+					is_calculated = CalcCurvaturesTiled(V_, F_, adjacency_list_, vertex_faces_, options, curvature_operation.output, original_vertex_indices_, deadline)
+						&& MapCurvatures(curvature_operation.output, original_vertex_indices_, curvature_memory_, mapped_curvature_);
+				}
+			}
+			else
+			{
+				CalcVertexNormals(V_, F_, N_);
+				is_calculated = CalcCurvatures(V_, packed_V_, F_, adjacency_list_, N_, estimator, curvature_info_, deadline);
+			}
+			if (!is_calculated && !deadline.IsExceeded())
+			{
+				output_.return_code = ToInt(ReturnCode::kInvalidInput);
+				output_.message = "failed to stream curvature to " + curvature_operation.output;
+				output_.metrics.arena_bytes = arena_.job_bytes();
+
+				SaveOutputIfNeeded();
+
+				return output_;
+			}
+			if (!is_calculated)
+			{
+				SetInterrupted(deadline, "curvature");
+				output_.metrics.curvature_ms = ElapsedMs(stage_start);
+				output_.metrics.arena_bytes = arena_.job_bytes();
+				stop_counters("curvature");
+				output_.metrics.total_ms = ElapsedMs(start);
+
+				SaveOutputIfNeeded();
+
+				return output_;
+			}
+			is_curvature_valid_ = true;
+			curvature_estimator_ = estimator;
+			is_ridge_graph_valid_ = false;
+			std::cout << "done to calculate curvatures\n";
+		}
+		else if (!dirty_vertices_.empty())
+		{
+			std::sort(dirty_vertices_.begin(), dirty_vertices_.end());
+			dirty_vertices_.erase(std::unique(dirty_vertices_.begin(), dirty_vertices_.end()), dirty_vertices_.end());
+			if (N_.rows() != V_.rows())
+			{
+				CalcVertexNormals(V_, F_, N_);
+			}
+			UpdateCurvatures(V_, packed_V_, F_, adjacency_list_, vertex_faces_, dirty_vertices_, N_, curvature_info_);
+			is_ridge_graph_valid_ = false;
+			std::cout << "done to update curvatures around " << dirty_vertices_.size() << " edited vertices\n";
+		}
+		dirty_vertices_.clear();
+		output_.metrics.curvature_ms = ElapsedMs(stage_start);
+		stop_counters("curvature");
+
+		stage_start = Clock::now();
+		start_counters();
 		auto seed = Convert(input_.operation.marginline.seed);
-		auto nearest_vertex = FindNearestVertex(V_, F_, seed);
+		auto nearest_vertex = picker().FindNearestVertex(seed);
+		const auto is_ridge_tracer = tracer == "ridge";
+		if (is_ridge_tracer && !is_ridge_graph_valid_)
+		{
+			BuildRidgeGraph(packed_V_, adjacency_list_, curvature(), RidgeGraphOptions(), ridge_graph_);
+			is_ridge_graph_valid_ = true;
+			std::cout << "done to build the ridge graph of " << ridge_graph_.vertices.size() << " vertices\n";
+		}
+
+		// traced points are streamed in batches, the first one holds the seed so that it arrives right away
+		std::pmr::vector<double> pending(&arena_);
+		size_t num_batches = 0;
+		bool is_aborted = false;
+		auto flush_progress = [&]()
+		{
+			if (!pending.empty() && !is_aborted)
+			{
+				is_aborted = !progress_callback_(pending.data(), pending.size() / 3, false);
+				pending.clear();
+				++num_batches;
+			}
+			return !is_aborted;
+		};
+		MarginlineStepCallback on_step;
+		if (progress_callback_)
+		{
+			pending.reserve(3 * progress_batch_size_);
+			on_step = [&](int vertex)
+			{
+				pending.insert(pending.end(), { packed_V_(vertex, 0), packed_V_(vertex, 1), packed_V_(vertex, 2) });
+				return (num_batches > 0 && pending.size() < 3 * progress_batch_size_) || flush_progress();
+			};
+		}
 
+		// a margin line interrupted while tracing is still exported as it is
 		std::vector<int> marginline{ nearest_vertex };
-		std::set<int> visited;
-		CreateMarginline(V_, F_, adjacency_list_, curvature_info_, marginline, visited);
+		std::pmr::set<int> visited(&arena_);
+		const auto traced_curvature = curvature();
+		auto trace = [&]()
+		{
+			if (is_ridge_tracer)
+			{
+				return CreateMarginlineOnRidges(packed_V_, adjacency_list_, traced_curvature, ridge_graph_, marginline, visited, deadline, on_step);
+			}
+			if (tracer == "bidirectional")
+			{
+				return CreateMarginlineBidirectional(packed_V_, adjacency_list_, traced_curvature, marginline, visited, deadline, on_step);
+			}
+			return CreateMarginline(packed_V_, F_, adjacency_list_, traced_curvature, marginline, visited, deadline, on_step);
+		};
+		if ((on_step && !on_step(nearest_vertex)) || !trace())
+		{
+			if (is_aborted)
+			{
+				output_.return_code = ToInt(ReturnCode::kCancelled);
+				output_.message = "aborted by the progress callback in traversal";
+				output_.interrupted_stage = "traversal";
+				std::cout << output_.message << "\n";
+			}
+			else
+			{
+				SetInterrupted(deadline, "traversal");
+			}
+		}
+		if (on_step)
+		{
+			flush_progress();
+		}
+		output_.metrics.traversal_ms = ElapsedMs(stage_start);
+		stop_counters("traversal");
+
+		stage_start = Clock::now();
+		start_counters();
 
 		auto num_samples = input_.operation.marginline.num_samples;
 		auto threshold_to_remove_last_point = input_.operation.marginline.threshold_to_remove_last_point;
-		auto downsampled = DownSampleMarginline(V_, F_, adjacency_list_, curvature_info_, marginline, visited, num_samples, threshold_to_remove_last_point);
+		auto downsampled = DownSampleMarginline(packed_V_, F_, adjacency_list_, traced_curvature, marginline, visited, num_samples, threshold_to_remove_last_point);
 		
 		output_.result.type = "marginline";
 		output_.result.marginline.num_original_points = marginline.size();
 		output_.result.marginline.num_samples = downsampled.size();
-		output_.result.marginline.points = Convert(V_, downsampled);
+		output_.result.marginline.points = Convert(packed_V_, downsampled);
+		SendFinalProgress(progress_callback_, output_.result.marginline.points);
+
+		auto smoothing_iterations = input_.operation.marginline.smoothing_iterations;
+		if (smoothing_iterations > 0 && downsampled.size() > 1)
+		{
+			// a closed margin line ends at its seed, the repeated point is dropped before smoothing
+			auto is_closed = marginline.size() > 3 && marginline.front() == marginline.back();
+			const auto& points = output_.result.marginline.points;
+			auto num_points = is_closed && points.front() == points.back() ? points.size() - 1 : points.size();
+			PackedVectorArray samples(num_points, 3);
+			for (size_t i = 0; i < num_points; ++i)
+			{
+				samples.row(i) << points[i][0], points[i][1], points[i][2];
+			}
+			auto smoothed = ChaikinSmoothing(samples, smoothing_iterations, is_closed);
+			output_.result.marginline.smoothed_points.resize(smoothed.rows());
+			for (Eigen::Index i = 0; i < smoothed.rows(); ++i)
+			{
+				output_.result.marginline.smoothed_points[i] = { smoothed(i, 0), smoothed(i, 1), smoothed(i, 2) };
+			}
+		}
+
+		// export stops at the first check past the deadline, the result above is kept
+		auto can_export = [this, &deadline]() -> bool
+			{
+				if (output_.interrupted_stage.empty() && deadline.IsExceeded())
+				{
+					SetInterrupted(deadline, "export");
+				}
+				return output_.interrupted_stage.empty();
+			};
+#ifdef _DEBUG
+		// mapped curvature is already in the segment of curvature.output
+		if (!input_json_.empty() && !curvature_memory_.is_open() && can_export())
+		{
+			auto minH = curvature_info_.mean.minCoeff();
+			auto maxH = curvature_info_.mean.maxCoeff();
+			std::cout << "minH: " << minH << "\n";
+			std::cout << "maxH: " << maxH << "\n";
+
+			// per-vertex arrays are dumped in the order of the model file
+			auto original_order_info = RestoreOriginalOrder(original_vertex_indices_, curvature_info_);
+
+			// the dumps own snapshots of the data, so they are written while the next request runs
+			auto json_filepath = input_json_.parent_path() / "curvatures.json";
+			if (can_export())
+			{
+				writer_.Enqueue(json_filepath.string(), [json_filepath, info = std::move(original_order_info)]()
+					{
+						return SaveCurvatures(json_filepath, info);
+					});
+			}
+
+			auto vtk_filepath = std::filesystem::path(input_json_).replace_extension(".vtk");
+			if (can_export())
+			{
+				writer_.Enqueue(vtk_filepath.string(), [vtk_filepath, V = V_, F = F_, info = curvature_info_]()
+					{
+						return SaveVtk(vtk_filepath, V, F, info);
+					});
+			}
+		}
+#endif
+		can_export();
+		output_.metrics.export_ms = ElapsedMs(stage_start);
+		stop_counters("export");
 	}
 	catch (const std::exception& e)
 	{
@@ -177,6 +678,219 @@ GeometryEngineOutput GeometryEngine::Run()
 		output_.message = e.what();
 	}
 
-	SaveOutput(GetOutputPath(input_json_), output_);
+	if (!cache_key.empty() && output_.return_code == ToInt(ReturnCode::kSuccess))
+	{
+		nlohmann::json json_obj = output_;
+		result_cache_->Insert(cache_key, json_obj.dump());
+	}
+
+	output_.metrics.total_ms = ElapsedMs(start);
+	output_.metrics.arena_bytes = arena_.stats().job_bytes;
+	SaveOutputIfNeeded();
 	return output_;
-}
\ No newline at end of file
+}
+
+
+GeometryEngineOutput GeometryEngine::Run(const GeometryEngineInput::Operation& operation)
+{
+	input_.operation = operation;
+	return Run();
+}
+
+
+bool GeometryEngine::FlushWrites()
+{
+	return writer_.Flush();
+}
+
+
+void GeometryEngine::SetInterrupted(const Deadline& deadline, const std::string& stage)
+{
+	const auto is_cancelled = deadline.IsCancelled();
+	output_.return_code = ToInt(is_cancelled ? ReturnCode::kCancelled : ReturnCode::kTimeout);
+	output_.message = (is_cancelled ? "cancelled in " : "deadline exceeded in ") + stage;
+	output_.interrupted_stage = stage;
+	std::cout << output_.message << "\n";
+}
+
+
+bool GeometryEngine::ToVertexIndices(const std::vector<int>& model_indices, std::vector<int>& indices) const
+{
+	indices.clear();
+	indices.reserve(model_indices.size());
+	for (auto index : model_indices)
+	{
+		if (index < 0 || index >= static_cast<int>(vertex_indices_.size()))
+		{
+			std::cout << "vertex index is out of range: " << index << "\n";
+			return false;
+		}
+		indices.push_back(vertex_indices_[index]);
+	}
+	return true;
+}
+
+
+bool GeometryEngine::UpdateVertexPositions(const std::vector<int>& vertices, const VectorArray& positions)
+{
+	if (!is_initialized_)
+	{
+		std::cout << "geometry engine is not initialized\n";
+		return false;
+	}
+	if (positions.rows() != static_cast<Eigen::Index>(vertices.size()) || positions.cols() != 3)
+	{
+		std::cout << "positions must have one row of 3 coordinates per vertex\n";
+		return false;
+	}
+
+	std::vector<int> indices;
+	if (!ToVertexIndices(vertices, indices))
+	{
+		return false;
+	}
+
+	for (size_t i = 0; i < indices.size(); ++i)
+	{
+		V_.row(indices[i]) = positions.row(i);
+		packed_V_.row(indices[i]) = positions.row(i);
+	}
+	dirty_vertices_.insert(dirty_vertices_.end(), indices.begin(), indices.end());
+	is_mesh_hash_valid_ = false;
+	picker_.Clear();
+	return true;
+}
+
+
+bool GeometryEngine::ReplaceFaces(const std::vector<int>& patch_vertices, const IndicesArray& faces)
+{
+	if (!is_initialized_)
+	{
+		std::cout << "geometry engine is not initialized\n";
+		return false;
+	}
+	if (faces.rows() > 0 && faces.cols() != 3)
+	{
+		std::cout << "faces must be triangles\n";
+		return false;
+	}
+
+	std::vector<int> patch;
+	std::vector<int> new_face_vertices(faces.data(), faces.data() + faces.size());
+	std::vector<int> new_faces_indices;
+	if (!ToVertexIndices(patch_vertices, patch) || !ToVertexIndices(new_face_vertices, new_faces_indices))
+	{
+		return false;
+	}
+	IndicesArray new_faces = Eigen::Map<const IndicesArray>(new_faces_indices.data(), faces.rows(), faces.cols());
+
+	// faces whose vertices are all in the patch
+	const std::unordered_set<int> in_patch(patch.begin(), patch.end());
+	std::set<int> removed;
+	for (auto v : patch)
+	{
+		for (auto f : vertex_faces_[v])
+		{
+			if (in_patch.count(F_(f, 0)) && in_patch.count(F_(f, 1)) && in_patch.count(F_(f, 2)))
+			{
+				removed.insert(f);
+			}
+		}
+	}
+
+	std::vector<int> affected(new_faces_indices);
+	auto detach = [this](int f)
+		{
+			for (Eigen::Index j = 0; j < 3; ++j)
+			{
+				auto& incident = vertex_faces_[F_(f, j)];
+				incident.erase(std::remove(incident.begin(), incident.end(), f), incident.end());
+			}
+		};
+	auto attach = [this](int f)
+		{
+			for (Eigen::Index j = 0; j < 3; ++j)
+			{
+				vertex_faces_[F_(f, j)].push_back(f);
+			}
+		};
+	for (auto f : removed)
+	{
+		for (Eigen::Index j = 0; j < 3; ++j)
+		{
+			affected.push_back(F_(f, j));
+		}
+		detach(f);
+	}
+
+	// reuse the rows of removed faces, then grow or compact F
+	auto holes = removed;
+	Eigen::Index next = 0;
+	while (next < new_faces.rows() && !holes.empty())
+	{
+		auto f = *holes.begin();
+		holes.erase(holes.begin());
+		F_.row(f) = new_faces.row(next++);
+		attach(f);
+	}
+	if (next < new_faces.rows())
+	{
+		auto first = F_.rows();
+		F_.conservativeResize(first + new_faces.rows() - next, 3);
+		for (auto f = first; f < F_.rows(); ++f)
+		{
+			F_.row(f) = new_faces.row(next++);
+			attach(static_cast<int>(f));
+		}
+	}
+	// F is column-major, so the remaining holes are filled from the end first and F is shrunk once
+	auto num_faces = static_cast<int>(F_.rows());
+	while (!holes.empty())
+	{
+		auto last = num_faces - 1;
+		if (holes.count(last) == 0)
+		{
+			// move the last face into the first hole
+			auto hole = *holes.begin();
+			holes.erase(holes.begin());
+			detach(last);
+			F_.row(hole) = F_.row(last);
+			attach(hole);
+		}
+		else
+		{
+			holes.erase(last);
+		}
+		--num_faces;
+	}
+	if (num_faces < F_.rows())
+	{
+		F_.conservativeResize(num_faces, 3);
+	}
+
+	// adjacency of the affected vertices, from their incident faces
+	std::sort(affected.begin(), affected.end());
+	affected.erase(std::unique(affected.begin(), affected.end()), affected.end());
+	for (auto v : affected)
+	{
+		auto& neighbors = adjacency_list_[v];
+		neighbors.clear();
+		for (auto f : vertex_faces_[v])
+		{
+			for (Eigen::Index j = 0; j < 3; ++j)
+			{
+				if (F_(f, j) != v)
+				{
+					neighbors.push_back(F_(f, j));
+				}
+			}
+		}
+		std::sort(neighbors.begin(), neighbors.end());
+		neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+	}
+
+	dirty_vertices_.insert(dirty_vertices_.end(), affected.begin(), affected.end());
+	is_mesh_hash_valid_ = false;
+	picker_.Clear();
+	return true;
+}
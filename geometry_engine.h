@@ -1,25 +1,89 @@
 #pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <filesystem>
+#include <functional>
+#include <string>
+#include "async_writer.h"
 #include "input.h"
+#include "job_arena.h"
+#include "mesh_picker.h"
 #include "output.h"
 #include "curvature_info.h"
+#include "ridge_graph.h"
+#include "shared_memory.h"
 
 
 
+class Deadline;
+class ResultCache;
+
+
 class GeometryEngine
 {
+public:
+	/**
+	 * @brief Receives the margin line while Run() traces it
+	 * @param points xyz of the points, 3 values per point. the points traced since the previous call,
+	 *        or the downsampled result on the final call
+	 * @param num_points number of points
+	 * @param is_final true on the last call of a run, which carries the downsampled result
+	 * @return false to abort the run, ignored on the final call
+	 */
+	using ProgressCallback = std::function<bool(const double* points, size_t num_points, bool is_final)>;
+
+private:
 	bool is_initialized_ = false;
 	std::filesystem::path input_json_;
 
 	GeometryEngineInput input_;
 	GeometryEngineOutput output_;
 	VectorArray V_;
-	VectorArray N_;
+	PackedVectorArray packed_V_;	// copy of V_ in packed layout for random per-vertex access
+	PackedVectorArray N_;
 	IndicesArray F_;
 	std::vector<std::vector<int> > adjacency_list_;
+	std::vector<std::vector<int> > vertex_faces_;
+	std::vector<int> original_vertex_indices_;	// original_vertex_indices_[i] is the index of vertex i in the model file
+	std::vector<int> vertex_indices_;	// vertex_indices_[i] is the index of the i-th vertex of the model file
 
 	// curvature info
-	CurvatureInfo curvature_info_;
+	CurvatureInfo curvature_info_;	// empty while the curvature is mapped
+	SharedMemory curvature_memory_;	// segment of curvature.output, kept mapped while its curvature is current
+	CurvatureView mapped_curvature_;	// view of curvature_memory_
+	bool is_curvature_valid_ = false;
+	CurvatureEstimator curvature_estimator_ = CurvatureEstimator::kQuadricFitting;	// estimator curvature_info_ is calculated with
+	std::vector<int> dirty_vertices_;	// vertices edited since curvature was calculated
+
+	// ridge graph of the 'ridge' tracer, built on its first run and again after curvature changes
+	RidgeGraph ridge_graph_;
+	bool is_ridge_graph_valid_ = false;
+
+	MeshPicker picker_;	// built on the first query and again after edits
+
+	const std::atomic<bool>* cancel_ = nullptr;
+
+	// result cache
+	ResultCache* result_cache_ = nullptr;
+	std::uint64_t mesh_hash_ = 0;
+	bool is_mesh_hash_valid_ = false;	// invalidated by edits
+
+	double load_ms_ = 0.0;	// time spent in Initialize, reported in the metrics of each run
+	bool is_perf_enabled_ = false;
+
+	ProgressCallback progress_callback_;
+	size_t progress_batch_size_ = 16;
+
+	AsyncWriter writer_;	// output.json and debug dumps are written in the background
+	JobArena arena_;	// scratch memory of a run, released at its end
+
+	void Reset();
+	bool InitializeMesh(std::chrono::steady_clock::time_point start);
+	void SaveOutputIfNeeded();
+	void SetInterrupted(const Deadline& deadline, const std::string& stage);
+	bool ToVertexIndices(const std::vector<int>& model_indices, std::vector<int>& indices) const;
 
 public:
 	GeometryEngine() = default;
@@ -27,11 +91,114 @@ public:
 
 	const GeometryEngineOutput& output() const { return output_; }
 	VectorArray& V() { return V_; }
-	VectorArray& N() { return N_; }
+	const PackedVectorArray& packed_V() const { return packed_V_; }
+	const PackedVectorArray& N() const { return N_; }
 	IndicesArray& F() { return F_; }
 	std::vector<std::vector<int> >& adjacency_list() { return adjacency_list_; }
-	const CurvatureInfo& curvature_info() const { return curvature_info_; }
+	const std::vector<int>& original_vertex_indices() const { return original_vertex_indices_; }
+	const CurvatureInfo& curvature_info() const { return curvature_info_; }	// empty while the curvature is mapped, see curvature()
+	CurvatureView curvature() const { return curvature_memory_.is_open() ? mapped_curvature_ : CurvatureView(curvature_info_); }	// curvature the tracers read
+	const RidgeGraph& ridge_graph() const { return ridge_graph_; }
+	const JobArena::Stats& arena_stats() const { return arena_.stats(); }
 
+	/**
+	 * @brief Initialize from an input json and the model file next to it
+	 *        the output of Run() is also saved as output.json next to the input json.
+	 * @param input_json path to input.json
+	 * @return true if the model is loaded, false otherwise
+	 */
 	bool Initialize(const std::filesystem::path& input_json);
+
+	/**
+	 * @brief Initialize from a mesh in memory, nothing is read from or written to files
+	 * @param input input parameters, model.type is ignored
+	 * @param V vertices
+	 * @param F faces
+	 * @return true if the mesh is valid, false otherwise
+	 */
+	bool Initialize(const GeometryEngineInput& input, VectorArray V, IndicesArray F);
+
+	/**
+	 * @brief Set a cancel token checked by Run() along with operation.deadline_ms
+	 *        when it becomes true, Run() returns kCancelled with the margin line traced so far.
+	 * @param cancel cancel token set by another thread, null to clear. it must outlive the runs
+	 */
+	void SetCancelToken(const std::atomic<bool>* cancel) { cancel_ = cancel; }
+
+	/**
+	 * @brief Set a cache of results shared with other engines
+	 *        Run() answers from the cache when the same operation was run on the same mesh.
+	 * @param result_cache result cache, null to disable. it must outlive the runs
+	 */
+	void SetResultCache(ResultCache* result_cache) { result_cache_ = result_cache; }
+
+	/**
+	 * @brief Collect event counters (cycles, instructions, cache and branch misses, page faults) of each stage
+	 *        they are reported in the metrics of the output, and left out when the host does not offer them.
+	 * @param enable true to collect them
+	 */
+	void EnablePerfCounters(bool enable) { is_perf_enabled_ = enable; }
+
+	/**
+	 * @brief Stream the margin line while it is traced
+	 *        the first batch holds the seed vertex and is sent right away, the next ones batch_size points each.
+	 *        the final call follows once the result is sampled, also when the traversal was interrupted.
+	 *        when the callback returns false, Run() returns kCancelled with the margin line traced so far.
+	 *        it is called on the thread calling Run().
+	 * @param callback callback, empty to stop streaming
+	 * @param batch_size points per batch
+	 */
+	void SetProgressCallback(ProgressCallback callback, size_t batch_size = 16)
+	{
+		progress_callback_ = std::move(callback);
+		progress_batch_size_ = std::max<size_t>(batch_size, 1);
+	}
+
+	/**
+	 * @brief Hash of the current mesh, computed once and again after edits
+	 * @return hash of the vertices and faces
+	 */
+	std::uint64_t MeshHash();
+
+	/**
+	 * @brief Picking queries on the mesh, the tree is built on the first call and again after edits
+	 *        vertex indices of the queries are engine indices, see original_vertex_indices().
+	 * @return picker of the mesh, empty if the engine is not initialized
+	 */
+	const MeshPicker& picker();
+
 	GeometryEngineOutput Run();
+
+	/**
+	 * @brief Wait until output.json and the debug dumps of the previous runs are written
+	 *        they are also flushed when the engine is destroyed.
+	 * @return true if all of them are written, false otherwise
+	 */
+	bool FlushWrites();
+
+	/**
+	 * @brief Run another operation on the same mesh, curvature is reused
+	 * @param operation operation to run
+	 * @return output of the operation
+	 */
+	GeometryEngineOutput Run(const GeometryEngineInput::Operation& operation);
+
+	/**
+	 * @brief Replace positions of vertices
+	 *        curvature is updated around the moved vertices on the next Run().
+	 * @param vertices vertex indices in the model file
+	 * @param positions new positions, one row per vertex
+	 * @return true if the edit is applied, false otherwise
+	 */
+	bool UpdateVertexPositions(const std::vector<int>& vertices, const VectorArray& positions);
+
+	/**
+	 * @brief Replace the faces of a patch
+	 *        faces whose vertices are all in the patch are removed and the new faces are added.
+	 *        curvature is updated around the patch on the next Run().
+	 * @param patch_vertices vertex indices in the model file
+	 * @param faces new faces with vertex indices in the model file, empty to trim the patch
+	 * @return true if the edit is applied, false otherwise
+	 */
+	bool ReplaceFaces(const std::vector<int>& patch_vertices, const IndicesArray& faces);
 };
@@ -0,0 +1,221 @@
+#include "geometry_engine_c.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <new>
+#include <string>
+#include "geometry_engine.h"
+#include "result_cache.h"
+#include "return_code.h"
+
+
+struct ge_engine
+{
+	GeometryEngine engine;
+	GeometryEngineInput input;
+	std::string message;
+	std::atomic<bool> cancel{ false };
+
+	ge_engine()
+	{
+		engine.SetCancelToken(&cancel);
+	}
+};
+
+
+struct ge_result_cache
+{
+	ResultCache cache;
+
+	ge_result_cache(size_t capacity, const char* directory)
+		: cache(capacity, directory != nullptr ? std::filesystem::path(directory) : std::filesystem::path())
+	{
+	}
+};
+
+
+namespace
+{
+	int Fail(ge_engine* engine, ReturnCode code, const std::string& message)
+	{
+		engine->message = message;
+		return ToInt(code);
+	}
+}
+
+
+int ge_api_version(void)
+{
+	return GE_API_VERSION;
+}
+
+
+ge_engine* ge_create(void)
+{
+	return new (std::nothrow) ge_engine();
+}
+
+
+void ge_destroy(ge_engine* engine)
+{
+	delete engine;
+}
+
+
+int ge_set_mesh(ge_engine* engine, const double* vertices, size_t num_vertices, const int* faces, size_t num_faces, const char* reorder)
+{
+	if (engine == nullptr)
+	{
+		return ToInt(ReturnCode::kInvalidInput);
+	}
+	if (vertices == nullptr || faces == nullptr || num_vertices == 0 || num_faces == 0)
+	{
+		return Fail(engine, ReturnCode::kInvalidModel, "empty mesh");
+	}
+
+	try
+	{
+		// buffers are row-major xyz, the engine stores vertices column by column
+		VectorArray V = Eigen::Map<const PackedVectorArray>(vertices, num_vertices, 3);
+		IndicesArray F = Eigen::Map<const Eigen::Matrix<int, Eigen::Dynamic, 3, Eigen::RowMajor>>(faces, num_faces, 3);
+
+		engine->input = GeometryEngineInput();
+		engine->input.model.type = "memory";
+		engine->input.model.reorder = reorder != nullptr ? reorder : "none";
+		if (!engine->engine.Initialize(engine->input, std::move(V), std::move(F)))
+		{
+			const auto& output = engine->engine.output();
+			engine->message = output.message;
+			return output.return_code;
+		}
+		engine->message.clear();
+		return ToInt(ReturnCode::kSuccess);
+	}
+	catch (const std::exception& e)
+	{
+		return Fail(engine, ReturnCode::kUnknownError, e.what());
+	}
+}
+
+
+int ge_run_marginline(ge_engine* engine, const ge_marginline_params* params, ge_marginline_result* result)
+{
+	if (engine == nullptr)
+	{
+		return ToInt(ReturnCode::kInvalidInput);
+	}
+	if (params == nullptr || result == nullptr)
+	{
+		return Fail(engine, ReturnCode::kInvalidInput, "params and result are required");
+	}
+
+	try
+	{
+		GeometryEngineInput::Operation operation;
+		operation.type = "marginline";
+		operation.marginline.type = "coordinate";
+		operation.marginline.seed = { params->seed[0], params->seed[1], params->seed[2] };
+		operation.marginline.num_samples = params->num_samples;
+		operation.marginline.threshold_to_remove_last_point = params->threshold_to_remove_last_point;
+		operation.deadline_ms = params->deadline_ms;
+
+		// a cancel issued before the run stops it, the flag is cleared once the run is over
+		const auto& output = engine->engine.Run(operation);
+		engine->cancel = false;
+		const auto is_interrupted = !output.interrupted_stage.empty();
+		if (output.return_code != ToInt(ReturnCode::kSuccess) && !is_interrupted)
+		{
+			engine->message = output.message;
+			return output.return_code;
+		}
+
+		const auto& points = output.result.marginline.points;
+		result->num_points = points.size();
+		result->num_original_points = output.result.marginline.num_original_points;
+		if (result->points == nullptr || result->capacity < points.size())
+		{
+			// an interrupted run keeps its code, the required capacity is in num_points
+			const auto message = "result buffer is too small: " + std::to_string(points.size()) + " points are required";
+			return is_interrupted ? Fail(engine, static_cast<ReturnCode>(output.return_code), output.message + ", " + message) : Fail(engine, ReturnCode::kBufferTooSmall, message);
+		}
+		for (size_t i = 0; i < points.size(); ++i)
+		{
+			std::copy_n(points[i].begin(), 3, result->points + 3 * i);
+		}
+		engine->message = output.message;
+		return output.return_code;
+	}
+	catch (const std::exception& e)
+	{
+		return Fail(engine, ReturnCode::kUnknownError, e.what());
+	}
+}
+
+
+void ge_cancel(ge_engine* engine)
+{
+	if (engine != nullptr)
+	{
+		engine->cancel = true;
+	}
+}
+
+
+void ge_set_progress_callback(ge_engine* engine, ge_progress_callback callback, size_t batch_size, void* user_data)
+{
+	if (engine == nullptr)
+	{
+		return;
+	}
+	if (callback == nullptr)
+	{
+		engine->engine.SetProgressCallback(nullptr);
+		return;
+	}
+	auto forward = [callback, user_data](const double* points, size_t num_points, bool is_final)
+	{
+		return callback(points, num_points, is_final ? 1 : 0, user_data) != 0;
+	};
+	if (batch_size > 0)
+	{
+		engine->engine.SetProgressCallback(forward, batch_size);
+	}
+	else
+	{
+		engine->engine.SetProgressCallback(forward);
+	}
+}
+
+
+ge_result_cache* ge_result_cache_create(size_t capacity, const char* directory)
+{
+	try
+	{
+		return new ge_result_cache(capacity, directory);
+	}
+	catch (const std::exception&)
+	{
+		return nullptr;
+	}
+}
+
+
+void ge_result_cache_destroy(ge_result_cache* cache)
+{
+	delete cache;
+}
+
+
+void ge_set_result_cache(ge_engine* engine, ge_result_cache* cache)
+{
+	if (engine != nullptr)
+	{
+		engine->engine.SetResultCache(cache != nullptr ? &cache->cache : nullptr);
+	}
+}
+
+
+const char* ge_last_message(const ge_engine* engine)
+{
+	return engine != nullptr ? engine->message.c_str() : "";
+}
@@ -0,0 +1,150 @@
+#pragma once
+/**
+ * C API of the geometry engine
+ * meshes and results are passed in memory, nothing is read from or written to files.
+ * all functions return one of the return codes in return_code.h (0 on success).
+ */
+#include <stddef.h>
+
+#if defined(_WIN32)
+#if defined(GEOMETRY_ENGINE_C_EXPORTS)
+#define GE_API __declspec(dllexport)
+#else
+#define GE_API __declspec(dllimport)
+#endif
+#else
+#define GE_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GE_API_VERSION 4
+
+
+typedef struct ge_engine ge_engine;
+typedef struct ge_result_cache ge_result_cache;
+
+
+/**
+ * @brief Parameters of the marginline operation, see GeometryEngineInput::Operation::Marginline
+ */
+typedef struct ge_marginline_params
+{
+	double seed[3];	// seed point
+	int num_samples;	// number of samples
+	double threshold_to_remove_last_point;	// threshold to remove last point
+	double deadline_ms;	// time limit in milliseconds, 0 for no limit
+} ge_marginline_params;
+
+
+/**
+ * @brief Result of the marginline operation, points are written to a buffer owned by the caller
+ */
+typedef struct ge_marginline_result
+{
+	double* points;	// [i] buffer of capacity * 3 doubles, xyz of each point
+	size_t capacity;	// [i] number of points the buffer can hold
+	size_t num_points;	// [o] number of points, also set when the buffer is too small
+	size_t num_original_points;	// [o] number of points before downsampling
+} ge_marginline_result;
+
+
+/**
+ * @brief Callback receiving the margin line while it is traced, see GeometryEngine::SetProgressCallback
+ * @param points [i] xyz of each point, valid during the call only
+ * @param num_points [i] number of points
+ * @param is_final [i] nonzero on the last call of a run, which carries the downsampled result
+ * @param user_data [i] user data given to ge_set_progress_callback
+ * @return nonzero to continue, 0 to abort the run with kCancelled. ignored on the final call
+ */
+typedef int (*ge_progress_callback)(const double* points, size_t num_points, int is_final, void* user_data);
+
+
+/**
+ * @brief Version of the API the library is built with
+ * @return GE_API_VERSION
+ */
+GE_API int ge_api_version(void);
+
+/**
+ * @brief Create an engine
+ * @return engine, NULL on failure
+ */
+GE_API ge_engine* ge_create(void);
+
+/**
+ * @brief Destroy an engine
+ * @param engine [i] engine created by ge_create, may be NULL
+ */
+GE_API void ge_destroy(ge_engine* engine);
+
+/**
+ * @brief Set the mesh of an engine, the buffers are copied
+ * @param engine [i] engine
+ * @param vertices [i] xyz of each vertex, num_vertices * 3 doubles
+ * @param num_vertices [i] number of vertices
+ * @param faces [i] vertex indices of each triangle, num_faces * 3 ints
+ * @param num_faces [i] number of faces
+ * @param reorder [i] vertex ordering, "none", "morton" or "rcm". NULL for "none"
+ * @return return code
+ */
+GE_API int ge_set_mesh(ge_engine* engine, const double* vertices, size_t num_vertices, const int* faces, size_t num_faces, const char* reorder);
+
+/**
+ * @brief Create the margin line, curvature is calculated on the first call and reused afterwards
+ * @param engine [i] engine with a mesh
+ * @param params [i] parameters
+ * @param result [i/o] result, num_points is set to the required capacity if the buffer is too small
+ * @return return code. on kTimeout and kCancelled the result holds the margin line traced so far,
+ *         unless the buffer is too small for it: the code is kept then, and num_points exceeds capacity
+ */
+GE_API int ge_run_marginline(ge_engine* engine, const ge_marginline_params* params, ge_marginline_result* result);
+
+/**
+ * @brief Cancel the run in progress, or the next run when none is in progress. may be called from another thread
+ * @param engine [i] engine
+ */
+GE_API void ge_cancel(ge_engine* engine);
+
+/**
+ * @brief Stream the margin line of the next runs to a callback, called on the thread of ge_run_marginline
+ * @param engine [i] engine
+ * @param callback [i] callback, NULL to stop streaming
+ * @param batch_size [i] points per batch after the first one, which holds the seed. 0 for the default
+ * @param user_data [i] passed to the callback as it is
+ */
+GE_API void ge_set_progress_callback(ge_engine* engine, ge_progress_callback callback, size_t batch_size, void* user_data);
+
+/**
+ * @brief Create a result cache that may be shared between engines on any thread
+ * @param capacity [i] capacity in bytes
+ * @param directory [i] directory of an on-disk store shared between processes, NULL for in-process only
+ * @return result cache, NULL on failure
+ */
+GE_API ge_result_cache* ge_result_cache_create(size_t capacity, const char* directory);
+
+/**
+ * @brief Destroy a result cache, after the engines using it
+ * @param cache [i] result cache created by ge_result_cache_create, may be NULL
+ */
+GE_API void ge_result_cache_destroy(ge_result_cache* cache);
+
+/**
+ * @brief Set the result cache of an engine, repeated runs of the same parameters on the same mesh are answered from it
+ * @param engine [i] engine
+ * @param cache [i] result cache, NULL to disable
+ */
+GE_API void ge_set_result_cache(ge_engine* engine, ge_result_cache* cache);
+
+/**
+ * @brief Message of the last failed call
+ * @param engine [i] engine
+ * @return null-terminated message owned by the engine, valid until the next call
+ */
+GE_API const char* ge_last_message(const ge_engine* engine);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,269 @@
+/**
+ * Python module of the geometry engine, built with -DGEOMETRY_ENGINE_BUILD_PYTHON=ON
+ * calc_curvatures reads C-contiguous float64 vertices in place for the quadric fitting, and copies them once into the column-major
+ * array the angle defect, the vertex normals and the normal cycles read. faces are always copied, the kernels read them column-major.
+ * Engine copies both, it owns its mesh (reordered on request) and outlives the NumPy arrays. other dtypes or layouts are converted first.
+ * per-vertex curvature is returned as read-only views of the engine.
+ * the GIL is released while curvature and margin lines are computed, so engines can run on several Python threads.
+ */
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <igl/adjacency_list.h>
+#include <pybind11/eigen.h>
+#include <pybind11/pybind11.h>
+#include "curvature_info.h"
+#include "geometry_engine.h"
+#include "geometry_utils.h"
+#include "return_code.h"
+
+namespace py = pybind11;
+
+
+namespace
+{
+	using PackedIndicesArray = Eigen::Matrix<int, Eigen::Dynamic, 3, Eigen::RowMajor>;
+
+	// C-contiguous float64 (n, 3) and int32 (m, 3) arrays are bound without a conversion
+	using VerticesRef = PackedVectorView;
+	using FacesRef = Eigen::Ref<const PackedIndicesArray>;
+
+
+	/**
+	 * @brief Raise the error of a failed run as a Python exception
+	 * @param output output of the engine
+	 */
+	[[noreturn]] void ThrowError(const GeometryEngineOutput& output)
+	{
+		const auto message = output.message + " (return code " + std::to_string(output.return_code) + ")";
+		if (output.return_code == ToInt(ReturnCode::kInvalidInput) || output.return_code == ToInt(ReturnCode::kInvalidModel))
+		{
+			throw py::value_error(message);
+		}
+		throw std::runtime_error(message);
+	}
+
+
+	/**
+	 * @brief Check that faces are triangles of existing vertices
+	 * @param num_vertices number of vertices
+	 * @param faces faces
+	 */
+	void CheckFaces(Eigen::Index num_vertices, const FacesRef& faces)
+	{
+		if (num_vertices == 0 || faces.rows() == 0)
+		{
+			throw py::value_error("empty mesh");
+		}
+		if (faces.minCoeff() < 0 || faces.maxCoeff() >= num_vertices)
+		{
+			throw py::value_error("faces must be triangles of existing vertices");
+		}
+	}
+
+
+	/**
+	 * @brief Convert points of the output to xyz rows
+	 * @param points points of the output
+	 * @return (n, 3) array, handed to NumPy without a copy
+	 */
+	PackedVectorArray ToPoints(const std::vector<std::vector<double>>& points)
+	{
+		PackedVectorArray P(points.size(), 3);
+		for (size_t i = 0; i < points.size(); ++i)
+		{
+			P.row(i) << points[i][0], points[i][1], points[i][2];
+		}
+		return P;
+	}
+
+
+	/**
+	 * @brief Calculate curvature information of a mesh
+	 * @param vertices (n, 3) vertex positions
+	 * @param faces (m, 3) vertex indices of the triangles
+	 * @param estimator "quadric" or "normal_cycle"
+	 * @param deadline_ms time limit in milliseconds, 0 for no limit
+	 * @return curvature information, its arrays become views owned by the returned object
+	 */
+	CurvatureInfo CalcCurvaturesOf(const VerticesRef& vertices, const FacesRef& faces, const std::string& estimator, double deadline_ms)
+	{
+		CheckFaces(vertices.rows(), faces);
+		const auto curvature_estimator = ToCurvatureEstimator(estimator);
+
+		CurvatureInfo curvature_info;
+		bool is_calculated = false;
+		{
+			py::gil_scoped_release release;
+			// the quadric fitting reads the packed vertices as they are, the other kernels column by column
+			const VectorArray V = vertices;
+			const IndicesArray F = faces;
+			std::vector<std::vector<int>> adjacency_list;
+			igl::adjacency_list(F, adjacency_list);
+			adjacency_list.resize(V.rows());
+			PackedVectorArray N;
+			if (curvature_estimator == CurvatureEstimator::kQuadricFitting)
+			{
+				CalcVertexNormals(V, F, N);
+			}
+			is_calculated = CalcCurvatures(V, vertices, F, adjacency_list, N, curvature_estimator, curvature_info, Deadline(deadline_ms, nullptr));
+		}
+		if (!is_calculated)
+		{
+			PyErr_SetString(PyExc_TimeoutError, "curvature is not calculated within the deadline");
+			throw py::error_already_set();
+		}
+		return curvature_info;
+	}
+
+
+	/**
+	 * @brief Engine held by Python
+	 *        the mesh is given at construction and never replaced, so the curvature arrays handed out as views are not reallocated;
+	 *        a trace with another estimator overwrites them in place.
+	 */
+	class PyEngine
+	{
+		GeometryEngine engine_;
+		std::mutex mutex_;	// runs of one engine and the curvature property are serialized, runs hold it with the GIL released
+		std::atomic<bool> cancel_{ false };
+
+	public:
+		PyEngine(const VerticesRef& vertices, const FacesRef& faces, const std::string& reorder)
+		{
+			CheckFaces(vertices.rows(), faces);
+
+			GeometryEngineInput input;
+			input.model.type = "memory";
+			input.model.reorder = reorder;
+			bool is_initialized = false;
+			{
+				py::gil_scoped_release release;
+				// the engine owns its vertices column by column (and reordered), the NumPy arrays are only read here
+				is_initialized = engine_.Initialize(input, vertices, faces);
+			}
+			if (!is_initialized)
+			{
+				ThrowError(engine_.output());
+			}
+			engine_.SetCancelToken(&cancel_);
+		}
+
+		/**
+		 * @brief Trace the margin line from a seed point
+		 * @return dict of points, smoothed_points, num_original_points, interrupted_stage, return_code, message and metrics
+		 */
+		py::dict Trace(
+			const Eigen::Vector3d& seed,
+			int num_samples,
+			double threshold_to_remove_last_point,
+			const std::string& tracer,
+			const std::string& estimator,
+			int smoothing_iterations,
+			double deadline_ms)
+		{
+			GeometryEngineInput::Operation operation;
+			operation.type = "marginline";
+			operation.marginline.type = "coordinate";
+			operation.marginline.seed = { seed.x(), seed.y(), seed.z() };
+			operation.marginline.num_samples = num_samples;
+			operation.marginline.threshold_to_remove_last_point = threshold_to_remove_last_point;
+			operation.marginline.smoothing_iterations = smoothing_iterations;
+			operation.marginline.tracer = tracer;
+			operation.curvature.estimator = estimator;
+			operation.deadline_ms = deadline_ms;
+
+			GeometryEngineOutput output;
+			{
+				py::gil_scoped_release release;
+				std::lock_guard<std::mutex> lock(mutex_);
+				// a cancel issued before the trace stops it, the flag is cleared once the trace is over
+				output = engine_.Run(operation);
+				cancel_ = false;
+			}
+			if (output.return_code != ToInt(ReturnCode::kSuccess) && output.interrupted_stage.empty())
+			{
+				ThrowError(output);
+			}
+
+			const auto& marginline = output.result.marginline;
+			py::dict metrics;
+			metrics["load_ms"] = output.metrics.load_ms;
+			metrics["curvature_ms"] = output.metrics.curvature_ms;
+			metrics["traversal_ms"] = output.metrics.traversal_ms;
+			metrics["export_ms"] = output.metrics.export_ms;
+			metrics["total_ms"] = output.metrics.total_ms;
+			metrics["arena_bytes"] = output.metrics.arena_bytes;
+
+			py::dict result;
+			result["points"] = py::cast(ToPoints(marginline.points));
+			result["smoothed_points"] = py::cast(ToPoints(marginline.smoothed_points));
+			result["num_original_points"] = marginline.num_original_points;
+			result["interrupted_stage"] = output.interrupted_stage;
+			result["return_code"] = output.return_code;
+			result["message"] = output.message;
+			result["metrics"] = metrics;
+			return result;
+		}
+
+		void Cancel()
+		{
+			cancel_ = true;
+		}
+
+		const CurvatureInfo& curvature_info()
+		{
+			// the views are taken between traces, without holding the GIL while a trace holds the engine
+			py::gil_scoped_release release;
+			std::lock_guard<std::mutex> lock(mutex_);
+			return engine_.curvature_info();
+		}
+
+		const std::vector<int>& original_vertex_indices() const { return engine_.original_vertex_indices(); }
+	};
+}
+
+
+PYBIND11_MODULE(geometry_engine_py, m)
+{
+	m.doc() = "Curvature and margin lines of triangle meshes given as NumPy arrays";
+
+	// arrays are returned as read-only views that keep their owner alive
+	py::class_<CurvatureInfo>(m, "Curvature", "Per-vertex curvature, PV1 <= PV2 and convex is positive")
+		.def_readonly("mean", &CurvatureInfo::mean, "(n,) mean curvature")
+		.def_readonly("gaussian", &CurvatureInfo::gaussian, "(n,) gaussian curvature")
+		.def_readonly("principal_value1", &CurvatureInfo::principal_value1, "(n,) principal curvature value 1")
+		.def_readonly("principal_directions1", &CurvatureInfo::principal_directions1, "(n, 3) principal curvature direction 1")
+		.def_readonly("principal_value2", &CurvatureInfo::principal_value2, "(n,) principal curvature value 2")
+		.def_readonly("principal_directions2", &CurvatureInfo::principal_directions2, "(n, 3) principal curvature direction 2");
+
+	m.def("calc_curvatures", &CalcCurvaturesOf,
+		"Calculate curvature of a mesh, the GIL is released meanwhile. raises TimeoutError past the deadline",
+		py::arg("vertices"), py::arg("faces"), py::arg("estimator") = "quadric", py::arg("deadline_ms") = 0.0);
+
+	py::class_<PyEngine>(m, "Engine", "Geometry engine over one mesh, a trace runs with the GIL released")
+		.def(py::init<const VerticesRef&, const FacesRef&, const std::string&>(),
+			"Set up the engine for a mesh, reorder is 'none', 'morton' or 'rcm'",
+			py::arg("vertices"), py::arg("faces"), py::arg("reorder") = "none")
+		.def("trace", &PyEngine::Trace,
+			"Trace the margin line from the vertex nearest to seed. tracer is 'greedy', 'ridge' or 'bidirectional', "
+			"estimator is 'quadric' or 'normal_cycle'. a trace stopped by the deadline or cancel() returns what it has "
+			"with interrupted_stage set, other failures raise ValueError or RuntimeError",
+			py::arg("seed"), py::arg("num_samples"), py::arg("threshold_to_remove_last_point") = 0.0,
+			py::arg("tracer") = "greedy", py::arg("estimator") = "quadric", py::arg("smoothing_iterations") = 0,
+			py::arg("deadline_ms") = 0.0)
+		.def("cancel", &PyEngine::Cancel, "Stop the trace running on another thread, or the next trace when none is running")
+		.def_property_readonly("curvature", &PyEngine::curvature_info,
+			"Curvature of the last trace as views of the engine, in the order of the engine vertices. empty before the first trace. "
+			"a later trace with another estimator overwrites the viewed arrays in place: copy them with numpy.array to keep them, "
+			"and do not read them while a trace runs on another thread")
+		.def_property_readonly("original_vertex_indices", [](py::object self)
+			{
+				const auto& indices = self.cast<const PyEngine&>().original_vertex_indices();
+				return py::cast(Eigen::Map<const Eigen::VectorXi>(indices.data(), static_cast<Eigen::Index>(indices.size())), py::return_value_policy::reference_internal, self);
+			},
+			"Index of each engine vertex in the given vertices, they differ when the mesh is reordered");
+}
@@ -1,4 +1,7 @@
 #include "geometry_utils.h"
+#include <algorithm>
+#include <unordered_set>
+#include <Eigen/Geometry>
 #include "igl/point_mesh_squared_distance.h"
 
 
@@ -35,4 +38,95 @@ int FindNearestVertex(const VectorArray& V,	const IndicesArray& F, const Eigen::
 	}
 
 	return nearest_vertex_index;
-}
\ No newline at end of file
+}
+
+
+std::vector<std::vector<int>> BuildVertexFaces(const IndicesArray& F, Eigen::Index num_vertices)
+{
+	std::vector<std::vector<int>> vertex_faces(num_vertices);
+	for (Eigen::Index f = 0; f < F.rows(); ++f)
+	{
+		for (Eigen::Index j = 0; j < F.cols(); ++j)
+		{
+			vertex_faces[F(f, j)].push_back(static_cast<int>(f));
+		}
+	}
+	return vertex_faces;
+}
+
+
+void CalcVertexNormals(const VectorArray& V, const IndicesArray& F, PackedVectorArray& N)
+{
+	N.setZero(V.rows(), 3);
+	for (Eigen::Index f = 0; f < F.rows(); ++f)
+	{
+		const Eigen::RowVector3d v0 = V.row(F(f, 0));
+		const Eigen::RowVector3d v1 = V.row(F(f, 1));
+		const Eigen::RowVector3d v2 = V.row(F(f, 2));
+		const Eigen::RowVector3d n = (v1 - v0).cross(v2 - v0);	// length is twice the area
+		for (Eigen::Index j = 0; j < 3; ++j)
+		{
+			N.row(F(f, j)) += n;
+		}
+	}
+	for (Eigen::Index i = 0; i < N.rows(); ++i)
+	{
+		auto norm = N.row(i).norm();
+		if (norm > 0.0)
+		{
+			N.row(i) /= norm;
+		}
+	}
+}
+
+
+void CalcVertexNormals(
+	const VectorArray& V,
+	const IndicesArray& F,
+	const std::vector<std::vector<int>>& vertex_faces,
+	const std::vector<int>& vertices,
+	PackedVectorArray& N)
+{
+	for (auto v : vertices)
+	{
+		Eigen::RowVector3d n = Eigen::RowVector3d::Zero();
+		for (auto f : vertex_faces[v])
+		{
+			const Eigen::RowVector3d v0 = V.row(F(f, 0));
+			const Eigen::RowVector3d v1 = V.row(F(f, 1));
+			const Eigen::RowVector3d v2 = V.row(F(f, 2));
+			n += (v1 - v0).cross(v2 - v0);
+		}
+		auto norm = n.norm();
+		N.row(v) = norm > 0.0 ? Eigen::RowVector3d(n / norm) : n;
+	}
+}
+
+
+
+std::vector<int> ExpandRings(
+	const std::vector<std::vector<int>>& adjacency_list,
+	const std::vector<int>& vertices,
+	int num_rings)
+{
+	std::unordered_set<int> visited(vertices.begin(), vertices.end());
+	std::vector<int> result(visited.begin(), visited.end());
+	size_t level_begin = 0;
+	for (auto ring = 0; ring < num_rings; ++ring)
+	{
+		auto level_end = result.size();
+		for (auto i = level_begin; i < level_end; ++i)
+		{
+			for (auto neighbor : adjacency_list[result[i]])
+			{
+				if (visited.insert(neighbor).second)
+				{
+					result.push_back(neighbor);
+				}
+			}
+		}
+		level_begin = level_end;
+	}
+	std::sort(result.begin(), result.end());
+	return result;
+}
@@ -1,4 +1,5 @@
 #pragma once
+#include <vector>
 #include "type.h"
 
 
@@ -12,9 +13,57 @@ Eigen::Vector3d Convert(const std::vector<double>& v);
 
 /**
 * @brief Find the nearest vertex to a given coordinate
+*        a search tree is built on each call, MeshPicker keeps one for repeated queries.
 * @param V vertices
 * @param F faces
 * @param coordinate coordinate
 * @return index of the nearest vertex
 */
-int FindNearestVertex(const VectorArray& V, const IndicesArray& F, const Eigen::Vector3d& coordinate);
\ No newline at end of file
+int FindNearestVertex(const VectorArray& V, const IndicesArray& F, const Eigen::Vector3d& coordinate);
+
+
+/**
+* @brief Build the list of faces incident to each vertex
+* @param F faces
+* @param num_vertices number of vertices
+* @return vertex_faces[v] is the list of faces that contain v
+*/
+std::vector<std::vector<int>> BuildVertexFaces(const IndicesArray& F, Eigen::Index num_vertices);
+
+
+/**
+* @brief Calculate area weighted vertex normals, as igl::per_vertex_normals with the default weighting
+* @param V vertices
+* @param F faces
+* @param N [o] unit vertex normals, zero for unreferenced vertices
+*/
+void CalcVertexNormals(const VectorArray& V, const IndicesArray& F, PackedVectorArray& N);
+
+
+/**
+* @brief Recalculate area weighted vertex normals of some vertices
+* @param V vertices
+* @param F faces
+* @param vertex_faces faces incident to each vertex
+* @param vertices vertices to update
+* @param N [i/o] unit vertex normals
+*/
+void CalcVertexNormals(
+	const VectorArray& V,
+	const IndicesArray& F,
+	const std::vector<std::vector<int>>& vertex_faces,
+	const std::vector<int>& vertices,
+	PackedVectorArray& N);
+
+
+/**
+* @brief Collect the vertices within some rings of a set of vertices
+* @param adjacency_list adjacency list
+* @param vertices seed vertices
+* @param num_rings number of rings to expand
+* @return sorted vertices within num_rings of the seed vertices, including the seeds
+*/
+std::vector<int> ExpandRings(
+	const std::vector<std::vector<int>>& adjacency_list,
+	const std::vector<int>& vertices,
+	int num_rings);
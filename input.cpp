@@ -8,25 +8,35 @@
 
 void to_json(nlohmann::json& j, const GeometryEngineInput::Model& m)
 {
-    j = nlohmann::json{ {"id", m.id}, {"name", m.name}, {"type", m.type}, {"subType", m.subType}, {"data", m.data} };
+    j = nlohmann::json{ {"id", m.id}, {"name", m.name}, {"type", m.type}, {"subType", m.subType}, {"data", m.data}, {"reorder", m.reorder} };
 }
 
 
 void to_json(nlohmann::json& j, const GeometryEngineInput::Operation::Marginline& ml)
 {
-    j = nlohmann::json{ {"type", ml.type}, {"seed", ml.seed}, {"num_samples", ml.num_samples}, {"threshold_to_remove_last_point", ml.threshold_to_remove_last_point} };
+    j = nlohmann::json{ {"type", ml.type}, {"seed", ml.seed}, {"num_samples", ml.num_samples}, {"threshold_to_remove_last_point", ml.threshold_to_remove_last_point}, {"smoothing_iterations", ml.smoothing_iterations}, {"tracer", ml.tracer} };
+}
+
+
+void to_json(nlohmann::json& j, const GeometryEngineInput::Operation::Curvature& c)
+{
+    j = nlohmann::json{ {"tile_vertices", c.tile_vertices}, {"output", c.output}, {"estimator", c.estimator} };
 }
 
 
 void to_json(nlohmann::json& j, const GeometryEngineInput::Operation& o)
 {
-    j = nlohmann::json{ {"type", o.type}, {"marginline", o.marginline} };
+    j = nlohmann::json{ {"type", o.type}, {"marginline", o.marginline}, {"curvature", o.curvature}, {"deadline_ms", o.deadline_ms} };
 }
 
 
 void to_json(nlohmann::json& j, const GeometryEngineInput& gei)
 {
     j = nlohmann::json{ {"model", gei.model}, {"operation", gei.operation} };
+    if (!gei.result_shm.empty())
+    {
+        j["result_shm"] = gei.result_shm;
+    }
 }
 
 
@@ -37,6 +47,7 @@ void from_json(const nlohmann::json& j, GeometryEngineInput::Model& m)
     j.at("type").get_to(m.type);
     j.at("subType").get_to(m.subType);
     j.at("data").get_to(m.data);
+    m.reorder = j.value("reorder", "none");
 }
 
 
@@ -46,6 +57,16 @@ void from_json(const nlohmann::json& j, GeometryEngineInput::Operation::Marginli
     ml.seed = j.at("seed").get<std::vector<double>>();
     ml.num_samples = j.at("num_samples").get<int>();
     ml.threshold_to_remove_last_point = j.at("threshold_to_remove_last_point").get<double>();
+    ml.smoothing_iterations = j.value("smoothing_iterations", 0);
+    ml.tracer = j.value("tracer", "greedy");
+}
+
+
+void from_json(const nlohmann::json& j, GeometryEngineInput::Operation::Curvature& c)
+{
+    c.tile_vertices = j.value("tile_vertices", 0);
+    c.output = j.value("output", "");
+    c.estimator = j.value("estimator", "quadric");
 }
 
 
@@ -53,6 +74,8 @@ void from_json(const nlohmann::json& j, GeometryEngineInput::Operation& o)
 {
     j.at("type").get_to(o.type);
     j.at("marginline").get_to(o.marginline);
+    o.curvature = j.value("curvature", GeometryEngineInput::Operation::Curvature());
+    o.deadline_ms = j.value("deadline_ms", 0.0);
 }
 
 
@@ -60,6 +83,7 @@ void from_json(const nlohmann::json& j, GeometryEngineInput& gei)
 {
     j.at("model").get_to(gei.model);
     j.at("operation").get_to(gei.operation);
+    gei.result_shm = j.value("result_shm", "");
 }
 
 
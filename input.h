@@ -11,9 +11,10 @@ struct GeometryEngineInput
     {
         std::string id;       // Model ID
         std::string name;     // Model name
-        std::string type;     // Model format type, like '.stl'
+        std::string type;     // Model format type, like '.stl', or 'shm' for a mesh in shared memory
         std::string subType;  // Model sub type, like 'binary'
-        std::string data;     // Model data
+        std::string data;     // Model data, the shared memory name when type is 'shm'
+        std::string reorder;  // Vertex ordering applied at load time, 'none', 'morton' or 'rcm'. optional, 'none' by default.
     };
 
     struct Operation
@@ -23,26 +24,39 @@ struct GeometryEngineInput
             std::vector<double> seed;  // seed point to generate margin line
             int num_samples; // number of samples
             double threshold_to_remove_last_point; // threshold to remove last point
+            int smoothing_iterations = 0; // iterations of Chaikin smoothing of the sampled points. optional, 0 for no smoothing.
+            std::string tracer = "greedy"; // 'greedy' to walk the whole mesh, 'ridge' to walk the ridge graph of the mesh, or 'bidirectional' to walk as 'greedy' from both sides of the seed at once. optional.
+        };
+
+        struct Curvature {
+            int tile_vertices = 0; // vertices per tile of the out-of-core curvature computation. optional, 0 to process the whole mesh at once.
+            std::string output;    // segment the tiled curvature is streamed to, like 'file:<path>', rows in the order of the model file. optional, needs tile_vertices > 0.
+            std::string estimator = "quadric"; // principal curvature estimator, 'quadric' for quadric fitting or 'normal_cycle' for the faster normal cycle tensors. optional.
         };
 
         std::string type;      // Operation data type, like 'marginline'
         Marginline marginline; // input data to generate initial margin line
+        Curvature curvature;   // curvature computation, used when the curvature of the mesh is calculated. optional
+        double deadline_ms = 0.0; // time limit of the operation in milliseconds. optional, 0 for no limit.
     };
 
     Model model;
     Operation operation;
+    std::string result_shm;  // Shared memory name the result is also written to. optional, empty by default.
 };
 
 
 // serialize functions
 void to_json(nlohmann::json& j, const GeometryEngineInput::Model& m);
 void to_json(nlohmann::json& j, const GeometryEngineInput::Operation::Marginline& ml);
+void to_json(nlohmann::json& j, const GeometryEngineInput::Operation::Curvature& c);
 void to_json(nlohmann::json& j, const GeometryEngineInput::Operation& o);
 void to_json(nlohmann::json& j, const GeometryEngineInput& gei);
 
 // deserialize functions
 void from_json(const nlohmann::json& j, GeometryEngineInput::Model& m);
 void from_json(const nlohmann::json& j, GeometryEngineInput::Operation::Marginline& ml);
+void from_json(const nlohmann::json& j, GeometryEngineInput::Operation::Curvature& c);
 void from_json(const nlohmann::json& j, GeometryEngineInput::Operation& o);
 void from_json(const nlohmann::json& j, GeometryEngineInput& gei);
 
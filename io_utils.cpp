@@ -1,8 +1,14 @@
 #include "io_utils.h"
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <string>
+#include <vector>
 #include <igl/readPLY.h>
 #include <igl/readSTL.h>
+#include "ascii_parser.h"
 #include "curvature_info.h"
+#include "gem_format.h"
 
 
 
@@ -24,18 +30,31 @@ bool LoadModel(const std::filesystem::path& path, VectorArray& V, IndicesArray&
 	try
 	{
 		auto extenstion = get_extension(path);
+		// ASCII files are parsed in parallel, binary ones and layouts the parser does not handle go to igl
 		if (extenstion == ".ply")
 		{
+			if (LoadAsciiPly(path, V, F))
+			{
+				return true;
+			}
 			return igl::readPLY(path.string(), V, F);
 		}
 		else if (extenstion == ".stl")
 		{
+			if (LoadAsciiStl(path, V, F))
+			{
+				return true;
+			}
 			std::ifstream in(path.c_str());
 			Eigen::MatrixXf Vf, Nf;
 			auto status = igl::readSTL(in, Vf, F, Nf);
 			V = Vf.cast<double>();
 			return status;
 		}
+		else if (extenstion == ".gem")
+		{
+			return LoadGem(path, V, F, nullptr);
+		}
 		else
 		{
 			std::cout << "unsupported file format\n";
@@ -186,3 +205,50 @@ bool SaveCsv(
 	out.close();
 	return true;
 }
+
+
+bool LoadCsv(
+	const std::filesystem::path& filepath,
+	VectorArray& V)
+{
+	std::ifstream in(filepath.c_str());
+	if (!in)
+	{
+		return false;
+	}
+
+	std::vector<double> values;
+	std::string line;
+	while (std::getline(in, line))
+	{
+		const char* p = line.c_str();
+		char* end = nullptr;
+		auto num_values = 0;
+		for (; num_values < 3; ++num_values)
+		{
+			const auto value = std::strtod(p, &end);
+			if (end == p)
+			{
+				break;
+			}
+			values.push_back(value);
+			p = *end == ',' ? end + 1 : end;
+		}
+		if (num_values == 0)
+		{
+			continue;	// blank line
+		}
+		if (num_values != 3)
+		{
+			std::cout << "invalid line in " << filepath.string() << ": " << line << "\n";
+			return false;
+		}
+	}
+
+	V.resize(static_cast<Eigen::Index>(values.size() / 3), 3);
+	for (Eigen::Index i = 0; i < V.rows(); ++i)
+	{
+		V.row(i) << values[3 * i], values[3 * i + 1], values[3 * i + 2];
+	}
+	return true;
+}
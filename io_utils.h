@@ -62,4 +62,15 @@ bool SaveCsv(
  */
 bool SaveCsv(
 	const std::filesystem::path& filepath,
-	const VectorArray& V);
\ No newline at end of file
+	const VectorArray& V);
+
+
+/**
+ * @brief Load a polyline saved by SaveCsv
+ * @param filepath file path
+ * @param V [o] points, one row per line
+ * @return true if the polyline is loaded successfully, false otherwise
+ */
+bool LoadCsv(
+	const std::filesystem::path& filepath,
+	VectorArray& V);
\ No newline at end of file
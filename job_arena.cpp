@@ -0,0 +1,65 @@
+#include "job_arena.h"
+#include <algorithm>
+
+
+JobArena::JobArena(std::size_t initial_bytes, std::size_t max_block_bytes)
+	: max_block_bytes_(max_block_bytes > 0 ? max_block_bytes : 1)
+{
+	stats_.block_bytes = std::min(initial_bytes > 0 ? initial_bytes : 1, max_block_bytes_);
+	AllocateBlock();
+}
+
+
+void JobArena::AllocateBlock()
+{
+	// new[] leaves the bytes uninitialized, unlike std::make_unique, so untouched pages are not committed
+	buffer_.reset();
+	block_.reset(new std::byte[stats_.block_bytes]);
+	buffer_ = std::make_unique<std::pmr::monotonic_buffer_resource>(block_.get(), stats_.block_bytes, std::pmr::new_delete_resource());
+}
+
+
+void JobArena::EndJob()
+{
+	// the whole job goes at once, blocks taken from the heap while it ran are returned here
+	buffer_->release();
+
+	++stats_.num_jobs;
+	stats_.job_bytes = job_bytes_;
+	if (job_bytes_ > stats_.high_water_bytes)
+	{
+		stats_.high_water_bytes = job_bytes_;
+	}
+	if (job_bytes_ > stats_.block_bytes)
+	{
+		// the next jobs fit in a single block, with room for alignment padding, unless the block is at its largest
+		++stats_.num_overflows;
+		const auto block_bytes = std::min(stats_.high_water_bytes + stats_.high_water_bytes / 8, max_block_bytes_);
+		if (block_bytes > stats_.block_bytes)
+		{
+			stats_.block_bytes = block_bytes;
+			AllocateBlock();
+		}
+	}
+	job_bytes_ = 0;
+}
+
+
+void* JobArena::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+	job_bytes_ += bytes;
+	return buffer_->allocate(bytes, alignment);
+}
+
+
+void JobArena::do_deallocate(void* p, std::size_t bytes, std::size_t alignment)
+{
+	// monotonic: memory comes back at the end of the job
+	buffer_->deallocate(p, bytes, alignment);
+}
+
+
+bool JobArena::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+	return this == &other;
+}
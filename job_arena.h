@@ -0,0 +1,78 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+
+
+/**
+ * @brief Arena for the scratch memory of a job
+ *        allocations are bumped from a monotonic buffer and released all at once when the job ends, so
+ *        short-lived containers of a run neither fragment the heap nor keep it grown in a long-lived process.
+ *        the first block is kept between jobs and grown to the high-water mark, so a steady load stops touching the heap.
+ *        it grows up to max_block_bytes only, so one large job does not pin its memory for the life of the process:
+ *        larger jobs take the rest from the heap and give it back when they end. the block is not zero-filled,
+ *        so its pages are committed only as far as jobs touch them.
+ *        not thread-safe: one arena per engine, used by the thread running the job. the curvature kernels run on worker threads
+ *        with scratch of their own per thread, so the arena holds the scratch of the traversal: the visited set, the step candidates and the progress buffer.
+ */
+class JobArena : public std::pmr::memory_resource
+{
+public:
+	/**
+	 * @brief Statistics of the arena
+	 */
+	struct Stats
+	{
+		std::size_t num_jobs = 0;	///< jobs ended
+		std::size_t job_bytes = 0;	///< bytes allocated by the last job
+		std::size_t high_water_bytes = 0;	///< largest job_bytes so far
+		std::size_t block_bytes = 0;	///< size of the block kept between jobs
+		std::size_t num_overflows = 0;	///< jobs that outgrew the block and allocated from the heap
+	};
+
+	/**
+	 * @brief Ends the job of the arena on scope exit
+	 *        containers using the arena must be declared after it, so they are destroyed first.
+	 */
+	class Job
+	{
+		JobArena& arena_;
+
+	public:
+		explicit Job(JobArena& arena) : arena_(arena) {}
+		~Job() { arena_.EndJob(); }
+		Job(const Job&) = delete;
+		Job& operator=(const Job&) = delete;
+	};
+
+	/**
+	 * @brief Constructor
+	 * @param initial_bytes size of the first block, it grows to the high-water mark afterwards
+	 * @param max_block_bytes largest size the block grows to
+	 */
+	explicit JobArena(std::size_t initial_bytes = 64 * 1024, std::size_t max_block_bytes = 8 * 1024 * 1024);
+	JobArena(const JobArena&) = delete;
+	JobArena& operator=(const JobArena&) = delete;
+
+	const Stats& stats() const { return stats_; }
+	std::size_t job_bytes() const { return job_bytes_; }	// bytes allocated by the running job so far
+
+	/**
+	 * @brief Release everything allocated since the previous job
+	 *        nothing allocated from the arena may be used afterwards.
+	 */
+	void EndJob();
+
+private:
+	std::unique_ptr<std::byte[]> block_;
+	std::unique_ptr<std::pmr::monotonic_buffer_resource> buffer_;
+	std::size_t job_bytes_ = 0;
+	std::size_t max_block_bytes_;
+	Stats stats_;
+
+	void AllocateBlock();
+
+	void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+	void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override;
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+};
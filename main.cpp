@@ -1,130 +1,174 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <fstream>
 #include <iostream>
 #include <filesystem>
-#include <set>
-#include <sstream>
+#include <memory>
 #include <string>
-#include <tuple>
-#include <igl/adjacency_list.h>
-#include <igl/avg_edge_length.h>
-#include <igl/opengl/glfw/Viewer.h>
-#include <igl/unproject_onto_mesh.h>
+#include <vector>
 #include "geometry_engine.h"
+#include "replay_log.h"
+#include "result_cache.h"
 #include "return_code.h"
-#include "io_utils.h"
-#include "marginline.h"
-#include "smoothing.h"
+#include "spool_watcher.h"
 
 
-// #define GUI
 GeometryEngine geometry_engine;
+static const size_t RESULT_CACHE_CAPACITY = 256 * 1024 * 1024;
 
 
-/////////////////////////////////////////////////////////////////
-// hydration
-/////////////////////////////////////////////////////////////////
+/**
+ * @brief Capture the request for replay with the load generator
+ * @param replay_log path to the replay log
+ * @param input_json path to input.json
+ * @return true if the request is appended, false otherwise
+ */
+bool RecordRequest(const std::filesystem::path& replay_log, const std::filesystem::path& input_json)
+{
+	try
+	{
+		std::ifstream ifs(input_json);
+		ReplayRecord record;
+		record.input = nlohmann::json::parse(ifs);
+		record.timestamp_ms = std::chrono::duration<double, std::milli>(std::chrono::system_clock::now().time_since_epoch()).count();
+		record.input_json = std::filesystem::absolute(input_json).string();
+		const auto& model = record.input.at("model");
+		const auto type = model.at("type").get<std::string>();
+		record.model = type == "shm" ? model.at("data").get<std::string>() : std::filesystem::absolute(input_json).parent_path().append("model" + type).string();
+		record.mesh_hash = geometry_engine.MeshHash();
+		return AppendReplayRecord(replay_log, record);
+	}
+	catch (const std::exception& e)
+	{
+		std::cout << "failed to record the request\n";
+		std::cout << e.what() << "\n";
+		return false;
+	}
+}
+
+
+std::atomic<bool> is_stopping(false);
 
-void HydrateSelectionWithCurvature(
-	igl::opengl::glfw::Viewer& viewer,
-	VectorArray& V,
-	IndicesArray& F,
-	std::vector<std::vector<int>>& adjacency_list,
-	const CurvatureInfo& curvature_info)
+
+void OnStopSignal(int)
 {
-	// how to change thickness of edges as overlays: https://github.com/libigl/libigl/issues/1270
-	static const Eigen::RowVector3d SELECTED_EDGE_COLOR(0, 0, 0);
-	static const Eigen::RowVector3d SELECTED_VERTEX_COLOR(1, 0, 0);
-	static const Eigen::RowVector3d CURVATURE_EDGE_COLOR(1, 1, 0);
+	is_stopping = true;
+}
+
 
-	viewer.callback_mouse_up = [&V, &F, &adjacency_list, &curvature_info](igl::opengl::glfw::Viewer& viewer, int, int) -> bool
+/**
+ * @brief Run the jobs dropped into spool directories until SIGINT or SIGTERM
+ *        each worker reuses its own engine, and output.json is written next to the input.json of each job.
+ * @param options spool directories and workers
+ * @param result_cache result cache shared by the workers, may be null
+ * @param is_perf_enabled collect event counters of the stages
+ * @return process exit code
+ */
+int WatchSpoolDirectories(const SpoolOptions& options, ResultCache* result_cache, bool is_perf_enabled)
+{
+	std::vector<std::unique_ptr<GeometryEngine>> engines;
+	for (int w = 0; w < options.num_workers; ++w)
+	{
+		engines.push_back(std::make_unique<GeometryEngine>());
+		engines.back()->SetResultCache(result_cache);
+		engines.back()->EnablePerfCounters(is_perf_enabled);
+	}
+
+	std::signal(SIGINT, OnStopSignal);
+	std::signal(SIGTERM, OnStopSignal);
+	auto run_job = [&engines](int worker, const std::filesystem::path& input_json)
 		{
-			int fid = 0;
-			Eigen::Vector3d bc;
-			auto x = static_cast<float>(viewer.current_mouse_x);
-			auto y = static_cast<float>(viewer.core().viewport(3) - viewer.current_mouse_y);
-			if (igl::unproject_onto_mesh(
-				Eigen::Vector2f(x, y),
-				viewer.core().view,
-				viewer.core().proj,
-				viewer.core().viewport,
-				V,
-				F,
-				fid,
-				bc))
+			auto& engine = *engines[worker];
+			if (engine.Initialize(input_json))
 			{
-				// showing clicked face
-				viewer.data().add_edges(V.row(F(fid, 0)), V.row(F(fid, 1)), SELECTED_EDGE_COLOR);
-				viewer.data().add_edges(V.row(F(fid, 1)), V.row(F(fid, 2)), SELECTED_EDGE_COLOR);
-				viewer.data().add_edges(V.row(F(fid, 2)), V.row(F(fid, 0)), SELECTED_EDGE_COLOR);
-
-				// get closest vertex from clicking point
-				const auto bc_arr = std::vector<double>{ bc[0], bc[1], bc[2] };
-				const auto closest_index = std::max_element(bc_arr.begin(), bc_arr.end()) - bc_arr.begin();
-				const auto closest_vertex_index = F(fid, closest_index);
-				viewer.data().add_points(V.row(closest_vertex_index), SELECTED_VERTEX_COLOR);
-
-				std::cout << "clicked vertex index: " << closest_vertex_index << "\n";
-				std::cout << "  coordinate: " << V.row(closest_vertex_index) << "\n";
-
-				std::vector<int> marginline{ static_cast<int>(closest_vertex_index) };
-				std::set<int> visited;
-				CreateMarginline(V, F, adjacency_list, curvature_info, marginline, visited);
-				if (marginline.size() > 1)
-				{
-					viewer.data().add_label(V.row(marginline[0]), "0");
-					viewer.data().add_points(V.row(marginline[0]), Eigen::RowVector3d(0, 0, 1));
-					for (size_t i = 1; i < marginline.size(); ++i)
-					{
-						std::stringstream ss;
-						ss << i;
-						viewer.data().add_label(V.row(marginline[i]), ss.str());
-						viewer.data().add_points(V.row(marginline[i]), Eigen::RowVector3d(0, 0, 1));
-					}
-					
-					for (auto& vertex_index : marginline)
-					{
-						visited.erase(vertex_index);
-					}
-					for (auto& it = visited.begin(); it != visited.end(); ++it)
-					{
-						viewer.data().add_points(V.row(*it), Eigen::RowVector3d(0, 1, 0));
-					}
-
-					SaveCsv("polyline.csv", V, marginline);
-					SaveCsv("polyline_smoothed.csv", ChaikinSmoothing(V, marginline, 5));
-					SaveCsv("polyline_smoothed2.csv", ChaikinSmoothing2(V, marginline, 5));
-				}
-
-				return true;
+				engine.Run();
 			}
-			return false;
-		};
-
-	viewer.callback_key_up = [&V, &F, &adjacency_list, &curvature_info](igl::opengl::glfw::Viewer& viewer, unsigned char key, int modifier) -> bool
-		{
-			if (key == 'r' || key == 'R')
+			if (!engine.FlushWrites())
 			{
-				viewer.data().clear_points();
-				viewer.data().clear_labels();
-				// viewer.data().clear_edges();
+				std::cout << "failed to write the output files of " << input_json.string() << "\n";
 			}
-			return false;
+			std::cout << "done to run " << input_json.string() << " with return code " << engine.output().return_code << "\n";
 		};
+	return WatchSpool(options, run_job, is_stopping) ? 0 : 1;
 }
 
 
-
 /////////////////////////////////////////////////////////////////
 // main function
 /////////////////////////////////////////////////////////////////
 
 int main(int argc, char *argv[])
 {
-	if (argc < 2)
+	std::filesystem::path cache_directory;
+	std::filesystem::path replay_log;
+	SpoolOptions spool_options;
+	auto is_perf_enabled = false;
+	auto is_valid = argc >= 2;
+	const auto is_spool = is_valid && std::string(argv[1]).rfind("--", 0) == 0;	// no input json, jobs come from spool directories
+	for (int i = is_spool ? 1 : 2; is_valid && i < argc; ++i)
 	{
-		std::cout << "Usage: " << argv[0] << " <input json path>\n";
+		const std::string arg = argv[i];
+		if (arg == "--cache" && i + 1 < argc)
+		{
+			cache_directory = argv[++i];
+		}
+		else if (arg == "--record" && i + 1 < argc && !is_spool)
+		{
+			replay_log = argv[++i];
+		}
+		else if (arg == "--perf")
+		{
+			is_perf_enabled = true;
+		}
+		else if (arg == "--watch" && i + 1 < argc && is_spool)
+		{
+			spool_options.directories.push_back(argv[++i]);
+		}
+		else if (arg == "--workers" && i + 1 < argc && is_spool)
+		{
+			// a count that does not parse as a whole, or is not positive, shows the usage
+			const std::string value = argv[++i];
+			size_t length = 0;
+			try
+			{
+				spool_options.num_workers = std::stoi(value, &length);
+			}
+			catch (const std::exception&)
+			{
+				length = 0;
+			}
+			is_valid = length > 0 && length == value.size() && spool_options.num_workers >= 1;
+		}
+		else
+		{
+			is_valid = false;
+		}
+	}
+	if (!is_valid || (is_spool && spool_options.directories.empty()))
+	{
+		std::cout << "Usage: " << argv[0] << " <input json path> [--cache <result cache directory>] [--record <replay log>] [--perf]\n";
+		std::cout << "       " << argv[0] << " --watch <spool directory> [--watch <spool directory>]... [--workers N] [--cache <result cache directory>] [--perf]\n";
 		return 1;
 	}
 
+	// results are shared between runs through the on-disk store
+	std::unique_ptr<ResultCache> result_cache;
+	if (!cache_directory.empty())
+	{
+		result_cache = std::make_unique<ResultCache>(RESULT_CACHE_CAPACITY, cache_directory);
+		geometry_engine.SetResultCache(result_cache.get());
+	}
+
+	if (is_spool)
+	{
+		return WatchSpoolDirectories(spool_options, result_cache.get(), is_perf_enabled);
+	}
+
+	// event counters of each stage are reported in the metrics of output.json
+	geometry_engine.EnablePerfCounters(is_perf_enabled);
+
 	if (!geometry_engine.Initialize(argv[1]))
 	{
 		std::cout << "failed to initialize the geometry engine\n";
@@ -132,11 +176,11 @@ int main(int argc, char *argv[])
 		return static_cast<int>(geometry_engine.output().return_code);
 	}
 
-	auto& V = geometry_engine.V();
-	auto& N = geometry_engine.N();
-	auto& F = geometry_engine.F();
-	auto& adjacency_list = geometry_engine.adjacency_list();
-	VectorArray C;
+	// requests are captured once the mesh is known, a failed run is replayed as well
+	if (!replay_log.empty() && !RecordRequest(replay_log, argv[1]))
+	{
+		std::cout << "failed to write the replay log: " << replay_log.string() << "\n";
+	}
 
 	auto output = geometry_engine.Run();
 	if (output.return_code != ToInt(ReturnCode::kSuccess))
@@ -146,35 +190,10 @@ int main(int argc, char *argv[])
 		return static_cast<int>(geometry_engine.output().return_code);
 	}
 
-	auto& curvature_info = geometry_engine.curvature_info();
-	auto minH = curvature_info.mean.minCoeff();
-	auto maxH = curvature_info.mean.maxCoeff();
-
-#ifdef GUI
-	// curvature direction display
-	// Average edge length for sizing
-	const double avg = igl::avg_edge_length(V, F);
-	const Eigen::RowVector3d red(0.8, 0.2, 0.2), blue(0.2, 0.2, 0.8), white(1.0, 1.0, 1.0);
-
-	// Plot the mesh
-	igl::opengl::glfw::Viewer viewer;
-	viewer.data().set_mesh(V, F);
-	viewer.data().set_data(curvature_info.mean, -0.1, 0.1, igl::COLOR_MAP_TYPE_JET);
-	// viewer.data().set_data(info.mean);
-	viewer.data().set_face_based(true);
-	viewer.data().show_lines = false;
-
-	// viewer.data().add_edges(V + info.principal_directions1 * avg, V - info.principal_directions1 * avg, red);
-	viewer.data().add_edges(V + curvature_info.principal_directions2 * avg, V - curvature_info.principal_directions2 * avg, white);
-
-	// hydration
-	HydrateSelectionWithCurvature(viewer, V, F, adjacency_list, curvature_info);
-
-	// give white color to the background
-	// viewer.core().background_color.setOnes();
-	
-	viewer.launch();
+	if (!geometry_engine.FlushWrites())
+	{
+		std::cout << "failed to write the output files\n";
+	}
 
 	return 0;
-#endif
 }
@@ -1,30 +1,260 @@
 ﻿#include "marginline.h"
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <tuple>
 #include "curvature_info.h"
+#include "ridge_graph.h"
 
 
-void CreateMarginline(
-	const VectorArray& V,
+namespace
+{
+	using IndexAndScore = std::tuple<int, double>;
+
+
+	/**
+	 * @brief Choose the next vertex of a margin line, the step of CreateMarginline and of both tracers of CreateMarginlineBidirectional
+	 *        the neighbour of largest mean curvature if it is larger than the current one and does not turn back against the last hops,
+	 *        otherwise the neighbour best aligned with the min curvature direction (principal_directions1, along a convex margin)
+	 *        that does not go from convex to concave.
+	 * @param V [i] vertices in packed layout
+	 * @param adjacency_list [i] adjacency list
+	 * @param curvature [i] curvature information
+	 * @param path [i] line traced so far, it is not empty
+	 * @param is_free [i] true for the vertices the line may step on
+	 * @param first_direction [i] on the first step, only neighbours on the side of this direction are taken. nullptr for any side
+	 * @param candidates [-] scratch memory
+	 * @return next vertex, -1 if there is none
+	 */
+	template <typename IsFree>
+	int SelectNextVertex(
+		const PackedVectorArray& V,
+		const std::vector<std::vector<int>>& adjacency_list,
+		const CurvatureView& curvature,
+		const std::vector<int>& path,
+		const IsFree& is_free,
+		const Eigen::RowVector3d* first_direction,
+		std::pmr::vector<IndexAndScore>& candidates)
+	{
+		static const size_t NUM_HOPS = 10;
+
+		const auto current = path.back();
+		const auto& neighbors = adjacency_list[current];
+		const Eigen::RowVector3d min_curvature_direction = curvature.principal_direction1(current);
+		auto is_on_side = [&](const Eigen::RowVector3d& direction)
+			{
+				return first_direction == nullptr || path.size() > 1 || direction.dot(*first_direction) > 0.0;
+			};
+
+		// neighbours by mean curvature, not against the last hops
+		candidates.clear();
+		for (auto neighbor : neighbors)
+		{
+			if (!is_free(neighbor))
+			{
+				continue;
+			}
+			const Eigen::RowVector3d direction = (V.row(neighbor) - V.row(current)).normalized();
+			if (!is_on_side(direction))
+			{
+				continue;
+			}
+			auto is_opposite_direction = false;
+			for (auto k = path.size() > NUM_HOPS ? path.size() - NUM_HOPS - 1 : 0; k + 1 < path.size(); ++k)
+			{
+				const Eigen::RowVector3d existing_direction = (V.row(path[k + 1]) - V.row(path[k])).normalized();
+				if (direction.dot(existing_direction) < 0.0)
+				{
+					is_opposite_direction = true;
+					break;
+				}
+			}
+			if (!is_opposite_direction)
+			{
+				candidates.emplace_back(neighbor, curvature.mean(neighbor));
+			}
+		}
+		auto by_score = [](const auto& lhs, const auto& rhs)
+			{
+				return std::get<1>(lhs) < std::get<1>(rhs);
+			};
+		if (!candidates.empty())
+		{
+			const auto best = *std::max_element(candidates.begin(), candidates.end(), by_score);
+			if (std::get<1>(best) > curvature.mean(current))
+			{
+				return std::get<0>(best);
+			}
+		}
+
+		// neighbours by alignment with the min curvature direction
+		candidates.clear();
+		for (auto neighbor : neighbors)
+		{
+			if (!is_free(neighbor) || (curvature.mean(current) > 0 && curvature.mean(neighbor) < 0))
+			{
+				continue;
+			}
+			const Eigen::RowVector3d direction = (V.row(neighbor) - V.row(current)).normalized();
+			if (is_on_side(direction))
+			{
+				candidates.emplace_back(neighbor, std::abs(direction.dot(min_curvature_direction)));
+			}
+		}
+		if (candidates.empty())
+		{
+			return -1;
+		}
+		return std::get<0>(*std::max_element(candidates.begin(), candidates.end(), by_score));
+	}
+
+
+	/**
+	 * @brief Vertices claimed by the tracers of CreateMarginlineBidirectional, with the claim code of each
+	 *        an open-addressing table of (vertex, code) slots claimed by compare and swap, so its size follows the claims of the trace
+	 *        instead of the mesh. the steps of both tracers run under the shared lock, the table grows between them under the exclusive one.
+	 */
+	class ClaimTable
+	{
+		std::vector<std::atomic<std::uint64_t>> slots_;	// (vertex + 1) << 32 | code, 0 while empty
+		std::atomic<size_t> size_{ 0 };
+		std::shared_mutex mutex_;
+
+		static std::uint64_t Key(int vertex) { return static_cast<std::uint64_t>(static_cast<std::uint32_t>(vertex) + 1); }
+		size_t First(int vertex) const { return (static_cast<size_t>(vertex) * 0x9e3779b1u) & (slots_.size() - 1); }
+
+	public:
+		static const int FREE = 0;
+
+		/**
+		 * @brief Constructor
+		 * @param capacity number of slots, a power of two
+		 */
+		explicit ClaimTable(size_t capacity) : slots_(capacity) {}
+
+		/**
+		 * @brief Code a vertex is claimed with, FREE if it is not claimed
+		 */
+		int Find(int vertex) const
+		{
+			const auto mask = slots_.size() - 1;
+			for (size_t i = First(vertex), n = 0; n < slots_.size(); i = (i + 1) & mask, ++n)
+			{
+				const auto slot = slots_[i].load();
+				if (slot == 0)
+				{
+					return FREE;
+				}
+				if ((slot >> 32) == Key(vertex))
+				{
+					return static_cast<int>(slot & 0xffffffffu);
+				}
+			}
+			return FREE;
+		}
+
+		/**
+		 * @brief Claim a vertex if it is free
+		 * @param vertex vertex
+		 * @param code code of the claim, not FREE
+		 * @return true if claimed, false if it was claimed before or the table is full until the next step
+		 */
+		bool Claim(int vertex, int code)
+		{
+			const auto mask = slots_.size() - 1;
+			for (size_t i = First(vertex), n = 0; n < slots_.size(); i = (i + 1) & mask, ++n)
+			{
+				auto slot = slots_[i].load();
+				if (slot == 0)
+				{
+					if (slots_[i].compare_exchange_strong(slot, (Key(vertex) << 32) | static_cast<std::uint32_t>(code)))
+					{
+						++size_;
+						return true;
+					}
+					// the slot was taken meanwhile, maybe by the same vertex
+				}
+				if ((slot >> 32) == Key(vertex))
+				{
+					return false;
+				}
+			}
+			return false;
+		}
+
+		/**
+		 * @brief Lock the table for the lookups and claims of one step, after growing it when it is half full
+		 */
+		std::shared_lock<std::shared_mutex> LockStep()
+		{
+			std::shared_lock<std::shared_mutex> lock(mutex_);
+			if (2 * size_ <= slots_.size())
+			{
+				return lock;
+			}
+			lock.unlock();
+			{
+				std::unique_lock<std::shared_mutex> grow_lock(mutex_);
+				if (2 * size_ > slots_.size())
+				{
+					std::vector<std::atomic<std::uint64_t>> slots(2 * slots_.size());
+					slots.swap(slots_);
+					size_ = 0;
+					for (const auto& slot : slots)
+					{
+						const auto value = slot.load();
+						if (value != 0)
+						{
+							Claim(static_cast<int>((value >> 32) - 1), static_cast<int>(value & 0xffffffffu));
+						}
+					}
+				}
+			}
+			lock.lock();
+			return lock;
+		}
+	};
+}
+
+
+bool CreateMarginline(
+	const PackedVectorArray& V,
 	const IndicesArray& F,
 	const std::vector<std::vector<int>>& adjacency_list,
-	const CurvatureInfo& curvature_info,
+	const CurvatureView& curvature,
 	std::vector<int>& marginline,
-	std::set<int>& visited)
+	std::pmr::set<int>& visited,
+	const Deadline& deadline,
+	const MarginlineStepCallback& on_step)
 {
 	static const size_t MAX_NUM_TRAVERSAL = 10000;
-	static const __int64 NUM_HOPS = 10;
+	static const size_t STEPS_PER_DEADLINE_CHECK = 64;
+	static const size_t MIN_LOOP_POINTS = 8;
 
 	if (marginline.empty())
 	{
-		return;
+		return true;
 	}
 
 	visited.clear();
 	visited.insert(marginline.begin(), marginline.end());
+	const auto start = marginline.front();
+
+	// candidates of a step, reused by every step from the memory resource of visited, like the arena of the job
+	std::pmr::vector<IndexAndScore> candidates(visited.get_allocator().resource());
+	auto is_free = [&visited](int v) { return visited.find(v) == visited.end(); };
 
-	auto start = marginline.back();
 	for (size_t i = 0; i < MAX_NUM_TRAVERSAL; ++i)
 	{
+		if (i % STEPS_PER_DEADLINE_CHECK == 0 && deadline.IsExceeded())
+		{
+			return false;
+		}
+
 		if (marginline.size() > 1)
 		{
 			if (marginline.front() == marginline.back())
@@ -33,125 +263,388 @@ void CreateMarginline(
 			}
 		}
 
-		auto seed = marginline.back();
-		auto neighbors = adjacency_list[seed];
+		// the first vertex is visited, the line closes the loop when it comes back next to it
+		const auto current = marginline.back();
+		const auto& neighbors = adjacency_list[current];
+		if (marginline.size() >= MIN_LOOP_POINTS && std::find(neighbors.begin(), neighbors.end(), start) != neighbors.end())
+		{
+			marginline.push_back(start);
+			if (on_step && !on_step(start))
+			{
+				return false;
+			}
+			break;
+		}
+
+		const auto next = SelectNextVertex(V, adjacency_list, curvature, marginline, is_free, nullptr, candidates);
+		if (next < 0)
+		{
+			break;
+		}
+		// the neighbours of the first vertex are left open, the line closes the loop through one of them
+		marginline.push_back(next);
+		visited.insert(next);
+		if (current != start)
+		{
+			visited.insert(neighbors.begin(), neighbors.end());
+		}
+		if (on_step && !on_step(next))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
 
-		const Eigen::Vector3d max_curvature_direction = curvature_info.principal_directions1.row(seed);
-		const Eigen::Vector3d min_curvature_direction = curvature_info.principal_directions2.row(seed);
+bool CreateMarginlineOnRidges(
+	const PackedVectorArray& V,
+	const std::vector<std::vector<int>>& adjacency_list,
+	const CurvatureView& curvature,
+	const RidgeGraph& ridge_graph,
+	std::vector<int>& marginline,
+	std::pmr::set<int>& visited,
+	const Deadline& deadline,
+	const MarginlineStepCallback& on_step)
+{
+	static const size_t MAX_NUM_TRAVERSAL = 10000;
+	static const size_t NUM_HOPS = 10;
+	static const size_t STEPS_PER_DEADLINE_CHECK = 64;
+	static const int MAX_SEED_RINGS = 8;
+	static const size_t MIN_LOOP_POINTS = 8;
+
+	if (marginline.empty() || ridge_graph.empty())
+	{
+		return true;
+	}
 
+	visited.clear();
+
+	// the seed is moved to the ridge vertex of largest mean curvature in the nearest ring that has one
+	auto start = ridge_graph.Find(marginline.back());
+	if (start < 0)
+	{
+		std::pmr::vector<int> ring(1, marginline.back(), visited.get_allocator().resource());
+		std::pmr::vector<int> next_ring(visited.get_allocator().resource());
+		visited.insert(marginline.back());
+		for (int k = 0; k < MAX_SEED_RINGS && start < 0 && !ring.empty(); ++k)
 		{
-			using IndexAndMeanCurvature = std::tuple<int, double>;
-			std::vector< IndexAndMeanCurvature> candidates;
-			for (size_t j = 0; j < neighbors.size(); ++j)
+			next_ring.clear();
+			for (auto v : ring)
 			{
-				auto& neigbor = neighbors[j];
-				auto found = visited.find(neigbor);
-				if (found != visited.end())
-				{
-					continue;
-				}
-
-				Eigen::Vector3d direction = (V.row(neigbor) - V.row(seed)).normalized();
-				assert(marginline.size() > 0);
-				auto start = std::max(static_cast<__int64>(0), static_cast<__int64>(marginline.size()) - NUM_HOPS - 1);
-				auto end = static_cast<__int64>(marginline.size() - 1);
-				auto is_opposite_direction = false;
-				for (__int64 k = start; k < end; ++k)
+				for (auto neighbor : adjacency_list[v])
 				{
-					Eigen::Vector3d existing_direction = (V.row(marginline[k + 1]) - V.row(marginline[k])).normalized();
-					if (direction.dot(existing_direction) < 0.0)
+					if (!visited.insert(neighbor).second)
 					{
-						is_opposite_direction = true;
-						break;
+						continue;
+					}
+					next_ring.push_back(neighbor);
+					auto r = ridge_graph.Find(neighbor);
+					if (r >= 0 && (start < 0 || curvature.mean(neighbor) > curvature.mean(ridge_graph.vertices[start])))
+					{
+						start = r;
 					}
 				}
-				if (is_opposite_direction)
-				{
-					continue;
-				}
+			}
+			ring.swap(next_ring);
+		}
+		visited.clear();
+		if (start < 0)
+		{
+			return true;
+		}
+		marginline.assign(1, ridge_graph.vertices[start]);
+		if (on_step && !on_step(marginline.back()))
+		{
+			return false;
+		}
+	}
 
-				candidates.push_back(std::make_tuple(neigbor, curvature_info.mean[neigbor]));
+	const auto start_vertex = ridge_graph.vertices[start];
+	visited.insert(start_vertex);
+	for (size_t i = 0; i < MAX_NUM_TRAVERSAL; ++i)
+	{
+		if (i % STEPS_PER_DEADLINE_CHECK == 0 && deadline.IsExceeded())
+		{
+			return false;
+		}
+
+		const auto current = marginline.back();
+		const auto r = ridge_graph.Find(current);
+		const auto& neighbors = ridge_graph.adjacency_list[r];
+		const auto& costs = ridge_graph.costs[r];
+
+		// heading over the last hops, the walk does not turn back
+		const auto back = marginline.size() > NUM_HOPS ? marginline.size() - NUM_HOPS - 1 : 0;
+		const Eigen::RowVector3d heading = V.row(current) - V.row(marginline[back]);
+		const Eigen::RowVector3d along = ridge_graph.directions.row(r);
+
+		auto next = -1;
+		auto next_cost = 0.0;
+		auto is_closed = false;
+		for (size_t j = 0; j < neighbors.size(); ++j)
+		{
+			const auto neighbor = ridge_graph.vertices[neighbors[j]];
+			if (neighbor == start_vertex && marginline.size() >= MIN_LOOP_POINTS)
+			{
+				is_closed = true;
+				break;
 			}
-			if (!candidates.empty())
+			if (visited.find(neighbor) != visited.end())
 			{
-				auto max_element = std::max_element(candidates.begin(), candidates.end(), [](const auto& lhs, const auto& rhs)
-					{
-						return std::get<1>(lhs) < std::get<1>(rhs);
-					});
-				if (std::get<1>(*max_element) > curvature_info.mean[seed])
-				{
-					seed = std::get<0>(*max_element);
-					marginline.push_back(seed);
-					visited.insert(neighbors.begin(), neighbors.end());
-					continue;
-				}
+				continue;
+			}
+
+			const Eigen::RowVector3d direction = (V.row(neighbor) - V.row(current)).normalized();
+			if (direction.dot(heading) < 0.0)
+			{
+				continue;
+			}
+
+			// cheap edges along the ridge direction first
+			const auto cost = costs[j] * (2.0 - std::abs(direction.dot(along)));
+			if (next < 0 || cost < next_cost)
+			{
+				next = neighbor;
+				next_cost = cost;
 			}
 		}
 
+		if (is_closed)
 		{
-			using IndexAndAbsCos = std::tuple<int, double>;
-			std::vector<IndexAndAbsCos> candidates;
-			for (size_t j = 0; j < neighbors.size(); ++j)
+			marginline.push_back(start_vertex);
+			if (on_step && !on_step(start_vertex))
 			{
-				auto& neigbor = neighbors[j];
-				auto found = visited.find(neigbor);
-				if (found != visited.end())
-				{
-					continue;
-				}
+				return false;
+			}
+			break;
+		}
+		if (next < 0)
+		{
+			break;
+		}
+
+		// the neighbours of the first vertex are left open, the walk closes the loop through one of them
+		marginline.push_back(next);
+		visited.insert(next);
+		if (current != start_vertex)
+		{
+			for (auto neighbor : neighbors)
+			{
+				visited.insert(ridge_graph.vertices[neighbor]);
+			}
+		}
+		if (on_step && !on_step(next))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool CreateMarginlineBidirectional(
+	const PackedVectorArray& V,
+	const std::vector<std::vector<int>>& adjacency_list,
+	const CurvatureView& curvature,
+	std::vector<int>& marginline,
+	std::pmr::set<int>& visited,
+	const Deadline& deadline,
+	const MarginlineStepCallback& on_step)
+{
+	static const size_t MAX_NUM_TRAVERSAL = 10000;
+	static const size_t STEPS_PER_DEADLINE_CHECK = 64;
+	static const size_t MIN_LOOP_POINTS = 8;
+	static const size_t MAX_NUM_TRAVERSAL_PER_TRACER = MAX_NUM_TRAVERSAL / 2;	// the line is as long as that of CreateMarginline at most
+	static const size_t NUM_HEAD_STEPS = 10;
+	static const size_t NUM_INITIAL_CLAIMS = 1024;
+	static const int FREE = ClaimTable::FREE;
+
+	if (marginline.empty())
+	{
+		return true;
+	}
 
-				if (curvature_info.mean[seed] > 0 && curvature_info.mean[neigbor] < 0)
+	// claim code of a vertex: the tracer that claimed it and its step then, FREE while unclaimed.
+	// a vertex is claimed once by compare and swap, so the tracers never step on the same vertex.
+	// the tracers allocate on their own threads, so nothing here comes from the memory resource of visited
+	const auto seed = marginline.back();
+	ClaimTable claims(NUM_INITIAL_CLAIMS);
+	auto encode = [](int tracer, size_t step) { return static_cast<int>(step) * 2 + tracer + 1; };
+	auto owner_tracer = [](int code) { return (code - 1) % 2; };
+	auto owner_step = [](int code) { return static_cast<size_t>((code - 1) / 2); };
+	auto claim = [&](int vertex, int tracer, size_t step)
+		{
+			return claims.Claim(vertex, encode(tracer, step));
+		};
+	auto is_free = [&](int v) { return claims.Find(v) == FREE; };
+
+	// the tracers leave the seed in opposite directions along the margin, principal_direction1 as in the steps of SelectNextVertex.
+	// on umbilic seeds without a direction, the first edge of the seed gives the sides
+	Eigen::RowVector3d direction = curvature.principal_direction1(seed);
+	if (direction.squaredNorm() == 0.0 && !adjacency_list[seed].empty())
+	{
+		direction = V.row(adjacency_list[seed].front()) - V.row(seed);
+	}
+	const Eigen::RowVector3d first_directions[2] = { direction, -direction };
+	std::vector<int> paths[2];
+	std::pmr::vector<IndexAndScore> candidates[2];
+	claim(seed, 0, 0);
+	for (int t = 0; t < 2; ++t)
+	{
+		paths[t].reserve(MAX_NUM_TRAVERSAL_PER_TRACER + 2);
+		paths[t].push_back(seed);
+		candidates[t].reserve(adjacency_list[seed].size() + 16);
+		auto first = SelectNextVertex(V, adjacency_list, curvature, paths[t], is_free, &first_directions[t], candidates[t]);
+		if (first >= 0 && claim(first, t, 1))
+		{
+			paths[t].push_back(first);
+		}
+	}
+	for (auto neighbor : adjacency_list[seed])
+	{
+		// the ring of the seed is split between the tracers, a tracer walking the loop alone meets the other half
+		claim(neighbor, (V.row(neighbor) - V.row(seed)).dot(direction) > 0.0 ? 0 : 1, 0);
+	}
+
+	// the first tracer to find a vertex of the other next to its head records where they meet
+	struct Meeting
+	{
+		int tracer = -1;	// tracer that found the other
+		size_t step = 0;	// its step
+		int bridge = -1;	// vertex of the other tracer next to its head
+		size_t other_step = 0;	// step of the other tracer when it claimed the bridge
+	};
+	Meeting meeting;
+
+	// a tracer reads the path of the other up to its published head, the paths never reallocate
+	const int* path_data[2] = { paths[0].data(), paths[1].data() };
+	std::atomic<size_t> head_steps[2] = { paths[0].size() - 1, paths[1].size() - 1 };
+	auto heading = [&](int t, size_t step) -> Eigen::RowVector3d
+		{
+			return V.row(path_data[t][step]) - V.row(path_data[t][step > NUM_HEAD_STEPS ? step - NUM_HEAD_STEPS : 0]);
+		};
+	std::atomic<bool> is_met(false);
+	std::atomic<bool> is_stopped(false);
+	std::atomic<bool> is_exceeded(false);
+
+	auto trace = [&](int t)
+		{
+			auto& path = paths[t];
+			for (size_t i = 0; path.size() > 1 && i < MAX_NUM_TRAVERSAL_PER_TRACER && !is_met && !is_stopped; ++i)
+			{
+				const auto lock = claims.LockStep();
+
+				if (i % STEPS_PER_DEADLINE_CHECK == 0 && deadline.IsExceeded())
 				{
-					continue;
+					is_exceeded = true;
+					is_stopped = true;
+					return;
 				}
 
-				Eigen::Vector3d direction = (V.row(neigbor) - V.row(seed)).normalized();
-#if 0
-				assert(result.size() > 0);
-				auto start = std::max(static_cast<__int64>(0), static_cast<__int64>(result.size()) - NUM_HOPS - 1);
-				auto end = static_cast<__int64>(result.size() - 1);
-				auto is_opposite_direction = false;
-				for (__int64 k = start; k < end; ++k)
+				// proximity test, a neighbour claimed by the head of the other tracer once the halves are long enough to close the loop.
+				// the heads meet where the loop closes, coming from opposite sides. the older part of the other half
+				// and a head going alongside are only in the way. on the ring of the seed, the heading is that of the first step
+				const auto current = path.back();
+				for (auto neighbor : adjacency_list[current])
 				{
-					Eigen::Vector3d existing_direction = (V.row(result[k + 1]) - V.row(result[k])).normalized();
-					if (direction.dot(existing_direction) < 0.0)
+					const auto code = claims.Find(neighbor);
+					if (code == FREE || owner_tracer(code) == t || path.size() - 1 + owner_step(code) < MIN_LOOP_POINTS)
+					{
+						continue;
+					}
+					const auto other_head = head_steps[1 - t].load();
+					if (owner_step(code) + NUM_HEAD_STEPS < other_head ||
+						heading(t, path.size() - 1).dot(heading(1 - t, std::min(std::max<size_t>(owner_step(code), 1), other_head))) > 0.0)
 					{
-						is_opposite_direction = true;
-						break;
+						continue;
 					}
+					auto expected = false;
+					if (is_met.compare_exchange_strong(expected, true))
+					{
+						meeting = { t, path.size() - 1, neighbor, owner_step(code) };
+					}
+					return;
+				}
+
+				const auto next = SelectNextVertex(V, adjacency_list, curvature, path, is_free, &first_directions[t], candidates[t]);
+				if (next < 0)
+				{
+					return;
 				}
-				if (is_opposite_direction)
+				if (!claim(next, t, path.size()))
 				{
-					continue;
+					continue;	// taken by the other tracer meanwhile, choose again
 				}
-#endif
-
-				candidates.push_back(std::make_tuple(neigbor, std::abs(direction.dot(min_curvature_direction))));
+				for (auto neighbor : adjacency_list[current])
+				{
+					claim(neighbor, t, path.size() - 1);
+				}
+				path.push_back(next);
+				head_steps[t] = path.size() - 1;
 			}
-			if (candidates.empty())
+		};
+	std::thread backward(trace, 1);
+	trace(0);
+	backward.join();
+
+	// stitching, the forward half from the seed, then the backward half back to the seed
+	marginline.clear();
+	if (is_met)
+	{
+		const auto ends = meeting.tracer == 0
+			? std::make_pair(meeting.step, meeting.other_step)
+			: std::make_pair(meeting.other_step, meeting.step);
+		marginline.assign(paths[0].begin(), paths[0].begin() + ends.first + 1);
+		if (meeting.bridge != paths[0][ends.first] && meeting.bridge != paths[1][ends.second])
+		{
+			marginline.push_back(meeting.bridge);
+		}
+		marginline.insert(marginline.end(), paths[1].rbegin() + (paths[1].size() - ends.second - 1), paths[1].rend());
+	}
+	else
+	{
+		// an open line through the seed, with the halves as far as they went
+		marginline.assign(paths[1].rbegin(), paths[1].rend());
+		marginline.insert(marginline.end(), paths[0].begin() + 1, paths[0].end());
+	}
+
+	// the claims are the vertices of both paths with their rings, but for the heads that did not step on
+	visited.clear();
+	for (const auto& path : paths)
+	{
+		for (size_t i = 0; i < path.size(); ++i)
+		{
+			visited.insert(path[i]);
+			if (i == 0 || i + 1 < path.size())
 			{
-				break;
+				visited.insert(adjacency_list[path[i]].begin(), adjacency_list[path[i]].end());
 			}
+		}
+	}
 
-			auto next = std::max_element(candidates.begin(), candidates.end(), [](const auto& lhs, const auto& rhs)
-				{
-					return std::get<1>(lhs) < std::get<1>(rhs);
-				});
-			seed = std::get<0>(*next);
-			marginline.push_back(seed);
-			visited.insert(neighbors.begin(), neighbors.end());
+	// the line is reported once it is stitched, in its order
+	if (on_step)
+	{
+		for (size_t i = marginline.front() == seed ? 1 : 0; i < marginline.size(); ++i)
+		{
+			if (!on_step(marginline[i]))
+			{
+				return false;
+			}
 		}
 	}
+	return !is_exceeded;
 }
 
 
+
 std::vector<int> DownSampleMarginline(
-	const VectorArray& V,
+	const PackedVectorArray& V,
 	const IndicesArray& F,
 	const std::vector<std::vector<int>>& adjacency_list,
-	const CurvatureInfo& curvature_info,
+	const CurvatureView& curvature,
 	const std::vector<int>& marginline,
-	const std::set<int>& visited,
+	const std::pmr::set<int>& visited,
 	size_t num_samples,
 	double threshold_to_remove_last_point)
 {
@@ -176,6 +669,14 @@ std::vector<int> DownSampleMarginline(
 	auto modulus = marginline.size() % num_samples;
 	auto should_remove_last_point = modulus > threshold_to_remove_last_point;
 	auto indices = linspace(0, static_cast<int>(marginline.size()) - 1, static_cast<int>(num_samples), should_remove_last_point);
-	return indices;
+
+	// indices are positions along the margin line, the samples are the vertices there
+	std::vector<int> samples;
+	samples.reserve(indices.size());
+	for (auto index : indices)
+	{
+		samples.push_back(marginline[index]);
+	}
+	return samples;
 
 }
\ No newline at end of file
@@ -1,36 +1,104 @@
 #pragma once
+#include <functional>
+#include <memory_resource>
 #include <set>
+#include "deadline.h"
 #include "type.h"
 
 
-struct CurvatureInfo;
+class CurvatureView;
+struct RidgeGraph;
+
+
+/**
+ * @brief Called with each vertex appended to the margin line while it is traced
+ *        returning false stops the traversal.
+ */
+using MarginlineStepCallback = std::function<bool(int vertex)>;
 
 
 /**
  * @brief Traverse the mesh along the margin line
- * @param V [i] vertices
+ *        each step goes up the mean curvature, or along principal_directions1, and the line ends when it gets back next to its first vertex.
+ * @param V [i] vertices in packed layout
  * @param F [i] faces
  * @param adjacency_list [i] adjacency list
- * @param curvature_info [i] curvature information
+ * @param curvature [i] curvature information
  * @param marginline [i/o] marginline must have a seed point as input
- * @param visited [o] visited vertices
- * @return void
+ * @param visited [o] visited vertices, the scratch memory of the traversal comes from its memory resource
+ * @param deadline [i] deadline checked while traversing
+ * @param on_step [i] called with each appended vertex, may be empty
+ * @return false if the deadline is exceeded or on_step stops the traversal, marginline then holds the points traced so far. true otherwise
  */
-void CreateMarginline(
-	const VectorArray& V,
+bool CreateMarginline(
+	const PackedVectorArray& V,
 	const IndicesArray& F,
 	const std::vector<std::vector<int>>& adjacency_list,
-	const CurvatureInfo& curvature_info,
+	const CurvatureView& curvature,
+	std::vector<int>& marginline,
+	std::pmr::set<int>& visited,
+	const Deadline& deadline = Deadline(),
+	const MarginlineStepCallback& on_step = MarginlineStepCallback());
+
+
+/**
+ * @brief Traverse the ridge graph along the margin line
+ *        the walk stays on the ridge vertices and ends when it gets back next to its first vertex, or at the end of the ridge.
+ * @param V [i] vertices in packed layout
+ * @param adjacency_list [i] adjacency list of the mesh, to find the ridge vertex nearest to the seed
+ * @param curvature [i] curvature information
+ * @param ridge_graph [i] ridge graph of the mesh
+ * @param marginline [i/o] marginline must have a seed point as input, it is moved to the nearest ridge vertex
+ * @param visited [o] visited vertices, the scratch memory of the traversal comes from its memory resource
+ * @param deadline [i] deadline checked while traversing
+ * @param on_step [i] called with each appended vertex, may be empty
+ * @return false if the deadline is exceeded or on_step stops the traversal, marginline then holds the points traced so far. true otherwise
+ */
+bool CreateMarginlineOnRidges(
+	const PackedVectorArray& V,
+	const std::vector<std::vector<int>>& adjacency_list,
+	const CurvatureView& curvature,
+	const RidgeGraph& ridge_graph,
+	std::vector<int>& marginline,
+	std::pmr::set<int>& visited,
+	const Deadline& deadline = Deadline(),
+	const MarginlineStepCallback& on_step = MarginlineStepCallback());
+
+
+/**
+ * @brief Traverse the mesh along the margin line with two tracers, leaving the seed in opposite directions along the margin
+ *        that is principal_directions1 at the seed, the direction CreateMarginline steps along.
+ *        each tracer takes half the steps of CreateMarginline, so the line is no longer than its line.
+ *        the tracers run concurrently with the rules of CreateMarginline, each vertex is claimed by one tracer only.
+ *        they stop when one finds a vertex claimed by the other next to its head, and the halves are stitched into a loop
+ *        from the seed and back to it. when they do not meet, marginline is the open line through the seed as far as they went.
+ *        the vertices are reported to on_step once the line is stitched.
+ *        the result is not deterministic: which tracer claims a contested vertex, and where they meet, depends on the timing of the threads.
+ * @param V [i] vertices in packed layout
+ * @param adjacency_list [i] adjacency list
+ * @param curvature [i] curvature information
+ * @param marginline [i/o] marginline must have a seed point as input
+ * @param visited [o] vertices claimed by the tracers, the claims are allocated from its memory resource on the calling thread
+ * @param deadline [i] deadline checked by both tracers while traversing
+ * @param on_step [i] called with each vertex of the stitched line, may be empty
+ * @return false if the deadline is exceeded or on_step stops the traversal, marginline then holds the points traced so far. true otherwise
+ */
+bool CreateMarginlineBidirectional(
+	const PackedVectorArray& V,
+	const std::vector<std::vector<int>>& adjacency_list,
+	const CurvatureView& curvature,
 	std::vector<int>& marginline,
-	std::set<int>& visited);
+	std::pmr::set<int>& visited,
+	const Deadline& deadline = Deadline(),
+	const MarginlineStepCallback& on_step = MarginlineStepCallback());
 
 
 /**
 * @brief Traverse the mesh along the margin line
-* @param V [i] vertices
+* @param V [i] vertices in packed layout
 * @param F [i] faces
 * @param adjacency_list [i] adjacency list
-* @param curvature_info [i] curvature information
+* @param curvature [i] curvature information
 * @param marginline [i/o] marginline must have a seed point as input
 * @param visited [o] visited vertices
 * @param num_samples [i] number of samples
@@ -38,11 +106,11 @@ void CreateMarginline(
 * @return downsampled marginline 
 */
 std::vector<int> DownSampleMarginline(
-	const VectorArray& V,
+	const PackedVectorArray& V,
 	const IndicesArray& F,
 	const std::vector<std::vector<int>>& adjacency_list,
-	const CurvatureInfo& curvature_info,
+	const CurvatureView& curvature,
 	const std::vector<int>& marginline,
-	const std::set<int>& visited,
+	const std::pmr::set<int>& visited,
 	size_t num_samples,
 	double threshold_to_remove_last_point);
\ No newline at end of file
@@ -0,0 +1,178 @@
+#include "mesh_picker.h"
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include <igl/Hit.h>
+#include <igl/unproject_ray.h>
+
+
+namespace
+{
+	/**
+	 * @brief Corner of a face nearest to a point
+	 * @param V vertices
+	 * @param F faces
+	 * @param face face index
+	 * @param point point
+	 * @return vertex index
+	 */
+	int NearestCorner(const VectorArray& V, const IndicesArray& F, int face, const Eigen::RowVector3d& point)
+	{
+		auto nearest_vertex = -1;
+		auto nearest_distance2 = std::numeric_limits<double>::max();
+		for (Eigen::Index i = 0; i < 3; ++i)
+		{
+			auto v = F(face, i);
+			auto distance2 = (V.row(v) - point).squaredNorm();
+			if (distance2 < nearest_distance2)
+			{
+				nearest_vertex = v;
+				nearest_distance2 = distance2;
+			}
+		}
+		return nearest_vertex;
+	}
+}
+
+
+void MeshPicker::Build(const VectorArray& V, const IndicesArray& F)
+{
+	tree_.deinit();
+	tree_.init(V, F);
+	V_ = &V;
+	F_ = &F;
+}
+
+
+void MeshPicker::Clear()
+{
+	tree_.deinit();
+	V_ = nullptr;
+	F_ = nullptr;
+}
+
+
+bool MeshPicker::Pick(const Eigen::Vector3d& origin, const Eigen::Vector3d& direction, PickHit& hit) const
+{
+	if (empty() || F_->rows() == 0)
+	{
+		return false;
+	}
+
+	igl::Hit igl_hit;
+	if (!tree_.intersect_ray(*V_, *F_, origin.transpose(), direction.transpose(), igl_hit))
+	{
+		return false;
+	}
+
+	hit.face = igl_hit.id;
+	hit.barycentric = Eigen::Vector3d(1.0 - igl_hit.u - igl_hit.v, igl_hit.u, igl_hit.v);
+	hit.point = origin + static_cast<double>(igl_hit.t) * direction;
+	hit.vertex = NearestCorner(*V_, *F_, hit.face, hit.point.transpose());
+	return true;
+}
+
+
+bool MeshPicker::Pick(const Eigen::Vector2f& position, const Eigen::Matrix4f& view, const Eigen::Matrix4f& proj, const Eigen::Vector4f& viewport, PickHit& hit) const
+{
+	Eigen::Vector3f source;
+	Eigen::Vector3f direction;
+	if (!igl::unproject_ray(position, view, proj, viewport, source, direction))
+	{
+		return false;
+	}
+	return Pick(source.cast<double>(), direction.cast<double>(), hit);
+}
+
+
+int MeshPicker::FindNearestVertex(const Eigen::Vector3d& point) const
+{
+	if (empty() || F_->rows() == 0)
+	{
+		return -1;
+	}
+
+	int face = -1;
+	Eigen::RowVector3d closest;
+	tree_.squared_distance(*V_, *F_, point.transpose(), face, closest);
+	return NearestCorner(*V_, *F_, face, point.transpose());
+}
+
+
+void test_mesh_picker_00()
+{
+	try
+	{
+		auto testing_json = "..\\tests\\mesh_picker_00.json";
+
+		std::ifstream ifs(testing_json);
+		if (!ifs.is_open())
+		{
+			throw std::runtime_error("Can't open file.");
+		}
+		auto j = nlohmann::json::parse(ifs);
+
+		auto to_vector = [](const nlohmann::json& xyz)
+			{
+				return Eigen::Vector3d(xyz.at(0).get<double>(), xyz.at(1).get<double>(), xyz.at(2).get<double>());
+			};
+		const auto vertices = j.at("vertices").get<std::vector<std::vector<double>>>();
+		const auto faces = j.at("faces").get<std::vector<std::vector<int>>>();
+		VectorArray V(vertices.size(), 3);
+		for (size_t i = 0; i < vertices.size(); ++i)
+		{
+			V.row(i) << vertices[i][0], vertices[i][1], vertices[i][2];
+		}
+		IndicesArray F(faces.size(), 3);
+		for (size_t i = 0; i < faces.size(); ++i)
+		{
+			F.row(i) << faces[i][0], faces[i][1], faces[i][2];
+		}
+
+		// queries of an empty picker find nothing
+		MeshPicker picker;
+		PickHit hit;
+		if (picker.Pick(Eigen::Vector3d::Zero(), Eigen::Vector3d::UnitZ(), hit) || picker.FindNearestVertex(Eigen::Vector3d::Zero()) != -1)
+		{
+			throw std::runtime_error("empty picker found a face");
+		}
+
+		picker.Build(V, F);
+		for (const auto& ray : j.at("rays"))
+		{
+			const auto origin = to_vector(ray.at("origin"));
+			const auto expected_face = ray.at("face").get<int>();
+			hit = PickHit();
+			const auto is_hit = picker.Pick(origin, to_vector(ray.at("direction")), hit);
+			if (is_hit != (expected_face >= 0)
+				|| hit.face != expected_face
+				|| hit.vertex != ray.at("vertex").get<int>()
+				|| (is_hit && (hit.point - to_vector(ray.at("point"))).norm() > 1e-6))
+			{
+				throw std::runtime_error("unexpected hit of the ray from " + ray.at("origin").dump() + ": face " + std::to_string(hit.face) + ", vertex " + std::to_string(hit.vertex));
+			}
+		}
+		for (const auto& query : j.at("points"))
+		{
+			const auto vertex = picker.FindNearestVertex(to_vector(query.at("point")));
+			if (vertex != query.at("vertex").get<int>())
+			{
+				throw std::runtime_error("unexpected nearest vertex of " + query.at("point").dump() + ": " + std::to_string(vertex));
+			}
+		}
+
+		picker.Clear();
+		if (!picker.empty() || picker.FindNearestVertex(Eigen::Vector3d::Zero()) != -1)
+		{
+			throw std::runtime_error("cleared picker found a vertex");
+		}
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+	}
+}
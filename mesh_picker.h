@@ -0,0 +1,74 @@
+#pragma once
+#include <igl/AABB.h>
+#include "type.h"
+
+
+/**
+ * @brief Face hit by a picking ray
+ */
+struct PickHit
+{
+	int face = -1;	// face index
+	Eigen::Vector3d barycentric = Eigen::Vector3d::Zero();	// barycentric coordinates of the hit in the face
+	Eigen::Vector3d point = Eigen::Vector3d::Zero();	// hit point
+	int vertex = -1;	// corner of the face nearest to the hit
+};
+
+
+/**
+ * @brief Picking queries on a mesh, backed by an AABB tree built once
+ *        the queries need no display, screen positions are unprojected from the given matrices.
+ *        the mesh must outlive the picker, and Build() must be called again after it is edited.
+ */
+class MeshPicker
+{
+	igl::AABB<VectorArray, 3> tree_;
+	const VectorArray* V_ = nullptr;
+	const IndicesArray* F_ = nullptr;
+
+public:
+	/**
+	 * @brief Build the tree of a mesh
+	 * @param V vertices
+	 * @param F faces
+	 */
+	void Build(const VectorArray& V, const IndicesArray& F);
+
+	/**
+	 * @brief Release the tree
+	 */
+	void Clear();
+
+	bool empty() const { return V_ == nullptr; }
+
+	/**
+	 * @brief Find the first face hit by a ray
+	 * @param origin origin of the ray
+	 * @param direction direction of the ray, not necessarily normalized
+	 * @param hit [o] hit
+	 * @return true if a face is hit, false otherwise
+	 */
+	bool Pick(const Eigen::Vector3d& origin, const Eigen::Vector3d& direction, PickHit& hit) const;
+
+	/**
+	 * @brief Find the first face under a screen position, as igl::unproject_onto_mesh
+	 * @param position position in the viewport, origin at the bottom left
+	 * @param view view matrix
+	 * @param proj projection matrix
+	 * @param viewport viewport (x, y, width, height)
+	 * @param hit [o] hit
+	 * @return true if a face is hit, false otherwise
+	 */
+	bool Pick(const Eigen::Vector2f& position, const Eigen::Matrix4f& view, const Eigen::Matrix4f& proj, const Eigen::Vector4f& viewport, PickHit& hit) const;
+
+	/**
+	 * @brief Find the nearest vertex to a point, a corner of the nearest face
+	 * @param point point
+	 * @return index of the nearest vertex, -1 if the tree is not built
+	 */
+	int FindNearestVertex(const Eigen::Vector3d& point) const;
+};
+
+
+// testing
+void test_mesh_picker_00();
@@ -0,0 +1,224 @@
+#include "normal_cycle.h"
+#include <atomic>
+#include <cmath>
+#include <Eigen/Eigenvalues>
+#include <Eigen/Geometry>
+#include <igl/parallel_for.h>
+#include "geometry_utils.h"
+
+
+namespace
+{
+	static const Eigen::Index VERTICES_PER_DEADLINE_CHECK = 4096;
+
+
+	/**
+	 * @brief Calculate the unit normal and the area of each face
+	 * @param V [i] vertices
+	 * @param F [i] faces
+	 * @param FN [o] unit face normals, zero for degenerate faces
+	 * @param areas [o] face areas
+	 */
+	void CalcFaceNormals(const VectorArray& V, const IndicesArray& F, PackedVectorArray& FN, ScalarArray& areas)
+	{
+		FN.resize(F.rows(), 3);
+		areas.resize(F.rows());
+		igl::parallel_for(F.rows(), [&](Eigen::Index f)
+			{
+				const Eigen::RowVector3d p0 = V.row(F(f, 0));
+				const Eigen::RowVector3d e1 = V.row(F(f, 1)) - p0;
+				const Eigen::RowVector3d e2 = V.row(F(f, 2)) - p0;
+				const Eigen::RowVector3d n = e1.cross(e2);
+				const auto norm = n.norm();
+				FN.row(f) = norm > 0.0 ? Eigen::RowVector3d(n / norm) : Eigen::RowVector3d::Zero();
+				areas(f) = 0.5 * norm;
+			}, 1000);
+	}
+
+
+	/**
+	 * @brief Sum the tensors of the edges incident to a vertex, each edge is found from the face it leaves the vertex in
+	 * @param V [i] vertices
+	 * @param F [i] faces
+	 * @param vertex_faces [i] faces incident to each vertex
+	 * @param FN [i] unit face normals
+	 * @param face_areas [i] face areas
+	 * @param v [i] vertex
+	 * @param area [o] barycentric area of the vertex
+	 * @return half of beta |e| e e^T summed over the edges, zero for boundary edges
+	 */
+	Eigen::Matrix3d EdgeTensor(
+		const VectorArray& V,
+		const IndicesArray& F,
+		const std::vector<std::vector<int>>& vertex_faces,
+		const PackedVectorArray& FN,
+		const ScalarArray& face_areas,
+		int v,
+		double& area)
+	{
+		Eigen::Matrix3d tensor = Eigen::Matrix3d::Zero();
+		area = 0.0;
+		const auto& faces = vertex_faces[v];
+		for (auto f : faces)
+		{
+			area += face_areas(f) / 3.0;
+
+			Eigen::Index k = 0;
+			while (k < 3 && F(f, k) != v)
+			{
+				++k;
+			}
+			const auto u = F(f, (k + 1) % 3);
+
+			// the other face of the edge, which goes from u back to v
+			auto twin = -1;
+			for (auto g : faces)
+			{
+				if (g != f && (F(g, 0) == u || F(g, 1) == u || F(g, 2) == u))
+				{
+					twin = g;
+					break;
+				}
+			}
+			if (twin < 0)
+			{
+				continue;
+			}
+
+			const Eigen::RowVector3d edge = V.row(u) - V.row(v);
+			const auto length = edge.norm();
+			if (length == 0.0)
+			{
+				continue;
+			}
+			const Eigen::Vector3d direction = (edge / length).transpose();
+			const Eigen::Vector3d n0 = FN.row(f).transpose();
+			const Eigen::Vector3d n1 = FN.row(twin).transpose();
+			const auto beta = std::atan2(n0.cross(n1).dot(direction), n0.dot(n1));	// positive on convex edges
+			tensor.noalias() += (0.5 * beta * length) * direction * direction.transpose();
+		}
+		return tensor;
+	}
+}
+
+
+bool CalcNormalCycleCurvatures(
+	const VectorArray& V,
+	const IndicesArray& F,
+	const std::vector<std::vector<int>>& adjacency_list,
+	const std::vector<std::vector<int>>& vertex_faces,
+	int rings,
+	PackedVectorArray& PD1,
+	PackedVectorArray& PD2,
+	ScalarArray& PV1,
+	ScalarArray& PV2,
+	const Deadline& deadline)
+{
+	const auto num_vertices = V.rows();
+	PackedVectorArray FN;
+	ScalarArray face_areas;
+	CalcFaceNormals(V, F, FN, face_areas);
+
+	std::atomic<bool> is_exceeded(false);
+	std::vector<Eigen::Matrix3d> tensors(num_vertices);
+	ScalarArray areas(num_vertices);
+	igl::parallel_for(num_vertices, [&](Eigen::Index v)
+		{
+			if (v % VERTICES_PER_DEADLINE_CHECK == 0 && deadline.IsExceeded())
+			{
+				is_exceeded = true;
+			}
+			if (is_exceeded.load(std::memory_order_relaxed))
+			{
+				return;
+			}
+			tensors[v] = EdgeTensor(V, F, vertex_faces, FN, face_areas, static_cast<int>(v), areas(v));
+		}, 1000);
+	if (is_exceeded)
+	{
+		return false;
+	}
+
+	PD1.resize(num_vertices, 3);
+	PD2.resize(num_vertices, 3);
+	PV1.resize(num_vertices);
+	PV2.resize(num_vertices);
+	igl::parallel_for(num_vertices, [&](Eigen::Index v)
+		{
+			if (v % VERTICES_PER_DEADLINE_CHECK == 0 && deadline.IsExceeded())
+			{
+				is_exceeded = true;
+			}
+			if (is_exceeded.load(std::memory_order_relaxed))
+			{
+				return;
+			}
+
+			Eigen::Matrix3d tensor = tensors[v];
+			auto area = areas(v);
+			auto add = [&](int u)
+				{
+					tensor += tensors[u];
+					area += areas(u);
+				};
+			if (rings == 1)
+			{
+				for (auto u : adjacency_list[v])
+				{
+					add(u);
+				}
+			}
+			else if (rings > 1)
+			{
+				for (auto u : ExpandRings(adjacency_list, { static_cast<int>(v) }, rings))
+				{
+					if (u != v)
+					{
+						add(u);
+					}
+				}
+			}
+
+			Eigen::RowVector3d normal = Eigen::RowVector3d::Zero();
+			for (auto f : vertex_faces[v])
+			{
+				normal += face_areas(f) * FN.row(f);
+			}
+			const auto normal_norm = normal.norm();
+			if (area <= 0.0 || normal_norm == 0.0)
+			{
+				PD1.row(v).setZero();
+				PD2.row(v).setZero();
+				PV1(v) = 0.0;
+				PV2(v) = 0.0;
+				return;
+			}
+			normal /= normal_norm;
+
+			// tangent frame, from the axis least aligned with the normal
+			Eigen::Index axis;
+			normal.cwiseAbs().minCoeff(&axis);
+			Eigen::RowVector3d x_axis = Eigen::RowVector3d::Unit(axis);
+			x_axis = (x_axis - normal * x_axis.dot(normal)).normalized();
+			const Eigen::RowVector3d y_axis = normal.cross(x_axis);
+			Eigen::Matrix<double, 3, 2> frame;
+			frame.col(0) = x_axis.transpose();
+			frame.col(1) = y_axis.transpose();
+			const Eigen::Matrix2d tangent_tensor = frame.transpose() * tensor * frame / area;
+
+			// eigenvalues in increasing order. curvature is measured across the edges,
+			// so the eigenvector of each value is the direction of the other principal curvature
+			Eigen::SelfAdjointEigenSolver<Eigen::Matrix2d> solver(tangent_tensor);
+			const auto value1 = solver.eigenvalues()(0);
+			const auto value2 = solver.eigenvalues()(1);
+			PV1(v) = value1;
+			PV2(v) = value2;
+			// each direction is scaled by the sign of its value, as in quadric fitting: only the direction of a zero value is zero
+			auto sign = [](double value) { return value > 0.0 ? 1.0 : (value < 0.0 ? -1.0 : 0.0); };
+			const Eigen::RowVector3d direction1 = (frame * solver.eigenvectors().col(1)).transpose().normalized();
+			const Eigen::RowVector3d direction2 = (frame * solver.eigenvectors().col(0)).transpose().normalized();
+			PD1.row(v) = sign(value1) * direction1;
+			PD2.row(v) = sign(value2) * direction2;
+		}, 1000);
+	return !is_exceeded;
+}
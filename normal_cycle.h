@@ -0,0 +1,36 @@
+#pragma once
+#include <vector>
+#include "deadline.h"
+#include "type.h"
+
+
+/**
+ * @brief Compute principal curvatures from normal cycle tensors, a faster and coarser alternative to CalcPrincipalCurvatures
+ *        each edge contributes beta |e| e e^T, with beta its signed dihedral angle, half to each of its ends.
+ *        the tensors of the rings around a vertex are summed, divided by their barycentric area and restricted to the tangent plane;
+ *        the eigenvector of the larger eigenvalue is the direction of the smaller curvature and vice versa.
+ *        only face normals and the 1-ring are read, instead of a least-squares fit over the 5-ring.
+ *        outputs follow CalcPrincipalCurvatures: PV1 <= PV2, convex is positive, directions are scaled by the sign of their value.
+ * @param V [i] vertices
+ * @param F [i] faces
+ * @param adjacency_list [i] adjacency list
+ * @param vertex_faces [i] faces incident to each vertex
+ * @param rings [i] rings of vertices whose tensors are summed, 1 for the 1-ring
+ * @param PD1 [o] principal curvature direction 1
+ * @param PD2 [o] principal curvature direction 2
+ * @param PV1 [o] principal curvature value 1
+ * @param PV2 [o] principal curvature value 2
+ * @param deadline [i] deadline checked every few thousand vertices
+ * @return false if the deadline is exceeded and the outputs are incomplete, true otherwise
+ */
+bool CalcNormalCycleCurvatures(
+	const VectorArray& V,
+	const IndicesArray& F,
+	const std::vector<std::vector<int>>& adjacency_list,
+	const std::vector<std::vector<int>>& vertex_faces,
+	int rings,
+	PackedVectorArray& PD1,
+	PackedVectorArray& PD2,
+	ScalarArray& PV1,
+	ScalarArray& PV2,
+	const Deadline& deadline = Deadline());
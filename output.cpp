@@ -8,16 +8,23 @@ void Initialize(GeometryEngineOutput& output)
 {
     output.return_code = ToInt(ReturnCode::kSuccess);
     output.message = "";
+    output.interrupted_stage = "";
     output.result.type = "";
     output.result.marginline.num_original_points = 0;
     output.result.marginline.num_samples = 0;
     output.result.marginline.points.clear();
+    output.result.marginline.smoothed_points.clear();
+    output.metrics = GeometryEngineOutput::Metrics{ 0.0, 0.0, 0.0, 0.0, 0.0, 0, {} };
 }
 
 
 void to_json(nlohmann::json& j, const GeometryEngineOutput::Result::Marginline& ml)
 {
     j = nlohmann::json{ {"num_original_points", ml.num_original_points}, {"num_samples", ml.num_samples}, { "points", ml.points } };
+    if (!ml.smoothed_points.empty())
+    {
+        j["smoothed_points"] = ml.smoothed_points;
+    }
 }
 
 
@@ -27,9 +34,29 @@ void to_json(nlohmann::json& j, const GeometryEngineOutput::Result& r)
 }
 
 
+void to_json(nlohmann::json& j, const GeometryEngineOutput::Counters& c)
+{
+    j = nlohmann::json{ {"stage", c.stage}, {"cycles", c.cycles}, {"instructions", c.instructions}, {"cache_misses", c.cache_misses}, {"branch_misses", c.branch_misses}, {"page_faults", c.page_faults} };
+}
+
+
+void to_json(nlohmann::json& j, const GeometryEngineOutput::Metrics& m)
+{
+    j = nlohmann::json{ {"load_ms", m.load_ms}, {"curvature_ms", m.curvature_ms}, {"traversal_ms", m.traversal_ms}, {"export_ms", m.export_ms}, {"total_ms", m.total_ms}, {"arena_bytes", m.arena_bytes} };
+    if (!m.counters.empty())
+    {
+        j["counters"] = m.counters;
+    }
+}
+
+
 void to_json(nlohmann::json& j, const GeometryEngineOutput& geo)
 {
-    j = nlohmann::json{ {"return_code", geo.return_code}, {"message", geo.message}, {"result", geo.result}};
+    j = nlohmann::json{ {"return_code", geo.return_code}, {"message", geo.message}, {"result", geo.result}, {"metrics", geo.metrics} };
+    if (!geo.interrupted_stage.empty())
+    {
+        j["interrupted_stage"] = geo.interrupted_stage;
+    }
 }
 
 
@@ -38,6 +65,7 @@ void from_json(const nlohmann::json& j, GeometryEngineOutput::Result::Marginline
     j.at("num_original_points").get_to(ml.num_original_points);
 	j.at("num_samples").get_to(ml.num_samples); 
 	j.at("points").get_to(ml.points);
+	ml.smoothed_points = j.value("smoothed_points", std::vector<std::vector<double>>());
 }
 
 
@@ -48,11 +76,36 @@ void from_json(const nlohmann::json& j, GeometryEngineOutput::Result& r)
 }
 
 
+void from_json(const nlohmann::json& j, GeometryEngineOutput::Counters& c)
+{
+    j.at("stage").get_to(c.stage);
+    c.cycles = j.value("cycles", std::int64_t(-1));
+    c.instructions = j.value("instructions", std::int64_t(-1));
+    c.cache_misses = j.value("cache_misses", std::int64_t(-1));
+    c.branch_misses = j.value("branch_misses", std::int64_t(-1));
+    c.page_faults = j.value("page_faults", std::int64_t(-1));
+}
+
+
+void from_json(const nlohmann::json& j, GeometryEngineOutput::Metrics& m)
+{
+    m.load_ms = j.value("load_ms", 0.0);
+    m.curvature_ms = j.value("curvature_ms", 0.0);
+    m.traversal_ms = j.value("traversal_ms", 0.0);
+    m.export_ms = j.value("export_ms", 0.0);
+    m.total_ms = j.value("total_ms", 0.0);
+    m.arena_bytes = j.value("arena_bytes", std::uint64_t(0));
+    m.counters = j.value("counters", std::vector<GeometryEngineOutput::Counters>());
+}
+
+
 void from_json(const nlohmann::json& j, GeometryEngineOutput& geo)
 {
 	j.at("return_code").get_to(geo.return_code);
     j.at("message").get_to(geo.message);
+    geo.interrupted_stage = j.value("interrupted_stage", "");
 	j.at("result").get_to(geo.result);
+    geo.metrics = j.value("metrics", GeometryEngineOutput::Metrics{ 0.0, 0.0, 0.0, 0.0, 0.0, 0, {} });
 }
 
 
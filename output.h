@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <nlohmann/json.hpp>
@@ -10,15 +11,37 @@ struct GeometryEngineOutput {
             int num_original_points; // number of original points
             int num_samples; // number of samples
             std::vector<std::vector<double>> points; // 3W̔z
+            std::vector<std::vector<double>> smoothed_points; // points after Chaikin smoothing, empty unless smoothing_iterations is given
         };
 
         std::string type;      // Operation data type, like 'marginline'
         Marginline marginline; // output data to generate initial margin line
     };
 
+    struct Counters {
+        std::string stage;          // 'curvature', 'traversal' or 'export'
+        std::int64_t cycles;        // -1 when the counter is not available
+        std::int64_t instructions;  // -1 when the counter is not available
+        std::int64_t cache_misses;  // -1 when the counter is not available
+        std::int64_t branch_misses; // -1 when the counter is not available
+        std::int64_t page_faults;   // -1 when the counter is not available
+    };
+
+    struct Metrics {
+        double load_ms;      // time to load and set up the model in Initialize
+        double curvature_ms; // time to calculate or update curvature
+        double traversal_ms; // time to trace the margin line
+        double export_ms;    // time to sample, smooth and convert the result
+        double total_ms;     // time of Run
+        std::uint64_t arena_bytes; // scratch memory of the traversal taken from the job arena, in bytes
+        std::vector<Counters> counters; // event counters of the stages, only when enabled and available on the host
+    };
+
     int return_code;    // Return code
     std::string message;// Message
+    std::string interrupted_stage; // Stage stopped by the deadline or cancellation, 'curvature', 'traversal' or 'export'. empty if completed
     Result result;      // Result data
+    Metrics metrics;    // Timing of the stages
 };
 
 
@@ -28,11 +51,15 @@ void Initialize(GeometryEngineOutput& output);
 // serialize functions
 void to_json(nlohmann::json& j, const GeometryEngineOutput::Result::Marginline& ml);
 void to_json(nlohmann::json& j, const GeometryEngineOutput::Result& r);
+void to_json(nlohmann::json& j, const GeometryEngineOutput::Counters& c);
+void to_json(nlohmann::json& j, const GeometryEngineOutput::Metrics& m);
 void to_json(nlohmann::json& j, const GeometryEngineOutput& geo);
 
 // deserialize functions
 void from_json(const nlohmann::json& j, GeometryEngineOutput::Result::Marginline& ml);
 void from_json(const nlohmann::json& j, GeometryEngineOutput::Result& r);
+void from_json(const nlohmann::json& j, GeometryEngineOutput::Counters& c);
+void from_json(const nlohmann::json& j, GeometryEngineOutput::Metrics& m);
 void from_json(const nlohmann::json& j, GeometryEngineOutput& geo);
 
 // testing
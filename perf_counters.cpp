@@ -0,0 +1,150 @@
+#include "perf_counters.h"
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+#ifdef __linux__
+namespace
+{
+	struct Event
+	{
+		std::uint32_t type;
+		std::uint64_t config;
+	};
+
+
+	// in the order of the fields of PerfCounts
+	const Event EVENTS[] = {
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+		{ PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+	};
+
+
+	int OpenEvent(const Event& event)
+	{
+		perf_event_attr attr;
+		std::memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = event.type;
+		attr.config = event.config;
+		attr.disabled = 1;
+		attr.inherit = 1;	// threads started by the measured section, like the workers of igl::parallel_for
+		attr.exclude_kernel = event.type == PERF_TYPE_HARDWARE ? 1 : 0;	// page faults are counted in the kernel
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+		return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+	}
+}
+
+
+PerfCounters::PerfCounters()
+{
+	for (int i = 0; i < NUM_EVENTS; ++i)
+	{
+		fds_[i] = OpenEvent(EVENTS[i]);
+		if (fds_[i] < 0 && error_.empty())
+		{
+			error_ = std::string("perf_event_open: ") + std::strerror(errno);
+		}
+	}
+	if (IsAvailable())
+	{
+		error_.clear();
+	}
+}
+
+
+PerfCounters::~PerfCounters()
+{
+	for (auto fd : fds_)
+	{
+		if (fd >= 0)
+		{
+			close(fd);
+		}
+	}
+}
+
+
+void PerfCounters::Start()
+{
+	for (auto fd : fds_)
+	{
+		if (fd >= 0)
+		{
+			ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+			ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+		}
+	}
+}
+
+
+PerfCounts PerfCounters::Stop()
+{
+	std::int64_t counts[NUM_EVENTS];
+	for (int i = 0; i < NUM_EVENTS; ++i)
+	{
+		counts[i] = -1;
+		if (fds_[i] < 0)
+		{
+			continue;
+		}
+		ioctl(fds_[i], PERF_EVENT_IOC_DISABLE, 0);
+
+		// value, time enabled, time running
+		std::uint64_t values[3] = { 0, 0, 0 };
+		// a counter that was never scheduled, e.g. multiplexed out for the whole section, has no count to scale
+		if (read(fds_[i], values, sizeof(values)) != static_cast<ssize_t>(sizeof(values)) || values[2] == 0)
+		{
+			continue;
+		}
+		const auto scale = static_cast<double>(values[1]) / static_cast<double>(values[2]);
+		counts[i] = static_cast<std::int64_t>(static_cast<double>(values[0]) * scale);
+	}
+	return PerfCounts{ counts[0], counts[1], counts[2], counts[3], counts[4] };
+}
+#else
+PerfCounters::PerfCounters()
+	: error_("hardware counters are only collected on Linux")
+{
+	fds_.fill(-1);
+}
+
+
+PerfCounters::~PerfCounters()
+{
+}
+
+
+void PerfCounters::Start()
+{
+}
+
+
+PerfCounts PerfCounters::Stop()
+{
+	return PerfCounts();
+}
+#endif
+
+
+bool PerfCounters::IsAvailable() const
+{
+	for (auto fd : fds_)
+	{
+		if (fd >= 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
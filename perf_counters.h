@@ -0,0 +1,62 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string>
+
+
+/**
+ * @brief Hardware and software event counts of a measured section, -1 for counters that are not available or were never scheduled
+ */
+struct PerfCounts
+{
+	std::int64_t cycles = -1;
+	std::int64_t instructions = -1;
+	std::int64_t cache_misses = -1;
+	std::int64_t branch_misses = -1;
+	std::int64_t page_faults = -1;
+};
+
+
+/**
+ * @brief Event counters of the calling thread and the threads it starts, with perf_event_open
+ *        each event is opened on its own, so a host that only offers some of them still reports those.
+ *        hardware events are counted in user space only, which most perf_event_paranoid settings allow.
+ *        when none can be opened, e.g. in containers without CAP_PERFMON or on other platforms,
+ *        IsAvailable() is false and Stop() returns -1 for everything.
+ *        counters must be opened, started and stopped on the same thread.
+ */
+class PerfCounters
+{
+	static constexpr int NUM_EVENTS = 5;
+
+	std::array<int, NUM_EVENTS> fds_;
+	std::string error_;
+
+public:
+	PerfCounters();
+	~PerfCounters();
+	PerfCounters(const PerfCounters&) = delete;
+	PerfCounters& operator=(const PerfCounters&) = delete;
+
+	/**
+	 * @brief Whether at least one counter is open
+	 */
+	bool IsAvailable() const;
+
+	/**
+	 * @brief Reason the counters are not available, empty otherwise
+	 */
+	const std::string& error() const { return error_; }
+
+	/**
+	 * @brief Reset and start the counters
+	 */
+	void Start();
+
+	/**
+	 * @brief Stop the counters and read them
+	 *        counts are scaled up when the kernel multiplexed the hardware counters.
+	 * @return counts since Start()
+	 */
+	PerfCounts Stop();
+};
@@ -0,0 +1,430 @@
+#include "quadric_fitting.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <unordered_set>
+#include <Eigen/Dense>
+#include <igl/parallel_for.h>
+#include "geometry_utils.h"
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+
+namespace
+{
+	static const size_t BATCH_SIZE = 64;
+	static const size_t MIN_NUM_POINTS = 6;
+
+
+	/**
+	 * @brief Quadric coefficients and local frames of a batch of vertices, one array per quantity
+	 *        the fitted height field is w = a u^2 + b u v + c v^2 + d u + e v in the frame (x, y, normal).
+	 */
+	struct QuadricBatch
+	{
+		std::array<double, BATCH_SIZE> a, b, c, d, e;
+		std::array<double, BATCH_SIZE> xx, xy, xz;	// first tangent axis
+		std::array<double, BATCH_SIZE> yx, yy, yz;	// second tangent axis
+		std::array<bool, BATCH_SIZE> valid;
+	};
+
+
+	/**
+	 * @brief Eigen decomposition of the shape operators of a batch of vertices
+	 *        (ex, ey) is the unit eigenvector of lambda_max in the tangent frame, the other one is its perpendicular.
+	 */
+	struct ShapeOperatorBatch
+	{
+		std::array<double, BATCH_SIZE> lambda_max, lambda_min, ex, ey;
+	};
+
+
+	/**
+	 * @brief Per-thread scratch buffers, allocated once per thread and reused for every vertex
+	 */
+	struct Scratch
+	{
+		std::vector<int> stamp;	// stamp[v] == generation if v is already in the ring, sized to the mesh for whole-mesh passes only
+		int generation = 0;
+		std::unordered_set<int> in_ring;	// used instead of stamp by local updates, whose cost must not grow with the mesh
+		std::vector<int> ring;
+		QuadricBatch quadrics;
+		ShapeOperatorBatch shape_operators;
+	};
+
+
+	void GatherKRing(const std::vector<std::vector<int>>& adjacency_list, int start, int k_ring, Scratch& scratch)
+	{
+		auto insert = [&scratch](int v)
+			{
+				if (scratch.stamp.empty())
+				{
+					return scratch.in_ring.insert(v).second;
+				}
+				if (scratch.stamp[v] == scratch.generation)
+				{
+					return false;
+				}
+				scratch.stamp[v] = scratch.generation;
+				return true;
+			};
+
+		++scratch.generation;
+		scratch.in_ring.clear();
+		scratch.ring.clear();
+		scratch.ring.push_back(start);
+		insert(start);
+
+		size_t level_begin = 0;
+		for (int distance = 0; distance < k_ring; ++distance)
+		{
+			auto level_end = scratch.ring.size();
+			for (auto i = level_begin; i < level_end; ++i)
+			{
+				for (auto neighbor : adjacency_list[scratch.ring[i]])
+				{
+					if (insert(neighbor))
+					{
+						scratch.ring.push_back(neighbor);
+					}
+				}
+			}
+			level_begin = level_end;
+		}
+	}
+
+
+	void FitQuadric(
+		const PackedVectorView& V,
+		const PackedVectorArray& N,
+		const std::vector<std::vector<int>>& adjacency_list,
+		int vertex,
+		const std::vector<int>& ring,
+		QuadricBatch& batch,
+		size_t lane)
+	{
+		batch.valid[lane] = false;
+		if (ring.size() < MIN_NUM_POINTS || adjacency_list[vertex].empty())
+		{
+			return;
+		}
+
+		// drop points whose normal faces away from the vertex normal, unless too few points would remain
+		const Eigen::RowVector3d normal = N.row(vertex);
+		size_t num_front_facing = 0;
+		for (auto v : ring)
+		{
+			num_front_facing += N.row(v).dot(normal) > 0.0 ? 1 : 0;
+		}
+		const auto use_all = num_front_facing < MIN_NUM_POINTS || num_front_facing == ring.size();
+
+		// reference frame from the first neighbour projected onto the tangent plane
+		const Eigen::RowVector3d me = V.row(vertex);
+		Eigen::RowVector3d to_first = V.row(adjacency_list[vertex][0]) - me;
+		const auto scale = to_first.norm() > 0.0 ? to_first.norm() : 1.0;
+		const Eigen::RowVector3d x_axis = (to_first - normal * to_first.dot(normal)).normalized();
+		const Eigen::RowVector3d y_axis = normal.cross(x_axis).normalized();
+
+		// accumulate [A b]^T [A b] of the least-squares problem, in coordinates scaled by the first edge length
+		Eigen::Matrix<double, 6, 6> normal_equations = Eigen::Matrix<double, 6, 6>::Zero();
+		Eigen::Matrix<double, 6, 1> row;
+		for (auto v : ring)
+		{
+			if (!use_all && N.row(v).dot(normal) <= 0.0)
+			{
+				continue;
+			}
+			const Eigen::RowVector3d t = (V.row(v) - me) / scale;
+			const auto u = t.dot(x_axis);
+			const auto w = t.dot(y_axis);
+			row << u * u, u * w, w * w, u, w, t.dot(normal);
+			normal_equations.noalias() += row * row.transpose();
+		}
+
+		const Eigen::Matrix<double, 5, 5> AtA = normal_equations.topLeftCorner<5, 5>();
+		const Eigen::Matrix<double, 5, 1> Atb = normal_equations.block<5, 1>(0, 5);
+		Eigen::LDLT<Eigen::Matrix<double, 5, 5>> ldlt(AtA);
+		Eigen::Matrix<double, 5, 1> coefficients;
+		if (ldlt.info() == Eigen::Success && ldlt.isPositive() && ldlt.rcond() > 1e-12)
+		{
+			coefficients = ldlt.solve(Atb);
+		}
+		else
+		{
+			coefficients = AtA.jacobiSvd(Eigen::ComputeFullU | Eigen::ComputeFullV).solve(Atb);
+		}
+
+		// undo the scaling: w = a u^2 + ... in the original units
+		batch.a[lane] = coefficients(0) / scale;
+		batch.b[lane] = coefficients(1) / scale;
+		batch.c[lane] = coefficients(2) / scale;
+		batch.d[lane] = coefficients(3);
+		batch.e[lane] = coefficients(4);
+		batch.xx[lane] = x_axis(0);
+		batch.xy[lane] = x_axis(1);
+		batch.xz[lane] = x_axis(2);
+		batch.yx[lane] = y_axis(0);
+		batch.yy[lane] = y_axis(1);
+		batch.yz[lane] = y_axis(2);
+		batch.valid[lane] = true;
+	}
+
+
+	void SolveShapeOperator(const QuadricBatch& in, size_t lane, ShapeOperatorBatch& out)
+	{
+		const auto a = in.a[lane], b = in.b[lane], c = in.c[lane], d = in.d[lane], e = in.e[lane];
+
+		// first and second fundamental forms of the height field at the origin
+		const auto E = 1.0 + d * d;
+		const auto F = d * e;
+		const auto G = 1.0 + e * e;
+		const auto nz = 1.0 / std::sqrt(d * d + e * e + 1.0);
+		const auto L = 2.0 * a * nz;
+		const auto M = b * nz;
+		const auto N = 2.0 * c * nz;
+		const auto inv_det = 1.0 / (E * G - F * F);
+		const auto p = (L * G - M * F) * inv_det;
+		const auto q = (M * E - L * F) * inv_det;
+		const auto r = (N * E - M * F) * inv_det;
+
+		// closed form eigen decomposition of [p q; q r]
+		const auto half_trace = 0.5 * (p + r);
+		const auto half_diff = 0.5 * (p - r);
+		const auto disc = std::sqrt(half_diff * half_diff + q * q);
+		const auto lambda_max = half_trace + disc;
+		out.lambda_max[lane] = lambda_max;
+		out.lambda_min[lane] = half_trace - disc;
+
+		const auto ax = q, ay = lambda_max - p;
+		const auto bx = lambda_max - r, by = q;
+		const auto na = ax * ax + ay * ay;
+		const auto nb = bx * bx + by * by;
+		const auto ex = na >= nb ? ax : bx;
+		const auto ey = na >= nb ? ay : by;
+		const auto nn = std::max(na, nb);
+		if (nn > std::numeric_limits<double>::min())
+		{
+			const auto inv_norm = 1.0 / std::sqrt(nn);
+			out.ex[lane] = ex * inv_norm;
+			out.ey[lane] = ey * inv_norm;
+		}
+		else
+		{
+			out.ex[lane] = 1.0;
+			out.ey[lane] = 0.0;
+		}
+	}
+
+
+	void SolveShapeOperators(const QuadricBatch& in, size_t count, ShapeOperatorBatch& out)
+	{
+		size_t lane = 0;
+#if defined(__AVX2__)
+		const auto one = _mm256_set1_pd(1.0);
+		const auto two = _mm256_set1_pd(2.0);
+		const auto half = _mm256_set1_pd(0.5);
+		const auto tiny = _mm256_set1_pd(std::numeric_limits<double>::min());
+		for (; lane + 4 <= count; lane += 4)
+		{
+			const auto a = _mm256_loadu_pd(&in.a[lane]);
+			const auto b = _mm256_loadu_pd(&in.b[lane]);
+			const auto c = _mm256_loadu_pd(&in.c[lane]);
+			const auto d = _mm256_loadu_pd(&in.d[lane]);
+			const auto e = _mm256_loadu_pd(&in.e[lane]);
+
+			const auto dd = _mm256_mul_pd(d, d);
+			const auto ee = _mm256_mul_pd(e, e);
+			const auto E = _mm256_add_pd(one, dd);
+			const auto F = _mm256_mul_pd(d, e);
+			const auto G = _mm256_add_pd(one, ee);
+			const auto nz = _mm256_div_pd(one, _mm256_sqrt_pd(_mm256_add_pd(_mm256_add_pd(dd, ee), one)));
+			const auto L = _mm256_mul_pd(_mm256_mul_pd(two, a), nz);
+			const auto M = _mm256_mul_pd(b, nz);
+			const auto N = _mm256_mul_pd(_mm256_mul_pd(two, c), nz);
+			const auto inv_det = _mm256_div_pd(one, _mm256_sub_pd(_mm256_mul_pd(E, G), _mm256_mul_pd(F, F)));
+			const auto p = _mm256_mul_pd(_mm256_sub_pd(_mm256_mul_pd(L, G), _mm256_mul_pd(M, F)), inv_det);
+			const auto q = _mm256_mul_pd(_mm256_sub_pd(_mm256_mul_pd(M, E), _mm256_mul_pd(L, F)), inv_det);
+			const auto r = _mm256_mul_pd(_mm256_sub_pd(_mm256_mul_pd(N, E), _mm256_mul_pd(M, F)), inv_det);
+
+			const auto half_trace = _mm256_mul_pd(half, _mm256_add_pd(p, r));
+			const auto half_diff = _mm256_mul_pd(half, _mm256_sub_pd(p, r));
+			const auto disc = _mm256_sqrt_pd(_mm256_add_pd(_mm256_mul_pd(half_diff, half_diff), _mm256_mul_pd(q, q)));
+			const auto lambda_max = _mm256_add_pd(half_trace, disc);
+			_mm256_storeu_pd(&out.lambda_max[lane], lambda_max);
+			_mm256_storeu_pd(&out.lambda_min[lane], _mm256_sub_pd(half_trace, disc));
+
+			const auto ay = _mm256_sub_pd(lambda_max, p);
+			const auto bx = _mm256_sub_pd(lambda_max, r);
+			const auto na = _mm256_add_pd(_mm256_mul_pd(q, q), _mm256_mul_pd(ay, ay));
+			const auto nb = _mm256_add_pd(_mm256_mul_pd(bx, bx), _mm256_mul_pd(q, q));
+			const auto use_a = _mm256_cmp_pd(na, nb, _CMP_GE_OQ);
+			const auto ex = _mm256_blendv_pd(bx, q, use_a);
+			const auto ey = _mm256_blendv_pd(q, ay, use_a);
+			const auto nn = _mm256_max_pd(na, nb);
+			const auto is_isotropic = _mm256_cmp_pd(nn, tiny, _CMP_LE_OQ);
+			const auto inv_norm = _mm256_div_pd(one, _mm256_sqrt_pd(_mm256_blendv_pd(nn, one, is_isotropic)));
+			_mm256_storeu_pd(&out.ex[lane], _mm256_blendv_pd(_mm256_mul_pd(ex, inv_norm), one, is_isotropic));
+			_mm256_storeu_pd(&out.ey[lane], _mm256_blendv_pd(_mm256_mul_pd(ey, inv_norm), _mm256_setzero_pd(), is_isotropic));
+		}
+#endif
+		for (; lane < count; ++lane)
+		{
+			SolveShapeOperator(in, lane, out);
+		}
+	}
+
+
+	void StoreResults(
+		const QuadricBatch& quadrics,
+		const ShapeOperatorBatch& shape_operators,
+		size_t begin,
+		size_t count,
+		PackedVectorArray& PD1,
+		PackedVectorArray& PD2,
+		ScalarArray& PV1,
+		ScalarArray& PV2)
+	{
+		for (size_t lane = 0; lane < count; ++lane)
+		{
+			const auto i = static_cast<Eigen::Index>(begin + lane);
+			if (!quadrics.valid[lane])
+			{
+				PD1.row(i).setZero();
+				PD2.row(i).setZero();
+				PV1(i) = 0.0;
+				PV2(i) = 0.0;
+				continue;
+			}
+
+			// as CurvatureCalculator::finalEigenStuff of igl::principal_curvature: the eigenvalues are negated and sorted ascending,
+			// so PV1 = -lambda_max <= PV2 = -lambda_min, and each direction is scaled by its value before it is normalized,
+			// which leaves the direction of a zero value zero (Eigen does not normalize a zero vector)
+			const Eigen::RowVector3d x_axis(quadrics.xx[lane], quadrics.xy[lane], quadrics.xz[lane]);
+			const Eigen::RowVector3d y_axis(quadrics.yx[lane], quadrics.yy[lane], quadrics.yz[lane]);
+			const auto ex = shape_operators.ex[lane];
+			const auto ey = shape_operators.ey[lane];
+			const auto value1 = -shape_operators.lambda_max[lane];
+			const auto value2 = -shape_operators.lambda_min[lane];
+			auto sign = [](double value) { return value > 0.0 ? 1.0 : (value < 0.0 ? -1.0 : 0.0); };
+			PV1(i) = value1;
+			PV2(i) = value2;
+			PD1.row(i) = sign(value1) * (ex * x_axis + ey * y_axis).normalized();
+			PD2.row(i) = sign(value2) * (-ey * x_axis + ex * y_axis).normalized();
+		}
+	}
+
+
+	/**
+	 * @brief Fit quadrics for vertices[0..num_targets) (or 0..num_targets when vertices is null) and store row i for the i-th target
+	 * @return false if the deadline is exceeded before all batches are done
+	 */
+	bool FitQuadrics(
+		const PackedVectorView& V,
+		const PackedVectorArray& N,
+		const std::vector<std::vector<int>>& adjacency_list,
+		int k_ring,
+		const std::vector<int>* vertices,
+		size_t num_targets,
+		PackedVectorArray& PD1,
+		PackedVectorArray& PD2,
+		ScalarArray& PV1,
+		ScalarArray& PV2,
+		const Deadline& deadline)
+	{
+		PD1.resize(num_targets, 3);
+		PD2.resize(num_targets, 3);
+		PV1.resize(num_targets);
+		PV2.resize(num_targets);
+		if (num_targets == 0)
+		{
+			return true;
+		}
+
+		std::atomic<bool> is_exceeded(false);
+		// a stamp per mesh vertex pays off over the whole mesh, a local update uses the hash set of the ring
+		const auto num_stamps = vertices ? 0 : static_cast<size_t>(V.rows());
+		std::vector<Scratch> scratches;
+		const auto num_batches = (num_targets + BATCH_SIZE - 1) / BATCH_SIZE;
+		igl::parallel_for(
+			num_batches,
+			[&scratches, num_stamps](size_t num_threads)
+			{
+				scratches.resize(num_threads);
+				for (auto& scratch : scratches)
+				{
+					scratch.stamp.assign(num_stamps, 0);
+				}
+			},
+			[&](size_t batch, size_t thread)
+			{
+				if (is_exceeded.load(std::memory_order_relaxed) || deadline.IsExceeded())
+				{
+					is_exceeded = true;
+					return;
+				}
+				auto& scratch = scratches[thread];
+				const auto begin = batch * BATCH_SIZE;
+				const auto count = std::min(BATCH_SIZE, num_targets - begin);
+				for (size_t lane = 0; lane < count; ++lane)
+				{
+					const auto vertex = vertices ? (*vertices)[begin + lane] : static_cast<int>(begin + lane);
+					GatherKRing(adjacency_list, vertex, k_ring, scratch);
+					FitQuadric(V, N, adjacency_list, vertex, scratch.ring, scratch.quadrics, lane);
+				}
+				SolveShapeOperators(scratch.quadrics, count, scratch.shape_operators);
+				StoreResults(scratch.quadrics, scratch.shape_operators, begin, count, PD1, PD2, PV1, PV2);
+			},
+			[](size_t) {});
+		return !is_exceeded;
+	}
+}
+
+
+bool CalcPrincipalCurvatures(
+	const VectorArray& V,
+	const IndicesArray& F,
+	const std::vector<std::vector<int>>& adjacency_list,
+	int k_ring,
+	PackedVectorArray& PD1,
+	PackedVectorArray& PD2,
+	ScalarArray& PV1,
+	ScalarArray& PV2,
+	const Deadline& deadline)
+{
+	PackedVectorArray N;
+	CalcVertexNormals(V, F, N);
+	return CalcPrincipalCurvatures(ToPacked(V), N, adjacency_list, k_ring, PD1, PD2, PV1, PV2, deadline);
+}
+
+
+bool CalcPrincipalCurvatures(
+	const PackedVectorView& V,
+	const PackedVectorArray& N,
+	const std::vector<std::vector<int>>& adjacency_list,
+	int k_ring,
+	PackedVectorArray& PD1,
+	PackedVectorArray& PD2,
+	ScalarArray& PV1,
+	ScalarArray& PV2,
+	const Deadline& deadline)
+{
+	return FitQuadrics(V, N, adjacency_list, k_ring, nullptr, static_cast<size_t>(V.rows()), PD1, PD2, PV1, PV2, deadline);
+}
+
+
+void CalcPrincipalCurvatures(
+	const PackedVectorView& V,
+	const PackedVectorArray& N,
+	const std::vector<std::vector<int>>& adjacency_list,
+	int k_ring,
+	const std::vector<int>& vertices,
+	PackedVectorArray& PD1,
+	PackedVectorArray& PD2,
+	ScalarArray& PV1,
+	ScalarArray& PV2)
+{
+	FitQuadrics(V, N, adjacency_list, k_ring, &vertices, vertices.size(), PD1, PD2, PV1, PV2, Deadline());
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <vector>
+#include "deadline.h"
+#include "type.h"
+
+
+/**
+ * @brief Compute principal curvatures by fitting a quadric to the k-ring of each vertex
+ *        the estimator is the one of igl::principal_curvature (k-ring neighbourhood, area weighted vertex normal,
+ *        5 coefficient height field), but the least-squares problem is accumulated into fixed-size 6x6 normal equations
+ *        with per-thread scratch buffers, and the 2x2 shape operators of a batch of vertices are solved together
+ *        (AVX2 when compiled with it, scalar otherwise).
+ *        values match igl::principal_curvature within round-off, directions match up to sign.
+ *        the outputs follow what igl::principal_curvature computes, not the maximal/minimal wording of its header:
+ *        PV1 <= PV2, PD1 and PD2 are their directions, and the direction of a zero value is zero.
+ *        with outward normals, PV2 is the curvature across a convex ridge and PD1 points along it.
+ * @param V [i] vertices
+ * @param F [i] faces
+ * @param adjacency_list [i] adjacency list
+ * @param k_ring [i] radius of the neighbourhood in rings
+ * @param PD1 [o] principal curvature direction 1
+ * @param PD2 [o] principal curvature direction 2
+ * @param PV1 [o] principal curvature value 1
+ * @param PV2 [o] principal curvature value 2
+ * @param deadline [i] deadline checked before each batch
+ * @return false if the deadline is exceeded and the outputs are incomplete, true otherwise
+ */
+bool CalcPrincipalCurvatures(
+	const VectorArray& V,
+	const IndicesArray& F,
+	const std::vector<std::vector<int>>& adjacency_list,
+	int k_ring,
+	PackedVectorArray& PD1,
+	PackedVectorArray& PD2,
+	ScalarArray& PV1,
+	ScalarArray& PV2,
+	const Deadline& deadline = Deadline());
+
+
+/**
+ * @brief Compute principal curvatures with vertex normals the caller already has
+ * @param V [i] vertices in packed layout
+ * @param N [i] vertex normals, see CalcVertexNormals
+ * @param adjacency_list [i] adjacency list
+ * @param k_ring [i] radius of the neighbourhood in rings
+ * @param PD1 [o] principal curvature direction 1
+ * @param PD2 [o] principal curvature direction 2
+ * @param PV1 [o] principal curvature value 1
+ * @param PV2 [o] principal curvature value 2
+ * @param deadline [i] deadline checked before each batch
+ * @return false if the deadline is exceeded and the outputs are incomplete, true otherwise
+ */
+bool CalcPrincipalCurvatures(
+	const PackedVectorView& V,
+	const PackedVectorArray& N,
+	const std::vector<std::vector<int>>& adjacency_list,
+	int k_ring,
+	PackedVectorArray& PD1,
+	PackedVectorArray& PD2,
+	ScalarArray& PV1,
+	ScalarArray& PV2,
+	const Deadline& deadline = Deadline());
+
+
+/**
+ * @brief Compute principal curvatures of some vertices only, for local updates after an edit
+ * @param V [i] vertices in packed layout
+ * @param N [i] vertex normals, see CalcVertexNormals
+ * @param adjacency_list [i] adjacency list
+ * @param k_ring [i] radius of the neighbourhood in rings
+ * @param vertices [i] vertices to compute
+ * @param PD1 [o] principal curvature direction 1, one row per element of vertices
+ * @param PD2 [o] principal curvature direction 2, one row per element of vertices
+ * @param PV1 [o] principal curvature value 1, one row per element of vertices
+ * @param PV2 [o] principal curvature value 2, one row per element of vertices
+ * @return void
+ */
+void CalcPrincipalCurvatures(
+	const PackedVectorView& V,
+	const PackedVectorArray& N,
+	const std::vector<std::vector<int>>& adjacency_list,
+	int k_ring,
+	const std::vector<int>& vertices,
+	PackedVectorArray& PD1,
+	PackedVectorArray& PD2,
+	ScalarArray& PV1,
+	ScalarArray& PV2);
@@ -0,0 +1,223 @@
+#include "reorder.h"
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <stdexcept>
+#include "curvature_info.h"
+
+
+namespace
+{
+	// spread the lower 21 bits of x so that there are two zero bits between each bit
+	std::uint64_t SpreadBits(std::uint64_t x)
+	{
+		x &= 0x1fffff;
+		x = (x | (x << 32)) & 0x1f00000000ffff;
+		x = (x | (x << 16)) & 0x1f0000ff0000ff;
+		x = (x | (x << 8)) & 0x100f00f00f00f00f;
+		x = (x | (x << 4)) & 0x10c30c30c30c30c3;
+		x = (x | (x << 2)) & 0x1249249249249249;
+		return x;
+	}
+
+
+	std::vector<int> ComputeMortonOrdering(const VectorArray& V)
+	{
+		static const double MAX_CELL = static_cast<double>((1 << 21) - 1);
+
+		std::vector<int> new_to_old(V.rows());
+		std::iota(new_to_old.begin(), new_to_old.end(), 0);
+		if (V.rows() == 0)
+		{
+			return new_to_old;
+		}
+
+		const Eigen::RowVector3d min_corner = V.colwise().minCoeff();
+		const Eigen::RowVector3d max_corner = V.colwise().maxCoeff();
+		const auto extent = (max_corner - min_corner).maxCoeff();
+		const auto scale = extent > 0.0 ? MAX_CELL / extent : 0.0;
+
+		std::vector<std::uint64_t> codes(V.rows());
+		for (Eigen::Index i = 0; i < V.rows(); ++i)
+		{
+			auto x = static_cast<std::uint64_t>((V(i, 0) - min_corner(0)) * scale);
+			auto y = static_cast<std::uint64_t>((V(i, 1) - min_corner(1)) * scale);
+			auto z = static_cast<std::uint64_t>((V(i, 2) - min_corner(2)) * scale);
+			codes[i] = SpreadBits(x) | (SpreadBits(y) << 1) | (SpreadBits(z) << 2);
+		}
+
+		std::stable_sort(new_to_old.begin(), new_to_old.end(), [&codes](int lhs, int rhs)
+			{
+				return codes[lhs] < codes[rhs];
+			});
+		return new_to_old;
+	}
+
+
+	std::vector<int> ComputeReverseCuthillMcKeeOrdering(const std::vector<std::vector<int>>& adjacency_list)
+	{
+		const auto num_vertices = adjacency_list.size();
+		auto degree = [&adjacency_list](int v) { return adjacency_list[v].size(); };
+
+		// start each connected component from a vertex of minimum degree
+		std::vector<int> by_degree(num_vertices);
+		std::iota(by_degree.begin(), by_degree.end(), 0);
+		std::stable_sort(by_degree.begin(), by_degree.end(), [&degree](int lhs, int rhs)
+			{
+				return degree(lhs) < degree(rhs);
+			});
+
+		std::vector<int> order;
+		order.reserve(num_vertices);
+		std::vector<bool> visited(num_vertices, false);
+		std::vector<int> neighbors;
+		for (auto start : by_degree)
+		{
+			if (visited[start])
+			{
+				continue;
+			}
+
+			visited[start] = true;
+			auto head = order.size();
+			order.push_back(start);
+			while (head < order.size())
+			{
+				auto v = order[head++];
+				neighbors.clear();
+				for (auto neighbor : adjacency_list[v])
+				{
+					if (!visited[neighbor])
+					{
+						visited[neighbor] = true;
+						neighbors.push_back(neighbor);
+					}
+				}
+				std::stable_sort(neighbors.begin(), neighbors.end(), [&degree](int lhs, int rhs)
+					{
+						return degree(lhs) < degree(rhs);
+					});
+				order.insert(order.end(), neighbors.begin(), neighbors.end());
+			}
+		}
+
+		std::reverse(order.begin(), order.end());
+		return order;
+	}
+}
+
+
+VertexOrdering ToVertexOrdering(const std::string& name)
+{
+	if (name.empty() || name == "none")
+	{
+		return VertexOrdering::kNone;
+	}
+	if (name == "morton")
+	{
+		return VertexOrdering::kMorton;
+	}
+	if (name == "rcm")
+	{
+		return VertexOrdering::kReverseCuthillMcKee;
+	}
+	throw std::invalid_argument("unknown vertex ordering: " + name + " (expected: none, morton or rcm)");
+}
+
+
+std::vector<int> ComputeVertexOrdering(
+	const VectorArray& V,
+	const std::vector<std::vector<int>>& adjacency_list,
+	VertexOrdering ordering)
+{
+	switch (ordering)
+	{
+	case VertexOrdering::kMorton:
+		return ComputeMortonOrdering(V);
+	case VertexOrdering::kReverseCuthillMcKee:
+		return ComputeReverseCuthillMcKeeOrdering(adjacency_list);
+	case VertexOrdering::kNone:
+	default:
+		{
+			std::vector<int> identity(V.rows());
+			std::iota(identity.begin(), identity.end(), 0);
+			return identity;
+		}
+	}
+}
+
+
+void ReorderMesh(
+	const std::vector<int>& new_to_old,
+	VectorArray& V,
+	IndicesArray& F,
+	std::vector<std::vector<int>>& adjacency_list)
+{
+	if (static_cast<Eigen::Index>(new_to_old.size()) != V.rows())
+	{
+		throw std::invalid_argument("the size of the permutation must be the number of vertices");
+	}
+
+	std::vector<int> old_to_new(new_to_old.size());
+	for (size_t i = 0; i < new_to_old.size(); ++i)
+	{
+		old_to_new[new_to_old[i]] = static_cast<int>(i);
+	}
+
+	VectorArray reordered_V(V.rows(), V.cols());
+	for (Eigen::Index i = 0; i < V.rows(); ++i)
+	{
+		reordered_V.row(i) = V.row(new_to_old[i]);
+	}
+	V.swap(reordered_V);
+
+	// remap face indices, then sort faces by their smallest vertex so faces are walked in vertex order
+	std::vector<int> face_order(F.rows());
+	std::iota(face_order.begin(), face_order.end(), 0);
+	IndicesArray remapped_F(F.rows(), F.cols());
+	for (Eigen::Index i = 0; i < F.rows(); ++i)
+	{
+		for (Eigen::Index j = 0; j < F.cols(); ++j)
+		{
+			remapped_F(i, j) = old_to_new[F(i, j)];
+		}
+	}
+	std::stable_sort(face_order.begin(), face_order.end(), [&remapped_F](int lhs, int rhs)
+		{
+			return remapped_F.row(lhs).minCoeff() < remapped_F.row(rhs).minCoeff();
+		});
+	for (Eigen::Index i = 0; i < F.rows(); ++i)
+	{
+		F.row(i) = remapped_F.row(face_order[i]);
+	}
+
+	if (adjacency_list.empty())
+	{
+		return;
+	}
+	std::vector<std::vector<int>> reordered_adjacency_list(adjacency_list.size());
+	for (size_t i = 0; i < new_to_old.size(); ++i)
+	{
+		auto& neighbors = reordered_adjacency_list[i];
+		neighbors = adjacency_list[new_to_old[i]];
+		for (auto& neighbor : neighbors)
+		{
+			neighbor = old_to_new[neighbor];
+		}
+		std::sort(neighbors.begin(), neighbors.end());
+	}
+	adjacency_list.swap(reordered_adjacency_list);
+}
+
+
+CurvatureInfo RestoreOriginalOrder(const std::vector<int>& new_to_old, const CurvatureInfo& curvature_info)
+{
+	CurvatureInfo result;
+	result.mean = RestoreOriginalOrder(new_to_old, curvature_info.mean);
+	result.gaussian = RestoreOriginalOrder(new_to_old, curvature_info.gaussian);
+	result.principal_value1 = RestoreOriginalOrder(new_to_old, curvature_info.principal_value1);
+	result.principal_directions1 = RestoreOriginalOrder(new_to_old, curvature_info.principal_directions1);
+	result.principal_value2 = RestoreOriginalOrder(new_to_old, curvature_info.principal_value2);
+	result.principal_directions2 = RestoreOriginalOrder(new_to_old, curvature_info.principal_directions2);
+	return result;
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "type.h"
+
+
+struct CurvatureInfo;
+
+
+/**
+ * @brief Vertex ordering applied at load time to improve cache locality
+ */
+enum class VertexOrdering
+{
+	kNone,	///< keep the order of the model file
+	kMorton,	///< sort vertices along a Morton (Z-order) curve over the bounding box
+	kReverseCuthillMcKee,	///< reverse Cuthill-McKee ordering of the adjacency graph
+};
+
+
+/**
+ * @brief Convert a string to a vertex ordering
+ *        if the string is unknown, the function will raise an std::invalid_argument exception.
+ * @param name "none", "morton" or "rcm"
+ * @return vertex ordering
+ */
+VertexOrdering ToVertexOrdering(const std::string& name);
+
+
+/**
+ * @brief Compute a vertex ordering
+ * @param V [i] vertices
+ * @param adjacency_list [i] adjacency list
+ * @param ordering [i] ordering to compute
+ * @return new_to_old[i] is the original index of the i-th vertex in the new order (identity for kNone)
+ */
+std::vector<int> ComputeVertexOrdering(
+	const VectorArray& V,
+	const std::vector<std::vector<int>>& adjacency_list,
+	VertexOrdering ordering);
+
+
+/**
+ * @brief Reorder vertices and faces
+ *        vertices are permuted by new_to_old, face indices are remapped and faces are sorted by their smallest vertex index
+ *        so that consecutive faces touch nearby vertices. adjacency lists are remapped and kept sorted.
+ * @param new_to_old [i] permutation computed by ComputeVertexOrdering
+ * @param V [i/o] vertices
+ * @param F [i/o] faces
+ * @param adjacency_list [i/o] adjacency list
+ * @return void
+ */
+void ReorderMesh(
+	const std::vector<int>& new_to_old,
+	VectorArray& V,
+	IndicesArray& F,
+	std::vector<std::vector<int>>& adjacency_list);
+
+
+/**
+ * @brief Permute per-vertex rows back to the original vertex order
+ * @param new_to_old [i] permutation used by ReorderMesh
+ * @param values [i] per-vertex values in the reordered order
+ * @return per-vertex values in the original order
+ */
+template <typename Derived>
+typename Derived::PlainObject RestoreOriginalOrder(const std::vector<int>& new_to_old, const Eigen::DenseBase<Derived>& values)
+{
+	typename Derived::PlainObject result(values.rows(), values.cols());
+	for (Eigen::Index i = 0; i < values.rows(); ++i)
+	{
+		result.row(new_to_old[i]) = values.row(i);
+	}
+	return result;
+}
+
+
+/**
+ * @brief Permute all per-vertex curvature arrays back to the original vertex order
+ * @param new_to_old [i] permutation used by ReorderMesh
+ * @param curvature_info [i] curvature information in the reordered order
+ * @return curvature information in the original order
+ */
+CurvatureInfo RestoreOriginalOrder(const std::vector<int>& new_to_old, const CurvatureInfo& curvature_info);
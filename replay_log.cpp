@@ -0,0 +1,85 @@
+#include "replay_log.h"
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+
+namespace
+{
+	std::string ToHex(std::uint64_t value)
+	{
+		std::stringstream ss;
+		ss << std::hex << std::setw(16) << std::setfill('0') << value;
+		return ss.str();
+	}
+}
+
+
+bool AppendReplayRecord(const std::filesystem::path& filepath, const ReplayRecord& record)
+{
+	try
+	{
+		nlohmann::json j = {
+			{"timestamp_ms", record.timestamp_ms},
+			{"input_json", record.input_json},
+			{"model", record.model},
+			{"mesh_hash", ToHex(record.mesh_hash)},
+			{"input", record.input} };
+		const auto line = j.dump() + "\n";
+
+		std::ofstream out(filepath, std::ios::binary | std::ios::app);
+		if (!out.is_open())
+		{
+			std::cout << "failed to open the replay log: " << filepath.string() << "\n";
+			return false;
+		}
+		out.write(line.data(), static_cast<std::streamsize>(line.size()));
+		return static_cast<bool>(out);
+	}
+	catch (const std::exception& e)
+	{
+		std::cout << "failed to append to the replay log\n";
+		std::cout << e.what() << "\n";
+		return false;
+	}
+}
+
+
+bool LoadReplayLog(const std::filesystem::path& filepath, std::vector<ReplayRecord>& records)
+{
+	records.clear();
+	std::ifstream in(filepath);
+	if (!in.is_open())
+	{
+		std::cout << "failed to open the replay log: " << filepath.string() << "\n";
+		return false;
+	}
+
+	std::string line;
+	size_t line_number = 0;
+	while (std::getline(in, line))
+	{
+		++line_number;
+		if (line.empty() || line == "\r")
+		{
+			continue;
+		}
+		try
+		{
+			const auto j = nlohmann::json::parse(line);
+			ReplayRecord record;
+			record.timestamp_ms = j.value("timestamp_ms", 0.0);
+			record.input_json = j.value("input_json", std::string());
+			record.model = j.value("model", std::string());
+			record.mesh_hash = std::stoull(j.value("mesh_hash", std::string("0")), nullptr, 16);
+			record.input = j.at("input");
+			records.push_back(std::move(record));
+		}
+		catch (const std::exception& e)
+		{
+			std::cout << "skipped line " << line_number << " of the replay log: " << e.what() << "\n";
+		}
+	}
+	return true;
+}
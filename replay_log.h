@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+
+/**
+ * @brief A request captured for replay
+ *        the input json is kept as it was, so requests can be replayed with fields the engine does not know yet.
+ */
+struct ReplayRecord
+{
+	double timestamp_ms = 0.0;	// milliseconds since epoch when the request was captured
+	std::string input_json;	// path to the input json
+	std::string model;	// path to the model file, or the shared memory name for 'shm' models
+	std::uint64_t mesh_hash = 0;	// hash of the mesh as loaded, see HashMesh
+	nlohmann::json input;	// input json
+};
+
+
+/**
+ * @brief Append a request to a replay log, one json object per line
+ *        the line is written with a single call, so processes may append to the same log.
+ * @param filepath path to the replay log
+ * @param record request to append
+ * @return true if the record is appended, false otherwise
+ */
+bool AppendReplayRecord(const std::filesystem::path& filepath, const ReplayRecord& record);
+
+
+/**
+ * @brief Load the requests of a replay log
+ *        broken lines, like a line cut by a crash, are skipped with a message.
+ * @param filepath path to the replay log
+ * @param records [o] requests in the order of the log
+ * @return true if the log is read, false otherwise
+ */
+bool LoadReplayLog(const std::filesystem::path& filepath, std::vector<ReplayRecord>& records);
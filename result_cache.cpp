@@ -0,0 +1,293 @@
+#include "result_cache.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+
+namespace
+{
+	static const std::uint64_t HASH_SEED = 0x9e3779b97f4a7c15ull;
+	static const std::uint64_t HASH_MULTIPLIER = 0xff51afd7ed558ccdull;
+
+
+	inline std::uint64_t Mix(std::uint64_t h, std::uint64_t word)
+	{
+		h ^= word;
+		h *= HASH_MULTIPLIER;
+		return h ^ (h >> 29);
+	}
+
+
+	/**
+	 * @brief Hash of a buffer, 8 bytes at a time
+	 */
+	std::uint64_t HashBytes(const void* data, std::size_t size, std::uint64_t h)
+	{
+		const auto* bytes = static_cast<const unsigned char*>(data);
+		std::size_t i = 0;
+		for (; i + sizeof(std::uint64_t) <= size; i += sizeof(std::uint64_t))
+		{
+			std::uint64_t word;
+			std::memcpy(&word, bytes + i, sizeof(word));
+			h = Mix(h, word);
+		}
+		std::uint64_t tail = 0;
+		if (i < size)
+		{
+			std::memcpy(&tail, bytes + i, size - i);
+		}
+		return Mix(Mix(h, tail), size);
+	}
+
+
+	std::string ToHex(std::uint64_t value)
+	{
+		std::stringstream ss;
+		ss << std::hex << std::setw(16) << std::setfill('0') << value;
+		return ss.str();
+	}
+
+
+	int ProcessId()
+	{
+#ifdef _WIN32
+		return _getpid();
+#else
+		return static_cast<int>(getpid());
+#endif
+	}
+}
+
+
+std::uint64_t HashMesh(const VectorArray& V, const IndicesArray& F)
+{
+	auto h = HASH_SEED;
+	h = Mix(h, static_cast<std::uint64_t>(V.rows()));
+	h = Mix(h, static_cast<std::uint64_t>(F.rows()));
+	h = HashBytes(V.data(), static_cast<std::size_t>(V.size()) * sizeof(double), h);
+	h = HashBytes(F.data(), static_cast<std::size_t>(F.size()) * sizeof(int), h);
+	return h;
+}
+
+
+std::string MakeResultCacheKey(std::uint64_t mesh_hash, const GeometryEngineInput::Operation& operation)
+{
+	// object keys of nlohmann::json are sorted, so the dump is canonical
+	auto canonical_operation = operation;
+	canonical_operation.deadline_ms = 0.0;
+	nlohmann::json j = canonical_operation;
+	const auto canonical = j.dump();
+	return "v" + std::to_string(RESULT_CACHE_VERSION) + "-" + ToHex(mesh_hash) + "-" + ToHex(HashBytes(canonical.data(), canonical.size(), HASH_SEED));
+}
+
+
+ResultCache::ResultCache(std::size_t capacity, const std::filesystem::path& directory)
+	: capacity_(capacity), directory_(directory)
+{
+	if (!directory_.empty())
+	{
+		std::error_code ec;
+		std::filesystem::create_directories(directory_, ec);
+		directory_size_ = TrimDirectory();
+	}
+}
+
+
+std::size_t ResultCache::size() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return size_;
+}
+
+
+std::size_t ResultCache::num_hits() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return num_hits_;
+}
+
+
+std::size_t ResultCache::num_misses() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return num_misses_;
+}
+
+
+bool ResultCache::Find(const std::string& key, std::string& value)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		auto found = index_.find(key);
+		if (found != index_.end())
+		{
+			entries_.splice(entries_.begin(), entries_, found->second);
+			value = found->second->second;
+			++num_hits_;
+			return true;
+		}
+	}
+
+	if (!directory_.empty())
+	{
+		const auto filepath = directory_ / (key + ".json");
+		std::ifstream in(filepath, std::ios::binary);
+		if (in)
+		{
+			std::stringstream ss;
+			ss << in.rdbuf();
+			value = ss.str();
+			in.close();
+
+			// keep recently used files from being trimmed
+			std::error_code ec;
+			std::filesystem::last_write_time(filepath, std::filesystem::file_time_type::clock::now(), ec);
+
+			std::lock_guard<std::mutex> lock(mutex_);
+			InsertToMemory(key, value);
+			++num_hits_;
+			return true;
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	++num_misses_;
+	return false;
+}
+
+
+void ResultCache::Insert(const std::string& key, const std::string& value)
+{
+	auto should_trim = false;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		InsertToMemory(key, value);
+		if (!directory_.empty())
+		{
+			directory_size_ += value.size();
+			should_trim = directory_size_ > capacity_;
+		}
+	}
+
+	if (directory_.empty())
+	{
+		return;
+	}
+
+	try
+	{
+		// readers in other processes never see a partially written file, and writers never share a temporary file
+		std::stringstream temp_name;
+		temp_name << key << "." << ProcessId() << "." << std::hash<std::thread::id>()(std::this_thread::get_id()) << ".tmp";
+		const auto temp_path = directory_ / temp_name.str();
+		{
+			std::ofstream out(temp_path, std::ios::binary);
+			out << value;
+			if (!out)
+			{
+				std::cout << "failed to write the result cache: " << temp_path.string() << "\n";
+				return;
+			}
+		}
+		std::filesystem::rename(temp_path, directory_ / (key + ".json"));
+		if (should_trim)
+		{
+			const auto size = TrimDirectory();
+			std::lock_guard<std::mutex> lock(mutex_);
+			directory_size_ = size;
+		}
+	}
+	catch (const std::exception& e)
+	{
+		std::cout << "failed to store the result cache\n";
+		std::cout << e.what() << "\n";
+	}
+}
+
+
+void ResultCache::Clear()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	entries_.clear();
+	index_.clear();
+	size_ = 0;
+}
+
+
+void ResultCache::InsertToMemory(const std::string& key, const std::string& value)
+{
+	auto found = index_.find(key);
+	if (found != index_.end())
+	{
+		size_ -= found->second->second.size();
+		entries_.erase(found->second);
+		index_.erase(found);
+	}
+	if (value.size() > capacity_)
+	{
+		return;
+	}
+
+	entries_.emplace_front(key, value);
+	index_[key] = entries_.begin();
+	size_ += value.size();
+	while (size_ > capacity_)
+	{
+		const auto& last = entries_.back();
+		size_ -= last.second.size();
+		index_.erase(last.first);
+		entries_.pop_back();
+	}
+}
+
+
+std::size_t ResultCache::TrimDirectory() const
+{
+	using FileAndTime = std::pair<std::filesystem::path, std::filesystem::file_time_type>;
+	std::vector<FileAndTime> files;
+	std::size_t total = 0;
+	std::error_code ec;
+	for (const auto& entry : std::filesystem::directory_iterator(directory_, ec))
+	{
+		if (entry.path().extension() != ".json")
+		{
+			continue;
+		}
+		total += static_cast<std::size_t>(entry.file_size(ec));
+		files.emplace_back(entry.path(), entry.last_write_time(ec));
+	}
+	if (total <= capacity_)
+	{
+		return total;
+	}
+
+	// trimmed below the capacity, so that the next inserts do not scan the directory again right away
+	const auto low_water = capacity_ - capacity_ / 8;
+	std::sort(files.begin(), files.end(), [](const FileAndTime& lhs, const FileAndTime& rhs)
+		{
+			return lhs.second < rhs.second;
+		});
+	for (const auto& file : files)
+	{
+		if (total <= low_water)
+		{
+			break;
+		}
+		auto size = std::filesystem::file_size(file.first, ec);
+		if (std::filesystem::remove(file.first, ec))
+		{
+			total -= static_cast<std::size_t>(size);
+		}
+	}
+	return total;
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "input.h"
+#include "type.h"
+
+
+/**
+ * @brief Content hash of a mesh, over the coordinates and the indices as stored
+ * @param V vertices
+ * @param F faces
+ * @return 64 bit hash
+ */
+std::uint64_t HashMesh(const VectorArray& V, const IndicesArray& F);
+
+
+/**
+ * @brief Version of the cached results, part of every key
+ *        raise it when a change of the engine changes the results or the serialized output,
+ *        so that an on-disk store shared with older builds does not serve their entries.
+ */
+constexpr std::uint32_t RESULT_CACHE_VERSION = 1;
+
+
+/**
+ * @brief Key of a cached result, from RESULT_CACHE_VERSION, the mesh hash and the canonical json of the operation
+ *        fields that do not change the result, like the deadline, are left out.
+ * @param mesh_hash hash of the mesh, see HashMesh
+ * @param operation operation
+ * @return key usable as a file name
+ */
+std::string MakeResultCacheKey(std::uint64_t mesh_hash, const GeometryEngineInput::Operation& operation);
+
+
+/**
+ * @brief Cache of serialized outputs with LRU eviction by size
+ *        the in-process cache may be shared between threads. when a directory is given,
+ *        entries are also stored there as <key>.json (written to a temporary file and renamed),
+ *        so the store may be shared between processes; the directory is trimmed by modification time to 7/8 of the same capacity
+ *        when the size of the files this process has seen and written crosses the capacity.
+ */
+class ResultCache
+{
+	using Entry = std::pair<std::string, std::string>;	// key and serialized output
+
+	mutable std::mutex mutex_;
+	std::list<Entry> entries_;	// most recently used first
+	std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+	std::size_t size_ = 0;
+	std::size_t capacity_ = 0;
+	std::filesystem::path directory_;
+	std::size_t directory_size_ = 0;	// size of the on-disk store at the last trim, plus the entries written since
+	std::size_t num_hits_ = 0;
+	std::size_t num_misses_ = 0;
+
+	void InsertToMemory(const std::string& key, const std::string& value);
+	std::size_t TrimDirectory() const;	// returns the size of the store after trimming
+
+public:
+	/**
+	 * @brief Constructor
+	 * @param capacity capacity in bytes of the serialized outputs
+	 * @param directory directory of the on-disk store, empty for in-process only
+	 */
+	explicit ResultCache(std::size_t capacity, const std::filesystem::path& directory = {});
+
+	std::size_t size() const;
+	std::size_t num_hits() const;
+	std::size_t num_misses() const;
+
+	/**
+	 * @brief Find a result, in memory first and then on disk
+	 * @param key key, see MakeResultCacheKey
+	 * @param value [o] serialized output
+	 * @return true if found, false otherwise
+	 */
+	bool Find(const std::string& key, std::string& value);
+
+	/**
+	 * @brief Insert a result, evicting the least recently used ones beyond the capacity
+	 * @param key key, see MakeResultCacheKey
+	 * @param value serialized output
+	 * @return void
+	 */
+	void Insert(const std::string& key, const std::string& value);
+
+	/**
+	 * @brief Remove all results in memory (the on-disk store is kept)
+	 * @return void
+	 */
+	void Clear();
+};
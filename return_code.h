@@ -7,8 +7,12 @@ enum class ReturnCode
 	kUnknownError = 1,
 	kInvalidInput = 101,
 	kInvalidModel = 102,
+	kBufferTooSmall = 103,
 
 	kErrorInMarginLine = 201,
+
+	kTimeout = 301,
+	kCancelled = 302,
 };
 
 
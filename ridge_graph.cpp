@@ -0,0 +1,183 @@
+#include "ridge_graph.h"
+#include <algorithm>
+#include <cmath>
+#include "curvature_info.h"
+
+
+namespace
+{
+	static const double ACROSS_RIDGE_COS = 0.7071;	// neighbours within 45 degrees of the direction of the larger curvature are across the ridge
+	static const double MIN_CURVATURE = 1e-12;
+
+
+	/**
+	 * @brief Curvature across the ridge at a vertex
+	 *        both estimators store PV1 <= PV2, so it is the second principal value.
+	 */
+	double RidgeCurvature(const CurvatureView& curvature, int vertex)
+	{
+		return curvature.principal_value2(vertex);
+	}
+
+
+	/**
+	 * @brief Link two ridge vertices
+	 * @param ridge_graph [i/o] ridge graph
+	 * @param V [i] vertices in packed layout
+	 * @param curvature [i] curvature information
+	 * @param a index of a ridge vertex
+	 * @param b index of another ridge vertex
+	 */
+	void Link(RidgeGraph& ridge_graph, const PackedVectorArray& V, const CurvatureView& curvature, int a, int b)
+	{
+		auto& neighbors = ridge_graph.adjacency_list[a];
+		if (a == b || std::find(neighbors.begin(), neighbors.end(), b) != neighbors.end())
+		{
+			return;
+		}
+		const auto va = ridge_graph.vertices[a];
+		const auto vb = ridge_graph.vertices[b];
+		const auto length = (V.row(va) - V.row(vb)).norm();
+		const auto edge_curvature = 0.5 * (RidgeCurvature(curvature, va) + RidgeCurvature(curvature, vb));
+		const auto cost = length / std::max(edge_curvature, MIN_CURVATURE);
+		ridge_graph.adjacency_list[a].push_back(b);
+		ridge_graph.costs[a].push_back(cost);
+		ridge_graph.adjacency_list[b].push_back(a);
+		ridge_graph.costs[b].push_back(cost);
+	}
+}
+
+
+void BuildRidgeGraph(
+	const PackedVectorArray& V,
+	const std::vector<std::vector<int>>& adjacency_list,
+	const CurvatureView& curvature,
+	const RidgeGraphOptions& options,
+	RidgeGraph& ridge_graph)
+{
+	ridge_graph = RidgeGraph();
+	const auto num_vertices = static_cast<int>(V.rows());
+	if (num_vertices == 0)
+	{
+		return;
+	}
+
+	std::vector<double> curvatures(num_vertices);
+	for (int i = 0; i < num_vertices; ++i)
+	{
+		curvatures[i] = RidgeCurvature(curvature, i);
+	}
+	auto sorted = curvatures;
+	const auto quantile = std::clamp(options.quantile, 0.0, 1.0);
+	const auto nth = static_cast<size_t>(std::floor(quantile * (sorted.size() - 1)));
+	std::nth_element(sorted.begin(), sorted.begin() + nth, sorted.end());
+	ridge_graph.threshold = sorted[nth];
+
+	// thresholding and non-maximum suppression across the ridge
+	ridge_graph.ridge_indices.assign(num_vertices, -1);
+	for (int i = 0; i < num_vertices; ++i)
+	{
+		if (curvatures[i] < ridge_graph.threshold)
+		{
+			continue;
+		}
+		const Eigen::RowVector3d across = curvature.principal_direction2(i);
+		auto is_maximum = true;
+		for (auto neighbor : adjacency_list[i])
+		{
+			const Eigen::RowVector3d direction = (V.row(neighbor) - V.row(i)).normalized();
+			if (std::abs(direction.dot(across)) >= ACROSS_RIDGE_COS && curvatures[neighbor] > curvatures[i])
+			{
+				is_maximum = false;
+				break;
+			}
+		}
+		if (is_maximum)
+		{
+			ridge_graph.ridge_indices[i] = static_cast<int>(ridge_graph.vertices.size());
+			ridge_graph.vertices.push_back(i);
+		}
+	}
+
+	const auto num_ridge_vertices = static_cast<int>(ridge_graph.vertices.size());
+	ridge_graph.adjacency_list.resize(num_ridge_vertices);
+	ridge_graph.costs.resize(num_ridge_vertices);
+	ridge_graph.directions.resize(num_ridge_vertices, 3);
+	for (int r = 0; r < num_ridge_vertices; ++r)
+	{
+		const auto vertex = ridge_graph.vertices[r];
+		ridge_graph.directions.row(r) = curvature.principal_direction1(vertex);
+		for (auto neighbor : adjacency_list[vertex])
+		{
+			auto s = ridge_graph.ridge_indices[neighbor];
+			if (s > r)
+			{
+				Link(ridge_graph, V, curvature, r, s);
+			}
+		}
+	}
+
+	// ends of ridges are linked to the nearest ridge vertex within a few rings that is not already close on the graph
+	std::vector<int> ring_of(num_vertices, -1);
+	std::vector<int> touched;
+	for (int r = 0; r < num_ridge_vertices; ++r)
+	{
+		if (options.bridge_rings < 2 || ridge_graph.adjacency_list[r].size() > 1)
+		{
+			continue;
+		}
+
+		std::vector<int> near_on_graph{ r };
+		for (auto s : ridge_graph.adjacency_list[r])
+		{
+			near_on_graph.push_back(s);
+			near_on_graph.insert(near_on_graph.end(), ridge_graph.adjacency_list[s].begin(), ridge_graph.adjacency_list[s].end());
+		}
+
+		const auto vertex = ridge_graph.vertices[r];
+		std::vector<int> ring{ vertex };
+		ring_of[vertex] = 0;
+		touched.assign(1, vertex);
+		auto nearest = -1;
+		auto nearest_distance = 0.0;
+		for (int k = 1; k <= options.bridge_rings && !ring.empty(); ++k)
+		{
+			std::vector<int> next_ring;
+			for (auto v : ring)
+			{
+				for (auto neighbor : adjacency_list[v])
+				{
+					if (ring_of[neighbor] >= 0)
+					{
+						continue;
+					}
+					ring_of[neighbor] = k;
+					touched.push_back(neighbor);
+					next_ring.push_back(neighbor);
+
+					auto s = ridge_graph.ridge_indices[neighbor];
+					if (k < 2 || s < 0 || std::find(near_on_graph.begin(), near_on_graph.end(), s) != near_on_graph.end())
+					{
+						continue;
+					}
+					const auto distance = (V.row(neighbor) - V.row(vertex)).norm();
+					if (nearest < 0 || distance < nearest_distance)
+					{
+						nearest = s;
+						nearest_distance = distance;
+					}
+				}
+			}
+			ring.swap(next_ring);
+		}
+		for (auto v : touched)
+		{
+			ring_of[v] = -1;
+		}
+
+		if (nearest >= 0)
+		{
+			Link(ridge_graph, V, curvature, r, nearest);
+		}
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <vector>
+#include "type.h"
+
+
+class CurvatureView;
+
+
+/**
+ * @brief Options of the ridge graph
+ */
+struct RidgeGraphOptions
+{
+	double quantile = 0.9;	// vertices whose larger principal curvature is below this quantile of the mesh are not ridges
+	int bridge_rings = 2;	// ends of ridges are linked to ridge vertices within this many rings, across gaps left by the suppression
+};
+
+
+/**
+ * @brief Sparse graph of the ridge vertices of a mesh
+ *        ridge vertices are the local maxima of the larger principal curvature across the ridge, above a threshold.
+ *        they are linked along the mesh edges between them, and across small gaps at the ends of ridges.
+ */
+struct RidgeGraph
+{
+	std::vector<int> vertices;	// mesh index of each ridge vertex
+	std::vector<int> ridge_indices;	// ridge_indices[i] is the index of mesh vertex i in vertices, -1 if it is not a ridge vertex
+	std::vector<std::vector<int>> adjacency_list;	// neighbours of each ridge vertex, as indices in vertices
+	std::vector<std::vector<double>> costs;	// cost of each edge in adjacency_list, its length over the curvature along it
+	PackedVectorArray directions;	// direction along the ridge at each ridge vertex, the principal direction of the smaller curvature
+	double threshold = 0.0;	// curvature threshold the graph is built with
+
+	bool empty() const { return vertices.empty(); }
+
+	/**
+	 * @brief Index of a mesh vertex in vertices
+	 * @param vertex mesh vertex
+	 * @return index in vertices, -1 if the vertex is not a ridge vertex
+	 */
+	int Find(int vertex) const
+	{
+		return vertex >= 0 && vertex < static_cast<int>(ridge_indices.size()) ? ridge_indices[vertex] : -1;
+	}
+};
+
+
+/**
+ * @brief Build the ridge graph of a mesh
+ * @param V [i] vertices in packed layout
+ * @param adjacency_list [i] adjacency list of the mesh
+ * @param curvature [i] curvature information
+ * @param options [i] options
+ * @param ridge_graph [o] ridge graph
+ */
+void BuildRidgeGraph(
+	const PackedVectorArray& V,
+	const std::vector<std::vector<int>>& adjacency_list,
+	const CurvatureView& curvature,
+	const RidgeGraphOptions& options,
+	RidgeGraph& ridge_graph);
@@ -0,0 +1,335 @@
+#include "shared_memory.h"
+#include <cstring>
+#include <iostream>
+#include "output.h"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+namespace
+{
+	const char SHARED_MESH_MAGIC[8] = { 'G', 'E', 'M', 'E', 'S', 'H', '\0', '\0' };
+	const char SHARED_MARGINLINE_MAGIC[8] = { 'G', 'E', 'L', 'I', 'N', 'E', '\0', '\0' };
+
+
+	/**
+	 * @brief Parse a name of the form "fd:<n>"
+	 * @param name segment name
+	 * @param fd [o] file descriptor
+	 * @return true if the name is a file descriptor, false otherwise
+	 */
+	bool ToFileDescriptor(const std::string& name, int& fd)
+	{
+		if (name.compare(0, 3, "fd:") != 0)
+		{
+			return false;
+		}
+		try
+		{
+			fd = std::stoi(name.substr(3));
+			return true;
+		}
+		catch (const std::exception&)
+		{
+			return false;
+		}
+	}
+
+
+	/**
+	 * @brief Parse a name of the form "file:<path>"
+	 * @param name segment name
+	 * @param path [o] path to the file
+	 * @return true if the name is a file, false otherwise
+	 */
+	bool ToFilePath(const std::string& name, std::string& path)
+	{
+		if (name.compare(0, 5, "file:") != 0 || name.size() == 5)
+		{
+			return false;
+		}
+		path = name.substr(5);
+		return true;
+	}
+
+
+	bool IsInRange(std::uint64_t offset, std::uint64_t length, std::size_t size)
+	{
+		return offset <= size && length <= size - offset;
+	}
+}
+
+
+SharedMemory::~SharedMemory()
+{
+	Close();
+}
+
+
+#ifdef _WIN32
+bool SharedMemory::OpenReadOnly(const std::string& name)
+{
+	Close();
+	std::string path;
+	if (ToFilePath(name, path))
+	{
+		// the mapping keeps the file open, so the file handle is closed right away
+		auto file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file != INVALID_HANDLE_VALUE)
+		{
+			handle_ = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			CloseHandle(file);
+		}
+	}
+	else
+	{
+		handle_ = OpenFileMappingA(FILE_MAP_READ, FALSE, name.c_str());
+	}
+	if (handle_ == nullptr)
+	{
+		std::cout << "failed to open shared memory: " << name << "\n";
+		return false;
+	}
+	data_ = MapViewOfFile(handle_, FILE_MAP_READ, 0, 0, 0);
+	if (data_ == nullptr)
+	{
+		std::cout << "failed to map shared memory: " << name << "\n";
+		Close();
+		return false;
+	}
+	MEMORY_BASIC_INFORMATION info;
+	VirtualQuery(data_, &info, sizeof(info));
+	size_ = info.RegionSize;
+	return true;
+}
+
+
+bool SharedMemory::Create(const std::string& name, std::size_t size)
+{
+	Close();
+	// the mapping lives while a handle is open, so the host keeps its own handle to read the result
+	const auto size64 = static_cast<std::uint64_t>(size);
+	std::string path;
+	if (ToFilePath(name, path))
+	{
+		auto file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file != INVALID_HANDLE_VALUE)
+		{
+			handle_ = CreateFileMappingA(file, nullptr, PAGE_READWRITE, static_cast<DWORD>(size64 >> 32), static_cast<DWORD>(size64), nullptr);
+			CloseHandle(file);
+		}
+	}
+	else
+	{
+		handle_ = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, static_cast<DWORD>(size64 >> 32), static_cast<DWORD>(size64), name.c_str());
+	}
+	if (handle_ == nullptr)
+	{
+		std::cout << "failed to create shared memory: " << name << "\n";
+		return false;
+	}
+	data_ = MapViewOfFile(handle_, FILE_MAP_WRITE, 0, 0, size);
+	if (data_ == nullptr)
+	{
+		std::cout << "failed to map shared memory: " << name << "\n";
+		Close();
+		return false;
+	}
+	size_ = size;
+	return true;
+}
+
+
+void SharedMemory::Close()
+{
+	if (data_ != nullptr)
+	{
+		UnmapViewOfFile(data_);
+	}
+	if (handle_ != nullptr)
+	{
+		CloseHandle(handle_);
+	}
+	data_ = nullptr;
+	handle_ = nullptr;
+	size_ = 0;
+}
+#else
+bool SharedMemory::OpenReadOnly(const std::string& name)
+{
+	Close();
+	int fd = -1;
+	const auto is_inherited = ToFileDescriptor(name, fd);
+	std::string path;
+	if (ToFilePath(name, path))
+	{
+		fd = open(path.c_str(), O_RDONLY);
+	}
+	else if (!is_inherited)
+	{
+		fd = shm_open(name.c_str(), O_RDONLY, 0);
+	}
+	if (fd < 0)
+	{
+		std::cout << "failed to open shared memory: " << name << "\n";
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) == 0 && st.st_size > 0)
+	{
+		auto data = mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+		if (data != MAP_FAILED)
+		{
+			data_ = data;
+			size_ = static_cast<std::size_t>(st.st_size);
+		}
+	}
+	if (!is_inherited)
+	{
+		close(fd);
+	}
+	if (data_ == nullptr)
+	{
+		std::cout << "failed to map shared memory: " << name << "\n";
+		return false;
+	}
+	return true;
+}
+
+
+bool SharedMemory::Create(const std::string& name, std::size_t size)
+{
+	Close();
+	int fd = -1;
+	const auto is_inherited = ToFileDescriptor(name, fd);
+	std::string path;
+	if (ToFilePath(name, path))
+	{
+		fd = open(path.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+	}
+	else if (!is_inherited)
+	{
+		fd = shm_open(name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0600);
+	}
+	if (fd < 0)
+	{
+		std::cout << "failed to create shared memory: " << name << "\n";
+		return false;
+	}
+
+	if (ftruncate(fd, static_cast<off_t>(size)) == 0)
+	{
+		auto data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (data != MAP_FAILED)
+		{
+			data_ = data;
+			size_ = size;
+		}
+	}
+	if (!is_inherited)
+	{
+		close(fd);
+	}
+	if (data_ == nullptr)
+	{
+		std::cout << "failed to map shared memory: " << name << "\n";
+		return false;
+	}
+	return true;
+}
+
+
+void SharedMemory::Close()
+{
+	if (data_ != nullptr)
+	{
+		munmap(data_, size_);
+	}
+	data_ = nullptr;
+	size_ = 0;
+}
+#endif
+
+
+bool LoadSharedMesh(const std::string& name, VectorArray& V, IndicesArray& F)
+{
+	SharedMemory memory;
+	if (!memory.OpenReadOnly(name))
+	{
+		return false;
+	}
+
+	SharedMeshHeader header;
+	if (memory.size() < sizeof(header))
+	{
+		std::cout << "shared memory is too small for a mesh header\n";
+		return false;
+	}
+	std::memcpy(&header, memory.data(), sizeof(header));
+	if (std::memcmp(header.magic, SHARED_MESH_MAGIC, sizeof(header.magic)) != 0 || header.version != SHARED_MESH_VERSION)
+	{
+		std::cout << "shared memory does not hold a mesh of version " << SHARED_MESH_VERSION << "\n";
+		return false;
+	}
+	const auto vertices_bytes = header.num_vertices * 3 * sizeof(double);
+	const auto faces_bytes = header.num_faces * 3 * sizeof(std::int32_t);
+	if (header.num_vertices > memory.size() || header.num_faces > memory.size()
+		|| !IsInRange(header.vertices_offset, vertices_bytes, memory.size())
+		|| !IsInRange(header.faces_offset, faces_bytes, memory.size())
+		|| header.vertices_offset % alignof(double) != 0
+		|| header.faces_offset % alignof(std::int32_t) != 0)
+	{
+		std::cout << "invalid mesh layout in shared memory\n";
+		return false;
+	}
+
+	const auto* base = static_cast<const char*>(memory.data());
+	const auto num_vertices = static_cast<Eigen::Index>(header.num_vertices);
+	const auto num_faces = static_cast<Eigen::Index>(header.num_faces);
+	V = Eigen::Map<const PackedVectorArray>(reinterpret_cast<const double*>(base + header.vertices_offset), num_vertices, 3);
+	F = Eigen::Map<const Eigen::Matrix<std::int32_t, Eigen::Dynamic, 3, Eigen::RowMajor>>(reinterpret_cast<const std::int32_t*>(base + header.faces_offset), num_faces, 3);
+	if (F.size() > 0 && (F.minCoeff() < 0 || F.maxCoeff() >= V.rows()))
+	{
+		std::cout << "face refers to a vertex out of range in shared memory\n";
+		return false;
+	}
+	return true;
+}
+
+
+bool SaveSharedMarginline(const std::string& name, const GeometryEngineOutput& output)
+{
+	const auto& points = output.result.marginline.points;
+
+	SharedMarginlineHeader header;
+	std::memcpy(header.magic, SHARED_MARGINLINE_MAGIC, sizeof(header.magic));
+	header.version = SHARED_MESH_VERSION;
+	header.return_code = output.return_code;
+	header.num_original_points = static_cast<std::uint64_t>(output.result.marginline.num_original_points);
+	header.num_points = points.size();
+	header.points_offset = sizeof(header);
+
+	SharedMemory memory;
+	if (!memory.Create(name, sizeof(header) + points.size() * 3 * sizeof(double)))
+	{
+		return false;
+	}
+	auto* base = static_cast<char*>(memory.data());
+	std::memcpy(base, &header, sizeof(header));
+	auto* xyz = reinterpret_cast<double*>(base + header.points_offset);
+	for (const auto& point : points)
+	{
+		for (size_t k = 0; k < 3; ++k)
+		{
+			*xyz++ = k < point.size() ? point[k] : 0.0;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,111 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "type.h"
+
+
+struct GeometryEngineOutput;
+
+
+/**
+ * @brief Header at the beginning of a shared memory segment holding a mesh
+ *        vertices are xyz doubles and faces are int32 triangles, both row by row,
+ *        at the given offsets from the beginning of the segment.
+ */
+struct SharedMeshHeader
+{
+	char magic[8];	// "GEMESH\0\0"
+	std::uint32_t version;	// SHARED_MESH_VERSION
+	std::uint32_t reserved;
+	std::uint64_t num_vertices;
+	std::uint64_t num_faces;
+	std::uint64_t vertices_offset;	// in bytes, aligned to 8
+	std::uint64_t faces_offset;	// in bytes, aligned to 4
+};
+
+
+/**
+ * @brief Header at the beginning of a shared memory segment holding a margin line
+ *        points are xyz doubles, row by row, at the given offset from the beginning of the segment.
+ */
+struct SharedMarginlineHeader
+{
+	char magic[8];	// "GELINE\0\0"
+	std::uint32_t version;	// SHARED_MESH_VERSION
+	std::int32_t return_code;
+	std::uint64_t num_original_points;
+	std::uint64_t num_points;
+	std::uint64_t points_offset;	// in bytes, aligned to 8
+};
+
+
+constexpr std::uint32_t SHARED_MESH_VERSION = 1;
+
+
+/**
+ * @brief Shared memory segment mapped into this process, unmapped on destruction
+ *        a name is a POSIX shared memory name like "/scan-42" (a named file mapping on Windows),
+ *        "fd:<n>" for a file descriptor inherited from the host, e.g. created by memfd_create,
+ *        or "file:<path>" for a regular file, for outputs larger than memory.
+ */
+class SharedMemory
+{
+	void* data_ = nullptr;
+	std::size_t size_ = 0;
+#ifdef _WIN32
+	void* handle_ = nullptr;
+#endif
+
+public:
+	SharedMemory() = default;
+	~SharedMemory();
+	SharedMemory(const SharedMemory&) = delete;
+	SharedMemory& operator=(const SharedMemory&) = delete;
+
+	const void* data() const { return data_; }
+	void* data() { return data_; }
+	std::size_t size() const { return size_; }
+	bool is_open() const { return data_ != nullptr; }
+
+	/**
+	 * @brief Map an existing segment read-only
+	 * @param name segment name
+	 * @return true if the segment is mapped, false otherwise
+	 */
+	bool OpenReadOnly(const std::string& name);
+
+	/**
+	 * @brief Create (or replace) a segment and map it read-write
+	 * @param name segment name, "fd:<n>" is resized to the given size
+	 * @param size size in bytes
+	 * @return true if the segment is mapped, false otherwise
+	 */
+	bool Create(const std::string& name, std::size_t size);
+
+	void Close();
+};
+
+
+/**
+ * @brief Load a mesh from a shared memory segment, see SharedMeshHeader
+ *        the segment is validated and mapped read-only; the arrays are copied into V and F, without parsing, and unmapped on return.
+ *        V and F are column-major, the layout igl reads, so the row-major segment is converted once whatever the engine does.
+ *        only the packed copy of the engine could view the segment instead, and that copy is about 1% of the initialization:
+ *        3 ms of 300 ms for 557k vertices and 1.1M faces, where this load takes 25 ms. the engine reorders and edits its copies,
+ *        so the mesh is not borrowed from the segment and the host may release it once Initialize returns.
+ * @param name segment name
+ * @param V [o] vertices
+ * @param F [o] faces
+ * @return true if the mesh is loaded successfully, false otherwise
+ */
+bool LoadSharedMesh(const std::string& name, VectorArray& V, IndicesArray& F);
+
+
+/**
+ * @brief Write the margin line of an output to a shared memory segment, see SharedMarginlineHeader
+ * @param name segment name
+ * @param output output of the engine
+ * @return true if the result is written successfully, false otherwise
+ */
+bool SaveSharedMarginline(const std::string& name, const GeometryEngineOutput& output);
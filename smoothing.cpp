@@ -1,42 +1,112 @@
 #include "smoothing.h"
+#include <igl/parallel_for.h>
 
 
-VectorArray ChaikinSmoothing(const VectorArray& V, const std::vector<int>& loop, int num_iterations)
+namespace
 {
-	VectorArray smoothed(loop.size(), 3);
-	for (size_t i = 0; i < loop.size(); ++i)
-	{
-		smoothed.row(i) = V.row(loop[i]);
-	}
+	using Rows = Eigen::Map<PackedVectorArray, 0, Eigen::OuterStride<>>;
+	using ConstRows = Eigen::Map<const PackedVectorArray, 0, Eigen::OuterStride<>>;
 
-	for (auto i = 0; i < num_iterations; ++i)
+
+	/**
+	* @brief One Chaikin iteration from m points in src to 2m points in dst
+	*        the cut points of segment j are written to rows 2j and 2j+1 (shifted by one for open polylines) through strided views.
+	*/
+	void Subdivide(const double* src, Eigen::Index m, bool is_closed, double* dst)
 	{
-		std::vector<Eigen::Vector3d> new_loop;
-		for (auto j = 0; j < smoothed.rows() - 1; ++j)
+		const ConstRows p(src, m, 3, Eigen::OuterStride<>(3));
+		const auto n = m - 1;
+		const auto first = is_closed ? 0 : 3;
+		Rows q(dst + first, m, 3, Eigen::OuterStride<>(6));
+		Rows r(dst + first + 3, m, 3, Eigen::OuterStride<>(6));
+		q.topRows(n) = 0.75 * p.topRows(n) + 0.25 * p.bottomRows(n);
+		r.topRows(n) = 0.25 * p.topRows(n) + 0.75 * p.bottomRows(n);
+		if (is_closed)
+		{
+			q.row(n) = 0.75 * p.row(n) + 0.25 * p.row(0);
+			r.row(n) = 0.25 * p.row(n) + 0.75 * p.row(0);
+		}
+		else
 		{
-			Eigen::Vector3d p0 = smoothed.row(j);
-			Eigen::Vector2d p0_yz = p0.tail<2>();
-			Eigen::Vector3d p1 = smoothed.row(j + 1);
-			Eigen::Vector2d p1_yz = p1.tail<2>();
+			Rows(dst, 1, 3, Eigen::OuterStride<>(3)) = p.row(0);
+			Rows(dst + 3 * (2 * m - 1), 1, 3, Eigen::OuterStride<>(3)) = p.row(n);
+		}
+	}
 
-			Eigen::Vector2d q = 0.75 * p0_yz + 0.25 * p1_yz;
-			Eigen::Vector2d r = 0.25 * p0_yz + 0.75 * p1_yz;
 
-			new_loop.push_back(Eigen::Vector3d(0, q(0), q(1)));
-			new_loop.push_back(Eigen::Vector3d(0, r(0), r(1)));
+	PackedVectorArray Gather(const VectorArray& V, const std::vector<int>& loop, const std::vector<size_t>& indices)
+	{
+		PackedVectorArray points(indices.size(), 3);
+		for (size_t i = 0; i < indices.size(); ++i)
+		{
+			points.row(i) = V.row(loop[indices[i]]);
 		}
-		new_loop.push_back(smoothed.row(smoothed.rows() - 1));
+		return points;
+	}
+
 
-		smoothed.resize(new_loop.size(), 3);
-		for (size_t j = 0; j < new_loop.size(); ++j)
+	/**
+	* @brief Smooth the points of a loop, dropping the repeated first point of a closed one
+	*/
+	VectorArray SmoothLoop(const VectorArray& V, const std::vector<int>& loop, std::vector<size_t> indices, int num_iterations)
+	{
+		const auto is_closed = indices.size() > 3 && loop[indices.front()] == loop[indices.back()];
+		if (is_closed)
 		{
-			smoothed.row(j) = new_loop[j];
+			indices.pop_back();
 		}
+		return ChaikinSmoothing(Gather(V, loop, indices), num_iterations, is_closed);
+	}
+}
+
+
+PackedVectorArray ChaikinSmoothing(const PackedVectorArray& points, int num_iterations, bool is_closed)
+{
+	const auto m = points.rows();
+	if (m < 2 || num_iterations <= 0)
+	{
+		return points;
 	}
+	is_closed = is_closed && m > 2;
+
+	// the last iteration writes to the output, so the first one starts from the buffer of the right parity
+	PackedVectorArray smoothed(ChaikinSmoothedSize(m, num_iterations), 3);
+	PackedVectorArray scratch(num_iterations > 1 ? ChaikinSmoothedSize(m, num_iterations - 1) : 0, 3);
+	const double* src = points.data();
+	auto size = m;
+	for (int i = 0; i < num_iterations; ++i)
+	{
+		auto* dst = (num_iterations - i) % 2 == 1 ? smoothed.data() : scratch.data();
+		Subdivide(src, size, is_closed, dst);
+		src = dst;
+		size *= 2;
+	}
+	return smoothed;
+}
+
+
+std::vector<PackedVectorArray> ChaikinSmoothing(const std::vector<PackedVectorArray>& polylines, int num_iterations, bool is_closed)
+{
+	std::vector<PackedVectorArray> smoothed(polylines.size());
+	igl::parallel_for(polylines.size(), [&](size_t i)
+		{
+			smoothed[i] = ChaikinSmoothing(polylines[i], num_iterations, is_closed);
+		}, 4);
 	return smoothed;
 }
 
 
+VectorArray ChaikinSmoothing(const VectorArray& V, const std::vector<int>& loop, int num_iterations)
+{
+	std::vector<size_t> indices(loop.size());
+	for (size_t i = 0; i < loop.size(); ++i)
+	{
+		indices[i] = i;
+	}
+	return SmoothLoop(V, loop, indices, num_iterations);
+}
+
+
 VectorArray ChaikinSmoothing2(const VectorArray& V, const std::vector<int>& loop, int num_iterations)
 {
 	// Ԉ
@@ -56,38 +126,6 @@ VectorArray ChaikinSmoothing2(const VectorArray& V, const std::vector<int>& loop
 	{
 		target_indices.push_back(loop.size() - 1);
 	}
-	size_t xidata_size = target_indices.size();
-
-
-	VectorArray smoothed(target_indices.size(), 3);
-	for (size_t i = 0; i < target_indices.size(); ++i)
-	{
-		smoothed.row(i) = V.row(target_indices[i]);
-	}
 
-	for (auto i = 0; i < num_iterations; ++i)
-	{
-		std::vector<Eigen::Vector3d> new_loop;
-		for (auto j = 0; j < smoothed.rows() - 1; ++j)
-		{
-			Eigen::Vector3d p0 = smoothed.row(j);
-			Eigen::Vector2d p0_yz = p0.tail<2>();
-			Eigen::Vector3d p1 = smoothed.row(j + 1);
-			Eigen::Vector2d p1_yz = p1.tail<2>();
-
-			Eigen::Vector2d q = 0.75 * p0_yz + 0.25 * p1_yz;
-			Eigen::Vector2d r = 0.25 * p0_yz + 0.75 * p1_yz;
-
-			new_loop.push_back(Eigen::Vector3d(0, q(0), q(1)));
-			new_loop.push_back(Eigen::Vector3d(0, r(0), r(1)));
-		}
-		new_loop.push_back(smoothed.row(smoothed.rows() - 1));
-
-		smoothed.resize(new_loop.size(), 3);
-		for (size_t j = 0; j < new_loop.size(); ++j)
-		{
-			smoothed.row(j) = new_loop[j];
-		}
-	}
-	return smoothed;
-}
\ No newline at end of file
+	return SmoothLoop(V, loop, target_indices, num_iterations);
+}
@@ -1,9 +1,45 @@
 #pragma once
+#include <vector>
 #include "type.h"
 
 
+/**
+* @brief Number of points after Chaikin smoothing, each iteration doubles the points of open and closed polylines alike
+* @param num_points number of points of the polyline, 2 or more
+* @param num_iterations number of iterations
+* @return number of smoothed points
+*/
+inline Eigen::Index ChaikinSmoothedSize(Eigen::Index num_points, int num_iterations)
+{
+	return num_points < 2 || num_iterations <= 0 ? num_points : num_points << num_iterations;
+}
+
+
+/**
+* @brief Chaikin smoothing of a polyline in 3D
+*        the output is allocated once at its final size and iterations ping-pong between it and one scratch buffer.
+*        an open polyline keeps its end points, a closed one (without repeating the first point at the end) wraps around.
+* @param points points of the polyline
+* @param num_iterations number of iterations
+* @param is_closed true for a closed loop
+* @return smoothed points
+*/
+PackedVectorArray ChaikinSmoothing(const PackedVectorArray& points, int num_iterations, bool is_closed);
+
+
+/**
+* @brief Chaikin smoothing of a batch of polylines, in parallel
+* @param polylines points of each polyline
+* @param num_iterations number of iterations
+* @param is_closed true for closed loops
+* @return smoothed points of each polyline
+*/
+std::vector<PackedVectorArray> ChaikinSmoothing(const std::vector<PackedVectorArray>& polylines, int num_iterations, bool is_closed);
+
+
 /**
 * @brief Chaikin smoothing
+*        the loop is closed if its first and last vertices are the same, like a margin line.
 * @param V vertices
 * @param loop loop
 * @param num_iterations number of iterations
@@ -12,4 +48,11 @@
 VectorArray ChaikinSmoothing(const VectorArray& V, const std::vector<int>& loop, int num_iterations);
 
 
+/**
+* @brief Chaikin smoothing of a loop decimated to about 30 points
+* @param V vertices
+* @param loop loop
+* @param num_iterations number of iterations
+* @return smoothed vertices
+*/
 VectorArray ChaikinSmoothing2(const VectorArray& V, const std::vector<int>& loop, int num_iterations);
@@ -0,0 +1,407 @@
+#include "spool_watcher.h"
+#include <iostream>
+#ifdef __linux__
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/file.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <nlohmann/json.hpp>
+#endif
+
+
+#ifdef __linux__
+namespace
+{
+	static const int POLL_TIMEOUT_MS = 200;	// how often is_stopping is checked while idle
+	static const uint32_t SPOOL_EVENTS = IN_CREATE | IN_MOVED_TO | IN_ONLYDIR;
+	static const uint32_t JOB_EVENTS = IN_CREATE | IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_TO;
+
+
+	/**
+	 * @brief Check whether a job folder holds a complete job that is not done
+	 *        a job locked by another process is ready as well, the claim finds out whether its process is still running it.
+	 * @param job job folder
+	 * @param written_models model files seen complete while the folder is watched, null to take the model file as it is
+	 * @return true if input.json parses, its model file is complete and the job is not done, false otherwise
+	 */
+	bool IsJobReady(const std::filesystem::path& job, const std::set<std::string>* written_models)
+	{
+		std::error_code ec;
+		if (std::filesystem::exists(job / "output.json", ec))
+		{
+			return false;
+		}
+
+		std::ifstream ifs(job / "input.json");
+		if (!ifs.is_open())
+		{
+			return false;
+		}
+		try
+		{
+			// a half written input.json does not parse, the job is looked at again when it is closed
+			const auto input = nlohmann::json::parse(ifs);
+			const auto type = input.at("model").at("type").get<std::string>();
+			return type == "shm" ||
+				(std::filesystem::exists(job / ("model" + type), ec) && (written_models == nullptr || written_models->count("model" + type) > 0));
+		}
+		catch (const std::exception&)
+		{
+			return false;
+		}
+	}
+
+
+	/**
+	 * @brief Claim a job by taking the exclusive flock of its lock file, atomic between processes
+	 *        the flock is held while the job runs and released by the kernel when its process dies,
+	 *        so the job of a crashed process can be claimed again.
+	 * @param job job folder
+	 * @return descriptor of the lock file, to close once output.json is written. -1 if the job is taken or done
+	 */
+	int ClaimJob(const std::filesystem::path& job)
+	{
+		const auto fd = open((job / SPOOL_LOCK_FILENAME).c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+		if (fd < 0)
+		{
+			return -1;
+		}
+		if (flock(fd, LOCK_EX | LOCK_NB) != 0)
+		{
+			close(fd);
+			return -1;
+		}
+
+		// output.json is written before its lock is released, so a job seen without it under the lock was never finished
+		std::error_code ec;
+		if (std::filesystem::exists(job / "output.json", ec))
+		{
+			close(fd);
+			return -1;
+		}
+		struct stat status;
+		if (fstat(fd, &status) == 0 && status.st_size > 0)
+		{
+			std::cout << "taking over " << job.string() << " from a process that stopped running it\n";
+		}
+
+		// the pid is for people looking at the spool, the flock is the claim
+		const auto pid = std::to_string(getpid()) + "\n";
+		auto written = ftruncate(fd, 0) == 0 ? pwrite(fd, pid.data(), pid.size(), 0) : -1;
+		(void)written;
+		return fd;
+	}
+
+
+	/**
+	 * @brief Complete jobs waiting for a worker, and the workers
+	 */
+	class JobQueue
+	{
+		std::mutex mutex_;
+		std::condition_variable cv_;
+		std::deque<std::filesystem::path> jobs_;
+		std::set<std::filesystem::path> known_;	// queued or running, so that repeated events do not queue a job twice
+		bool is_stopping_ = false;
+		std::vector<std::thread> workers_;
+
+	public:
+		void Start(int num_workers, const SpoolJobHandler& run_job)
+		{
+			for (int w = 0; w < num_workers; ++w)
+			{
+				workers_.emplace_back([this, w, &run_job]()
+					{
+						for (;;)
+						{
+							std::filesystem::path job;
+							{
+								std::unique_lock<std::mutex> lock(mutex_);
+								cv_.wait(lock, [this]() { return is_stopping_ || !jobs_.empty(); });
+								if (is_stopping_)
+								{
+									return;
+								}
+								job = jobs_.front();
+								jobs_.pop_front();
+							}
+
+							// jobs are claimed when a worker is free, so busy processes leave them to the others
+							const auto lock_fd = ClaimJob(job);
+							if (lock_fd >= 0)
+							{
+								std::cout << "claimed " << job.string() << " on worker " << w << "\n";
+								run_job(w, job / "input.json");
+								close(lock_fd);
+							}
+
+							std::lock_guard<std::mutex> lock(mutex_);
+							known_.erase(job);
+						}
+					});
+			}
+		}
+
+		/**
+		 * @brief Queue a complete job
+		 * @param job job folder
+		 * @return true if it is queued, false if it is already queued or running
+		 */
+		bool Push(const std::filesystem::path& job)
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				if (!known_.insert(job).second)
+				{
+					return false;
+				}
+				jobs_.push_back(job);
+			}
+			cv_.notify_one();
+			return true;
+		}
+
+		/**
+		 * @brief Stop the workers once their jobs are done, queued jobs are left unclaimed
+		 */
+		void Stop()
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				is_stopping_ = true;
+			}
+			cv_.notify_all();
+			for (auto& worker : workers_)
+			{
+				worker.join();
+			}
+			workers_.clear();
+		}
+	};
+
+
+	/**
+	 * @brief Watches of the spools and of the job folders that are not complete yet
+	 */
+	class Watches
+	{
+		int fd_;
+		std::map<int, std::filesystem::path> spools_;
+		std::map<int, std::filesystem::path> jobs_;
+		std::map<std::filesystem::path, std::set<std::string>> written_models_;	// complete model files of the watched job folders
+		JobQueue& queue_;
+
+	public:
+		Watches(int fd, JobQueue& queue)
+			: fd_(fd), queue_(queue)
+		{
+		}
+
+		bool AddSpool(const std::filesystem::path& spool)
+		{
+			const auto wd = inotify_add_watch(fd_, spool.c_str(), SPOOL_EVENTS);
+			if (wd < 0)
+			{
+				std::cout << "failed to watch " << spool.string() << ": " << std::strerror(errno) << "\n";
+				return false;
+			}
+			spools_[wd] = spool;
+			return true;
+		}
+
+		/**
+		 * @brief Queue a job folder if it is complete, otherwise watch it until it is
+		 *        the folder is looked at after the watch is added, so files written in between are not missed
+		 * @param job job folder, a copy since the watch it may come from is removed
+		 */
+		void AddJob(const std::filesystem::path job)
+		{
+			auto found = std::find_if(jobs_.begin(), jobs_.end(), [&job](const auto& watch) { return watch.second == job; });
+			if (found == jobs_.end() && !IsJobReady(job, nullptr))
+			{
+				const auto wd = inotify_add_watch(fd_, job.c_str(), JOB_EVENTS | IN_ONLYDIR);
+				if (wd < 0)
+				{
+					return;	// removed meanwhile
+				}
+				jobs_[wd] = job;
+				found = jobs_.find(wd);
+
+				// the model files already there are taken as they are, the ones written from now on once they are closed
+				auto& written_models = written_models_[job];
+				std::error_code ec;
+				for (const auto& entry : std::filesystem::directory_iterator(job, ec))
+				{
+					const auto name = entry.path().filename().string();
+					if (name.rfind("model", 0) == 0)
+					{
+						written_models.insert(name);
+					}
+				}
+			}
+			if (IsJobReady(job, found != jobs_.end() ? &written_models_[job] : nullptr))
+			{
+				if (found != jobs_.end())
+				{
+					inotify_rm_watch(fd_, found->first);
+					jobs_.erase(found);
+				}
+				written_models_.erase(job);
+				queue_.Push(job);
+			}
+		}
+
+		/**
+		 * @brief Look at every folder of the spools, on start and when events are lost
+		 */
+		void Scan()
+		{
+			for (const auto& spool : spools_)
+			{
+				std::error_code ec;
+				for (const auto& entry : std::filesystem::directory_iterator(spool.second, ec))
+				{
+					if (entry.is_directory(ec))
+					{
+						AddJob(entry.path());
+					}
+				}
+			}
+		}
+
+		void OnEvent(const inotify_event& event)
+		{
+			if (event.mask & IN_Q_OVERFLOW)
+			{
+				std::cout << "inotify events are lost, scanning the spools again\n";
+				Scan();
+				return;
+			}
+			if (event.mask & IN_IGNORED)
+			{
+				const auto job = jobs_.find(event.wd);
+				if (job != jobs_.end())
+				{
+					written_models_.erase(job->second);
+					jobs_.erase(job);
+				}
+				spools_.erase(event.wd);
+				return;
+			}
+
+			const std::string name = event.len > 0 ? event.name : "";
+			auto spool = spools_.find(event.wd);
+			if (spool != spools_.end())
+			{
+				if ((event.mask & IN_ISDIR) && !name.empty())
+				{
+					AddJob(spool->second / name);
+				}
+				return;
+			}
+			auto job = jobs_.find(event.wd);
+			if (job == jobs_.end() || (name != "input.json" && name.rfind("model", 0) != 0))
+			{
+				return;
+			}
+			// a model file is complete once it is closed after writing, or renamed into place
+			if (event.mask & (IN_CREATE | IN_MODIFY))
+			{
+				written_models_[job->second].erase(name);
+				return;
+			}
+			if (name != "input.json")
+			{
+				written_models_[job->second].insert(name);
+			}
+			AddJob(job->second);
+		}
+	};
+}
+
+
+bool WatchSpool(const SpoolOptions& options, const SpoolJobHandler& run_job, const std::atomic<bool>& is_stopping)
+{
+	if (options.directories.empty())
+	{
+		std::cout << "no spool directory to watch\n";
+		return false;
+	}
+
+	const auto fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (fd < 0)
+	{
+		std::cout << "inotify_init1: " << std::strerror(errno) << "\n";
+		return false;
+	}
+
+	JobQueue queue;
+	Watches watches(fd, queue);
+	for (const auto& directory : options.directories)
+	{
+		if (!watches.AddSpool(directory))
+		{
+			close(fd);
+			return false;
+		}
+	}
+	queue.Start(std::max(1, options.num_workers), run_job);
+	watches.Scan();
+	std::cout << "done to start watching " << options.directories.size() << " spool directories with " << std::max(1, options.num_workers) << " workers\n";
+
+	alignas(inotify_event) char buffer[64 * 1024];
+	while (!is_stopping)
+	{
+		pollfd pfd{ fd, POLLIN, 0 };
+		const auto ready = poll(&pfd, 1, POLL_TIMEOUT_MS);
+		if (ready < 0 && errno != EINTR)
+		{
+			std::cout << "poll: " << std::strerror(errno) << "\n";
+			break;
+		}
+		if (ready <= 0)
+		{
+			continue;
+		}
+
+		for (;;)
+		{
+			const auto length = read(fd, buffer, sizeof(buffer));
+			if (length <= 0)
+			{
+				break;
+			}
+			for (ssize_t offset = 0; offset < length;)
+			{
+				const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+				watches.OnEvent(*event);
+				offset += sizeof(inotify_event) + event->len;
+			}
+		}
+	}
+
+	queue.Stop();
+	close(fd);
+	std::cout << "done to stop watching the spool directories\n";
+	return true;
+}
+#else
+bool WatchSpool(const SpoolOptions& options, const SpoolJobHandler& run_job, const std::atomic<bool>& is_stopping)
+{
+	std::cout << "spool directories are only watched on Linux\n";
+	return false;
+}
+#endif
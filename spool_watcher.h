@@ -0,0 +1,49 @@
+#pragma once
+#include <atomic>
+#include <filesystem>
+#include <functional>
+#include <vector>
+
+
+/**
+ * @brief Runs a claimed job, on a worker thread
+ * @param worker index of the worker, from 0 to num_workers - 1. a worker runs one job at a time
+ * @param input_json input.json of the job
+ */
+using SpoolJobHandler = std::function<void(int worker, const std::filesystem::path& input_json)>;
+
+
+/**
+ * @brief Spool intake options
+ */
+struct SpoolOptions
+{
+	std::vector<std::filesystem::path> directories;	// spool directories, each job is a folder in one of them
+	int num_workers = 1;	// number of jobs run at once
+};
+
+
+/**
+ * @brief Name of the lock file that claims a job
+ */
+static const char* const SPOOL_LOCK_FILENAME = "job.lock";
+
+
+/**
+ * @brief Watch spool directories with inotify and run the jobs dropped into them, until is_stopping becomes true
+ *        a job is a folder in a spool directory with input.json and its model file, as the command line front-end reads them.
+ *        it is complete once input.json parses and the model file exists and was closed after writing, so upstream should
+ *        write the model first and input.json last (or rename them into place). writes are only seen once the job folder is
+ *        watched: a folder that appears with its files already in it, or is there on start, is taken as it is,
+ *        so such a job must be built elsewhere and its folder renamed into the spool. folders with output.json are skipped.
+ *        a free worker claims a complete job by taking an exclusive flock on job.lock and holds it until output.json is written,
+ *        so several processes may watch the same spool. the lock file stays with output.json when the job is done.
+ *        a process that crashes releases its flock, and its job is claimed again by the next watcher that starts.
+ *        jobs already in the spools are picked up on start, and the spools are scanned again when the event queue overflows.
+ *        only available on Linux.
+ * @param options spool directories and workers
+ * @param run_job runs a claimed job on a worker thread, and writes output.json next to input.json
+ * @param is_stopping set to stop, the jobs being run are finished and unclaimed jobs stay in the spools
+ * @return false if the spools cannot be watched, true when stopped
+ */
+bool WatchSpool(const SpoolOptions& options, const SpoolJobHandler& run_job, const std::atomic<bool>& is_stopping);
@@ -0,0 +1,115 @@
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include "gem_format.h"
+#include "io_utils.h"
+
+
+namespace
+{
+	/**
+	 * @brief Hash of the exact coordinates of a vertex
+	 */
+	struct VertexHash
+	{
+		size_t operator()(const Eigen::RowVector3d& p) const
+		{
+			size_t h = 0;
+			for (int k = 0; k < 3; ++k)
+			{
+				std::uint64_t bits;
+				const double value = p[k] == 0.0 ? 0.0 : p[k];	// -0.0 and 0.0 are the same vertex
+				std::memcpy(&bits, &value, sizeof(bits));
+				h = h * 0x9e3779b97f4a7c15ull + (bits ^ (bits >> 31));
+			}
+			return h;
+		}
+	};
+
+
+	/**
+	 * @brief Merge vertices with exactly the same coordinates, like the corners repeated per triangle in STL
+	 * @param V [i/o] vertices
+	 * @param F [i/o] faces
+	 * @return number of merged vertices
+	 */
+	Eigen::Index WeldVertices(VectorArray& V, IndicesArray& F)
+	{
+		std::unordered_map<Eigen::RowVector3d, int, VertexHash> unique;
+		unique.reserve(static_cast<size_t>(V.rows()));
+		std::vector<int> old_to_new(V.rows());
+		VectorArray welded(V.rows(), 3);
+		int num_unique = 0;
+		for (Eigen::Index i = 0; i < V.rows(); ++i)
+		{
+			const Eigen::RowVector3d p = V.row(i);
+			auto inserted = unique.emplace(p, num_unique);
+			if (inserted.second)
+			{
+				welded.row(num_unique++) = p;
+			}
+			old_to_new[i] = inserted.first->second;
+		}
+		for (Eigen::Index f = 0; f < F.rows(); ++f)
+		{
+			for (Eigen::Index k = 0; k < 3; ++k)
+			{
+				F(f, k) = old_to_new[F(f, k)];
+			}
+		}
+		const auto num_merged = V.rows() - num_unique;
+		welded.conservativeResize(num_unique, 3);
+		V.swap(welded);
+		return num_merged;
+	}
+}
+
+
+int main(int argc, char* argv[])
+{
+	if (argc < 3)
+	{
+		std::cout << "Usage: " << argv[0] << " <input .ply/.stl> <output .gem> [--bits 16|21] [--adjacency]\n";
+		return 1;
+	}
+
+	GemOptions options;
+	for (int i = 3; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+		if (arg == "--bits" && i + 1 < argc)
+		{
+			options.position_bits = std::stoi(argv[++i]);
+		}
+		else if (arg == "--adjacency")
+		{
+			options.with_adjacency = true;
+		}
+		else
+		{
+			std::cout << "unknown option: " << arg << "\n";
+			return 1;
+		}
+	}
+
+	VectorArray V;
+	IndicesArray F;
+	if (!LoadModel(argv[1], V, F))
+	{
+		std::cout << "failed to load " << argv[1] << "\n";
+		return 1;
+	}
+	std::cout << "model is loaded: " << V.rows() << " vertices, " << F.rows() << " faces\n";
+
+	const auto num_merged = WeldVertices(V, F);
+	std::cout << "done to weld " << num_merged << " duplicated vertices\n";
+
+	if (!SaveGem(argv[2], V, F, options))
+	{
+		std::cout << "failed to save " << argv[2] << "\n";
+		return 1;
+	}
+	std::cout << "done to convert to " << argv[2] << "\n";
+	return 0;
+}
@@ -0,0 +1,618 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <igl/PI.h>
+#include "gem_format.h"
+#include "geometry_engine.h"
+#include "io_utils.h"
+#include "replay_log.h"
+#include "result_cache.h"
+#include "return_code.h"
+#include "synthetic_mesh.h"
+
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+
+	double ElapsedMs(Clock::time_point since, Clock::time_point until)
+	{
+		return std::chrono::duration<double, std::milli>(until - since).count();
+	}
+
+
+	/**
+	 * @brief Timing of one replayed request
+	 */
+	struct Sample
+	{
+		int return_code = 0;
+		double latency_ms = 0.0;	// from the scheduled start to the end, including the wait for a worker
+		double service_ms = 0.0;	// from the actual start to the end
+		GeometryEngineOutput::Metrics metrics{ 0.0, 0.0, 0.0, 0.0, 0.0, 0, {} };	// as reported by the engine
+	};
+
+
+	/**
+	 * @brief Replay options
+	 */
+	struct ReplayOptions
+	{
+		std::string target = "library";	// 'library' or 'cli'
+		std::filesystem::path cli;	// path to the command line front-end
+		std::filesystem::path work_directory;	// inputs and outputs of the cli target
+		double rate = 0.0;	// requests per second, 0 to send the next request as soon as a worker is free
+		int concurrency = 1;	// number of workers
+		int num_requests = 0;	// number of requests, 0 for one pass over the log
+		std::filesystem::path report;	// json report, optional
+		bool is_perf_enabled = false;	// collect event counters of the stages
+	};
+
+
+	double Percentile(std::vector<double> values, double p)
+	{
+		if (values.empty())
+		{
+			return 0.0;
+		}
+		std::sort(values.begin(), values.end());
+		// nearest rank
+		auto rank = static_cast<size_t>(std::ceil(p / 100.0 * values.size()));
+		return values[std::min(values.size(), std::max<size_t>(rank, 1)) - 1];
+	}
+
+
+	/**
+	 * @brief Print and save throughput and latency percentiles per stage
+	 * @param samples samples of the completed requests
+	 * @param elapsed_ms wall time of the replay
+	 * @param options replay options
+	 */
+	void Report(const std::vector<Sample>& samples, double elapsed_ms, const ReplayOptions& options)
+	{
+		std::vector<std::pair<std::string, std::vector<double>>> stages = {
+			{"load", {}}, {"curvature", {}}, {"traversal", {}}, {"export", {}}, {"total", {}}, {"service", {}}, {"latency", {}} };
+		std::map<int, size_t> return_codes;
+		for (const auto& s : samples)
+		{
+			stages[0].second.push_back(s.metrics.load_ms);
+			stages[1].second.push_back(s.metrics.curvature_ms);
+			stages[2].second.push_back(s.metrics.traversal_ms);
+			stages[3].second.push_back(s.metrics.export_ms);
+			stages[4].second.push_back(s.metrics.total_ms);
+			stages[5].second.push_back(s.service_ms);
+			stages[6].second.push_back(s.latency_ms);
+			++return_codes[s.return_code];
+		}
+
+		const auto throughput = elapsed_ms > 0.0 ? samples.size() * 1000.0 / elapsed_ms : 0.0;
+		nlohmann::json report = {
+			{"target", options.target},
+			{"rate", options.rate},
+			{"concurrency", options.concurrency},
+			{"num_requests", samples.size()},
+			{"elapsed_ms", elapsed_ms},
+			{"throughput", throughput} };
+
+		std::cout << "requests: " << samples.size() << ", elapsed: " << elapsed_ms << " ms, throughput: " << throughput << " requests/s\n";
+		for (const auto& rc : return_codes)
+		{
+			std::cout << "  return code " << rc.first << ": " << rc.second << "\n";
+			report["return_codes"][std::to_string(rc.first)] = rc.second;
+		}
+		std::cout << std::left << std::setw(12) << "stage" << std::right
+			<< std::setw(12) << "p50 ms" << std::setw(12) << "p95 ms" << std::setw(12) << "p99 ms" << std::setw(12) << "max ms" << "\n";
+		for (const auto& stage : stages)
+		{
+			const auto p50 = Percentile(stage.second, 50.0);
+			const auto p95 = Percentile(stage.second, 95.0);
+			const auto p99 = Percentile(stage.second, 99.0);
+			const auto max = Percentile(stage.second, 100.0);
+			std::cout << std::left << std::setw(12) << stage.first << std::right << std::fixed << std::setprecision(3)
+				<< std::setw(12) << p50 << std::setw(12) << p95 << std::setw(12) << p99 << std::setw(12) << max << "\n";
+			std::cout.unsetf(std::ios::floatfield);
+			report["stages"][stage.first] = { {"p50_ms", p50}, {"p95_ms", p95}, {"p99_ms", p99}, {"max_ms", max} };
+		}
+
+		// scratch memory of a run from the job arena of the engine
+		std::vector<double> arena_bytes;
+		for (const auto& s : samples)
+		{
+			arena_bytes.push_back(static_cast<double>(s.metrics.arena_bytes));
+		}
+		std::cout << "arena bytes per request: p50 " << static_cast<std::uint64_t>(Percentile(arena_bytes, 50.0))
+			<< ", p95 " << static_cast<std::uint64_t>(Percentile(arena_bytes, 95.0))
+			<< ", max " << static_cast<std::uint64_t>(Percentile(arena_bytes, 100.0)) << "\n";
+		report["arena_bytes"] = { {"p50", Percentile(arena_bytes, 50.0)}, {"p95", Percentile(arena_bytes, 95.0)}, {"max", Percentile(arena_bytes, 100.0)} };
+
+		// counters are summed per stage, a counter missing on the host stays out of the sums
+		std::map<std::string, std::array<std::int64_t, 5>> counters;
+		std::vector<std::string> counter_stages;
+		for (const auto& s : samples)
+		{
+			for (const auto& c : s.metrics.counters)
+			{
+				auto inserted = counters.emplace(c.stage, std::array<std::int64_t, 5>{ -1, -1, -1, -1, -1 });
+				if (inserted.second)
+				{
+					counter_stages.push_back(c.stage);
+				}
+				const std::int64_t values[5] = { c.cycles, c.instructions, c.cache_misses, c.branch_misses, c.page_faults };
+				auto& sums = inserted.first->second;
+				for (int k = 0; k < 5; ++k)
+				{
+					if (values[k] >= 0)
+					{
+						sums[k] = std::max<std::int64_t>(sums[k], 0) + values[k];
+					}
+				}
+			}
+		}
+		if (!counter_stages.empty())
+		{
+			std::cout << "event counters per request (mean)\n";
+			std::cout << std::left << std::setw(12) << "stage" << std::right << std::setw(16) << "cycles" << std::setw(16) << "instructions"
+				<< std::setw(8) << "IPC" << std::setw(14) << "cache misses" << std::setw(14) << "branch misses" << std::setw(12) << "page faults" << "\n";
+			const auto n = static_cast<double>(samples.size());
+			auto mean = [n](std::int64_t sum) { return sum < 0 ? -1.0 : static_cast<double>(sum) / n; };
+			for (const auto& stage : counter_stages)
+			{
+				const auto& sums = counters[stage];
+				const auto ipc = sums[0] > 0 && sums[1] >= 0 ? static_cast<double>(sums[1]) / static_cast<double>(sums[0]) : -1.0;
+				std::cout << std::left << std::setw(12) << stage << std::right << std::fixed << std::setprecision(0)
+					<< std::setw(16) << mean(sums[0]) << std::setw(16) << mean(sums[1]) << std::setprecision(2) << std::setw(8) << ipc << std::setprecision(0)
+					<< std::setw(14) << mean(sums[2]) << std::setw(14) << mean(sums[3]) << std::setw(12) << mean(sums[4]) << "\n";
+				std::cout.unsetf(std::ios::floatfield);
+				report["counters"][stage] = {
+					{"cycles", mean(sums[0])}, {"instructions", mean(sums[1])}, {"ipc", ipc},
+					{"cache_misses", mean(sums[2])}, {"branch_misses", mean(sums[3])}, {"page_faults", mean(sums[4])} };
+			}
+		}
+		else if (options.is_perf_enabled)
+		{
+			std::cout << "event counters are not available on this host\n";
+		}
+
+		if (!options.report.empty())
+		{
+			std::ofstream out(options.report);
+			out << report.dump(4) << "\n";
+			if (!out)
+			{
+				std::cout << "failed to save the report: " << options.report.string() << "\n";
+			}
+		}
+	}
+
+
+	/**
+	 * @brief Request of the log prepared for the library target
+	 */
+	struct LibraryRequest
+	{
+		GeometryEngineInput input;
+		VectorArray V;
+		IndicesArray F;
+	};
+
+
+	/**
+	 * @brief Load the meshes of the log once, so the replay measures the engine and not the disk
+	 *        requests on shared memory meshes and meshes that changed since the capture are skipped.
+	 * @param records requests of the log
+	 * @param requests [o] loaded requests
+	 * @return true if at least one request is loaded
+	 */
+	bool PrepareLibraryRequests(const std::vector<ReplayRecord>& records, std::vector<LibraryRequest>& requests)
+	{
+		for (const auto& record : records)
+		{
+			LibraryRequest request;
+			try
+			{
+				request.input = record.input;
+			}
+			catch (const std::exception& e)
+			{
+				std::cout << "skipped a request with invalid input: " << e.what() << "\n";
+				continue;
+			}
+			if (request.input.model.type == "shm")
+			{
+				std::cout << "skipped a request on shared memory: " << record.model << "\n";
+				continue;
+			}
+			if (!LoadModel(record.model, request.V, request.F))
+			{
+				std::cout << "skipped a request, failed to load " << record.model << "\n";
+				continue;
+			}
+
+			// the captured hash is of the mesh as the engine holds it, after reordering
+			GeometryEngine engine;
+			if (!engine.Initialize(request.input, request.V, request.F) || engine.MeshHash() != record.mesh_hash)
+			{
+				std::cout << "skipped a request, the mesh changed since the capture: " << record.model << "\n";
+				continue;
+			}
+			requests.push_back(std::move(request));
+		}
+		std::cout << "done to load " << requests.size() << " of " << records.size() << " requests\n";
+		return !requests.empty();
+	}
+
+
+	/**
+	 * @brief Copy of a request for the cli target, in a directory of its own so concurrent runs do not share output.json
+	 * @param record request
+	 * @param directory directory of the copy
+	 * @return path to the input json of the copy, empty on failure
+	 */
+	std::filesystem::path PrepareCliRequest(const ReplayRecord& record, const std::filesystem::path& directory)
+	{
+		const auto input_json = directory / "input.json";
+		if (std::filesystem::exists(input_json))
+		{
+			return input_json;
+		}
+
+		std::error_code ec;
+		std::filesystem::create_directories(directory, ec);
+		const auto type = record.input.at("model").at("type").get<std::string>();
+		if (type != "shm")
+		{
+			// hard links are free, copies are used across file systems
+			const auto model = directory / ("model" + type);
+			std::filesystem::create_hard_link(record.model, model, ec);
+			if (ec && !std::filesystem::copy_file(record.model, model, std::filesystem::copy_options::overwrite_existing, ec))
+			{
+				std::cout << "failed to copy " << record.model << ": " << ec.message() << "\n";
+				return {};
+			}
+		}
+		std::ofstream out(input_json);
+		out << record.input.dump(4) << "\n";
+		return out ? input_json : std::filesystem::path();
+	}
+
+
+	Sample RunCli(const ReplayOptions& options, const std::filesystem::path& input_json)
+	{
+		Sample sample;
+		sample.return_code = ToInt(ReturnCode::kUnknownError);
+		if (input_json.empty())
+		{
+			return sample;
+		}
+		const auto output_json = input_json.parent_path() / "output.json";
+		std::error_code ec;
+		std::filesystem::remove(output_json, ec);
+
+#ifdef _WIN32
+		const auto command = "\"\"" + options.cli.string() + "\" \"" + input_json.string() + "\"" + (options.is_perf_enabled ? " --perf" : "") + " > NUL\"";
+#else
+		const auto command = "'" + options.cli.string() + "' '" + input_json.string() + "'" + (options.is_perf_enabled ? " --perf" : "") + " > /dev/null";
+#endif
+		std::system(command.c_str());
+
+		try
+		{
+			std::ifstream ifs(output_json);
+			const GeometryEngineOutput output = nlohmann::json::parse(ifs);
+			sample.return_code = output.return_code;
+			sample.metrics = output.metrics;
+		}
+		catch (const std::exception&)
+		{
+			// the cli did not write an output, the return code stays kUnknownError
+		}
+		return sample;
+	}
+
+
+	/**
+	 * @brief Replay a log at the given rate and concurrency
+	 *        request i is scheduled at i / rate after the start (open loop), so latency includes the wait for a worker
+	 *        when the target falls behind. with rate 0 each worker sends its next request as soon as it is free (closed loop).
+	 * @param records requests of the log
+	 * @param options replay options
+	 * @return process exit code
+	 */
+	int Replay(const std::vector<ReplayRecord>& records, const ReplayOptions& options)
+	{
+		std::vector<LibraryRequest> library_requests;
+		if (options.target == "library")
+		{
+			if (!PrepareLibraryRequests(records, library_requests))
+			{
+				return 1;
+			}
+		}
+		else if (options.target != "cli")
+		{
+			std::cout << "unknown target: " << options.target << " (expected: library or cli)\n";
+			return 1;
+		}
+
+		const auto num_records = options.target == "library" ? library_requests.size() : records.size();
+		const auto num_requests = options.num_requests > 0 ? static_cast<size_t>(options.num_requests) : num_records;
+		std::vector<Sample> samples(num_requests);
+		std::atomic<size_t> next(0);
+
+		const auto start = Clock::now();
+		auto work = [&](int worker)
+			{
+				// engines are reused by the worker, as a long running process would
+				GeometryEngine engine;
+				engine.EnablePerfCounters(options.is_perf_enabled);
+				for (auto i = next++; i < num_requests; i = next++)
+				{
+					auto scheduled = start;
+					if (options.rate > 0.0)
+					{
+						scheduled += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(i / options.rate));
+						std::this_thread::sleep_until(scheduled);
+					}
+					const auto begin = Clock::now();
+					if (options.rate <= 0.0)
+					{
+						scheduled = begin;
+					}
+
+					Sample sample;
+					const auto r = i % num_records;
+					if (options.target == "library")
+					{
+						const auto& request = library_requests[r];
+						if (engine.Initialize(request.input, request.V, request.F))
+						{
+							engine.Run();
+						}
+						sample.return_code = engine.output().return_code;
+						sample.metrics = engine.output().metrics;
+					}
+					else
+					{
+						const auto directory = options.work_directory / ("worker_" + std::to_string(worker)) / ("request_" + std::to_string(r));
+						sample = RunCli(options, PrepareCliRequest(records[r], directory));
+					}
+
+					const auto end = Clock::now();
+					sample.latency_ms = ElapsedMs(scheduled, end);
+					sample.service_ms = ElapsedMs(begin, end);
+					samples[i] = sample;
+				}
+			};
+
+		std::vector<std::thread> workers;
+		for (int t = 0; t < options.concurrency; ++t)
+		{
+			workers.emplace_back(work, t);
+		}
+		for (auto& worker : workers)
+		{
+			worker.join();
+		}
+		const auto elapsed_ms = ElapsedMs(start, Clock::now());
+
+		Report(samples, elapsed_ms, options);
+		return 0;
+	}
+
+
+	/**
+	 * @brief Write a corpus of synthetic jobs and the replay log that runs them
+	 *        each job is a directory with input.json and model.gem, like a captured request.
+	 * @param directory corpus directory
+	 * @param num_jobs number of jobs
+	 * @param resolution vertices per ring of the meshes
+	 * @param seed seed of the random shapes
+	 * @return process exit code
+	 */
+	int Synthesize(const std::filesystem::path& directory, int num_jobs, int resolution, unsigned int seed)
+	{
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<double> uniform(0.0, 1.0);
+		std::uniform_int_distribution<int> frequency(1, 4);
+
+		std::filesystem::create_directories(directory);
+		const auto replay_log = directory / "replay.jsonl";
+		std::error_code ec;
+		std::filesystem::remove(replay_log, ec);
+
+		GemOptions gem_options;
+		gem_options.position_bits = 21;
+		gem_options.with_adjacency = true;
+		for (int i = 0; i < num_jobs; ++i)
+		{
+			SyntheticPrepParams params;
+			params.resolution = resolution;
+			params.radius = 4.0 + 2.0 * uniform(rng);
+			params.margin_height = 3.0 + 2.0 * uniform(rng);
+			params.core_height = 3.0 + 2.0 * uniform(rng);
+			params.shelf = 0.1 + 0.2 * uniform(rng);
+			params.waviness = uniform(rng);
+			params.waviness_frequency = frequency(rng);
+			params.phase = 2.0 * igl::PI * uniform(rng);
+			const auto prep = MakeSyntheticPrep(params);
+
+			std::stringstream name;
+			name << "job_" << std::setw(4) << std::setfill('0') << i;
+			const auto job_directory = directory / name.str();
+			std::filesystem::create_directories(job_directory);
+			const auto model = job_directory / "model.gem";
+			if (!SaveGem(model, prep.V, prep.F, gem_options))
+			{
+				std::cout << "failed to save " << model.string() << "\n";
+				return 1;
+			}
+
+			GeometryEngineInput input;
+			input.model = { name.str(), name.str(), ".gem", "synthetic", "", "none" };
+			input.operation.type = "marginline";
+			input.operation.marginline.type = "coordinate";
+			input.operation.marginline.seed = { prep.seed(0), prep.seed(1), prep.seed(2) };
+			input.operation.marginline.num_samples = 100;
+			input.operation.marginline.threshold_to_remove_last_point = 0.2;
+
+			ReplayRecord record;
+			record.input = input;
+			record.input_json = std::filesystem::absolute(job_directory / "input.json").string();
+			record.model = std::filesystem::absolute(model).string();
+			{
+				std::ofstream out(record.input_json);
+				out << record.input.dump(4) << "\n";
+			}
+
+			// the engine holds the mesh as decoded from the file, so the hash is taken after a round trip
+			VectorArray V;
+			IndicesArray F;
+			if (!LoadGem(model, V, F, nullptr))
+			{
+				std::cout << "failed to load " << model.string() << "\n";
+				return 1;
+			}
+			record.mesh_hash = HashMesh(V, F);
+			if (!AppendReplayRecord(replay_log, record))
+			{
+				return 1;
+			}
+		}
+		std::cout << "done to write " << num_jobs << " jobs and " << replay_log.string() << "\n";
+		return 0;
+	}
+
+
+	void PrintUsage(const char* program)
+	{
+		std::cout << "Usage:\n"
+			<< "  " << program << " synth <corpus directory> [--count N] [--resolution N] [--seed N]\n"
+			<< "  " << program << " replay <replay log> [--target library|cli] [--cli <path>] [--work <directory>]\n"
+			<< "      [--rate <requests/s>] [--concurrency N] [--requests N] [--report <report json>] [--perf]\n"
+			<< "requests are captured by running the command line front-end with --record <replay log>.\n";
+	}
+}
+
+
+int main(int argc, char* argv[])
+{
+	if (argc < 3)
+	{
+		PrintUsage(argv[0]);
+		return 1;
+	}
+	const std::string command = argv[1];
+	const std::filesystem::path path = argv[2];
+
+	try
+	{
+		if (command == "synth")
+		{
+			int num_jobs = 16;
+			int resolution = 128;
+			unsigned int seed = 0;
+			for (int i = 3; i < argc; ++i)
+			{
+				const std::string arg = argv[i];
+				if (arg == "--count" && i + 1 < argc)
+				{
+					num_jobs = std::stoi(argv[++i]);
+				}
+				else if (arg == "--resolution" && i + 1 < argc)
+				{
+					resolution = std::stoi(argv[++i]);
+				}
+				else if (arg == "--seed" && i + 1 < argc)
+				{
+					seed = static_cast<unsigned int>(std::stoul(argv[++i]));
+				}
+				else
+				{
+					std::cout << "unknown option: " << arg << "\n";
+					return 1;
+				}
+			}
+			return Synthesize(path, num_jobs, resolution, seed);
+		}
+		else if (command == "replay")
+		{
+			ReplayOptions options;
+			options.work_directory = std::filesystem::temp_directory_path() / "geometry_engine_replay";
+			for (int i = 3; i < argc; ++i)
+			{
+				const std::string arg = argv[i];
+				if (arg == "--target" && i + 1 < argc)
+				{
+					options.target = argv[++i];
+				}
+				else if (arg == "--cli" && i + 1 < argc)
+				{
+					options.cli = std::filesystem::absolute(argv[++i]);
+				}
+				else if (arg == "--work" && i + 1 < argc)
+				{
+					options.work_directory = argv[++i];
+				}
+				else if (arg == "--rate" && i + 1 < argc)
+				{
+					options.rate = std::stod(argv[++i]);
+				}
+				else if (arg == "--concurrency" && i + 1 < argc)
+				{
+					options.concurrency = std::max(1, std::stoi(argv[++i]));
+				}
+				else if (arg == "--requests" && i + 1 < argc)
+				{
+					options.num_requests = std::stoi(argv[++i]);
+				}
+				else if (arg == "--report" && i + 1 < argc)
+				{
+					options.report = argv[++i];
+				}
+				else if (arg == "--perf")
+				{
+					options.is_perf_enabled = true;
+				}
+				else
+				{
+					std::cout << "unknown option: " << arg << "\n";
+					return 1;
+				}
+			}
+			if (options.target == "cli" && options.cli.empty())
+			{
+				std::cout << "--cli is required for the cli target\n";
+				return 1;
+			}
+
+			std::vector<ReplayRecord> records;
+			if (!LoadReplayLog(path, records) || records.empty())
+			{
+				std::cout << "no requests to replay in " << path.string() << "\n";
+				return 1;
+			}
+			return Replay(records, options);
+		}
+	}
+	catch (const std::exception& e)
+	{
+		std::cout << e.what() << "\n";
+		return 1;
+	}
+
+	PrintUsage(argv[0]);
+	return 1;
+}
@@ -0,0 +1,568 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <igl/PI.h>
+#include "gem_format.h"
+#include "geometry_engine.h"
+#include "io_utils.h"
+#include "return_code.h"
+#include "synthetic_mesh.h"
+
+
+namespace
+{
+	/**
+	 * @brief Mesh with its ground-truth margin
+	 */
+	struct EvalCase
+	{
+		std::string name;
+		GeometryEngineInput input;	// seed and sampling, the variant is set per run
+		VectorArray V;
+		IndicesArray F;
+		VectorArray truth;	// ground-truth margin, a closed polyline
+	};
+
+
+	/**
+	 * @brief Curvature estimator and tracer under evaluation
+	 */
+	struct Variant
+	{
+		std::string estimator;	// operation.curvature.estimator
+		std::string tracer;	// operation.marginline.tracer
+
+		std::string name() const { return estimator + "/" + tracer; }
+	};
+
+
+	/**
+	 * @brief Accuracy and cost of one run
+	 */
+	struct RunResult
+	{
+		int return_code = 0;
+		double hausdorff = 0.0;	// symmetric Hausdorff distance between the traced line and the ground truth
+		double mean_distance = 0.0;	// mean distance from the sampled points to the ground truth
+		double curvature_ms = 0.0;
+		double traversal_ms = 0.0;
+		double total_ms = 0.0;
+		std::uint64_t arena_bytes = 0;
+		long peak_rss_kb = -1;	// peak resident set of the run, -1 when the host does not report it
+	};
+
+
+	/**
+	 * @brief Evaluation options
+	 */
+	struct EvalOptions
+	{
+		std::vector<int> resolutions = { 64, 128, 256 };
+		std::vector<double> wavinesses = { 0.0, 0.5, 1.0 };
+		std::vector<int> frequencies = { 2, 3 };
+		std::vector<Variant> variants = {
+			{ "quadric", "greedy" }, { "quadric", "ridge" }, { "quadric", "bidirectional" },
+			{ "normal_cycle", "greedy" }, { "normal_cycle", "ridge" }, { "normal_cycle", "bidirectional" } };
+		std::vector<std::pair<std::filesystem::path, std::filesystem::path>> cases;	// input json and ground-truth csv
+		bool is_synthetic = true;	// false when only --case is given
+		int num_samples = 100;
+		int repeats = 3;
+		std::filesystem::path report;	// json report, optional
+	};
+
+
+	double Median(std::vector<double> values)
+	{
+		if (values.empty())
+		{
+			return 0.0;
+		}
+		std::sort(values.begin(), values.end());
+		const auto n = values.size();
+		return n % 2 == 1 ? values[n / 2] : 0.5 * (values[n / 2 - 1] + values[n / 2]);
+	}
+
+
+	/**
+	 * @brief Distance from a point to a polyline
+	 * @param p point
+	 * @param polyline points of the polyline
+	 * @param is_closed true if the last point connects back to the first
+	 * @return distance, infinity for an empty polyline
+	 */
+	double DistanceToPolyline(const Eigen::RowVector3d& p, const VectorArray& polyline, bool is_closed)
+	{
+		const auto n = polyline.rows();
+		if (n == 0)
+		{
+			return std::numeric_limits<double>::infinity();
+		}
+		auto min_distance2 = (p - polyline.row(0)).squaredNorm();
+		const auto num_segments = is_closed ? n : n - 1;
+		for (Eigen::Index i = 0; i < num_segments; ++i)
+		{
+			const Eigen::RowVector3d a = polyline.row(i);
+			const Eigen::RowVector3d ab = polyline.row((i + 1) % n) - a;
+			const auto length2 = ab.squaredNorm();
+			const auto t = length2 > 0.0 ? std::clamp((p - a).dot(ab) / length2, 0.0, 1.0) : 0.0;
+			min_distance2 = std::min(min_distance2, (p - (a + t * ab)).squaredNorm());
+		}
+		return std::sqrt(min_distance2);
+	}
+
+
+	/**
+	 * @brief Symmetric Hausdorff distance between the traced line and the ground truth, measured at their points
+	 *        the points of both are dense along the lines, so the distance is not sampled any finer
+	 * @param traced traced line, open. it ends at its start when the loop is closed
+	 * @param truth ground truth, closed
+	 * @return distance
+	 */
+	double Hausdorff(const VectorArray& traced, const VectorArray& truth)
+	{
+		auto distance = 0.0;
+		for (Eigen::Index i = 0; i < traced.rows(); ++i)
+		{
+			distance = std::max(distance, DistanceToPolyline(traced.row(i), truth, true));
+		}
+		for (Eigen::Index i = 0; i < truth.rows(); ++i)
+		{
+			distance = std::max(distance, DistanceToPolyline(truth.row(i), traced, false));
+		}
+		return distance;
+	}
+
+
+	/**
+	 * @brief Reset the peak resident set of the process, linux only
+	 * @return true if it is reset and ReadPeakRssKb() measures from now on, false otherwise
+	 */
+	bool ResetPeakRss()
+	{
+		std::ofstream out("/proc/self/clear_refs");
+		out << "5";
+		out.flush();
+		return static_cast<bool>(out);
+	}
+
+
+	/**
+	 * @brief Peak resident set of the process, linux only
+	 * @return peak resident set in KiB, -1 when it is not reported
+	 */
+	long ReadPeakRssKb()
+	{
+		std::ifstream in("/proc/self/status");
+		std::string line;
+		while (std::getline(in, line))
+		{
+			if (line.rfind("VmHWM:", 0) == 0)
+			{
+				return std::stol(line.substr(6));
+			}
+		}
+		return -1;
+	}
+
+
+	/**
+	 * @brief Build the synthetic cases, a grid of resolutions, wavinesses and frequencies
+	 *        the ground truth is the exact margin sampled 4 times finer than the mesh
+	 * @param options evaluation options
+	 * @param cases [o] cases
+	 */
+	void MakeSyntheticCases(const EvalOptions& options, std::vector<EvalCase>& cases)
+	{
+		for (auto resolution : options.resolutions)
+		{
+			for (auto waviness : options.wavinesses)
+			{
+				for (auto frequency : options.frequencies)
+				{
+					SyntheticPrepParams params;
+					params.resolution = resolution;
+					params.waviness = waviness;
+					params.waviness_frequency = frequency;
+					params.phase = 0.25 * igl::PI;
+					const auto prep = MakeSyntheticPrep(params);
+
+					std::stringstream name;
+					name << "synth_r" << resolution << "_w" << waviness << "_f" << frequency;
+					EvalCase c;
+					c.name = name.str();
+					c.input.model = { c.name, c.name, ".gem", "synthetic", "", "none" };
+					c.input.operation.type = "marginline";
+					c.input.operation.marginline.type = "coordinate";
+					c.input.operation.marginline.seed = { prep.seed(0), prep.seed(1), prep.seed(2) };
+					c.input.operation.marginline.num_samples = options.num_samples;
+					c.input.operation.marginline.threshold_to_remove_last_point = 0.2;
+					c.V = prep.V;
+					c.F = prep.F;
+					c.truth = SampleSyntheticMargin(params, 4 * resolution);
+					cases.push_back(std::move(c));
+				}
+			}
+		}
+	}
+
+
+	/**
+	 * @brief Load a case from an input json, the model next to it, and a ground-truth csv (x,y,z per line, a closed polyline)
+	 * @param input_json input json
+	 * @param truth_csv ground truth
+	 * @param c [o] case
+	 * @return true if the case is loaded, false otherwise
+	 */
+	bool LoadCase(const std::filesystem::path& input_json, const std::filesystem::path& truth_csv, EvalCase& c)
+	{
+		std::ifstream ifs(input_json);
+		if (!ifs.is_open())
+		{
+			std::cout << "failed to open " << input_json.string() << "\n";
+			return false;
+		}
+		c.input = nlohmann::json::parse(ifs);
+		c.name = input_json.parent_path().filename().string();
+
+		const auto model = input_json.parent_path() / ("model" + c.input.model.type);
+		const auto is_loaded = c.input.model.type == ".gem" ? LoadGem(model, c.V, c.F, nullptr) : LoadModel(model, c.V, c.F);
+		if (!is_loaded)
+		{
+			std::cout << "failed to load " << model.string() << "\n";
+			return false;
+		}
+		if (!LoadCsv(truth_csv, c.truth) || c.truth.rows() < 2)
+		{
+			std::cout << "failed to load the ground truth " << truth_csv.string() << "\n";
+			return false;
+		}
+		return true;
+	}
+
+
+	/**
+	 * @brief Trace the margin line of a case with a variant, on a fresh engine so every run is cold
+	 *        the whole traced line is taken from the progress callback, the sampled points from the output
+	 * @param c case
+	 * @param variant variant
+	 * @return accuracy and cost
+	 */
+	RunResult RunCase(const EvalCase& c, const Variant& variant)
+	{
+		RunResult result;
+		auto input = c.input;
+		input.operation.curvature.estimator = variant.estimator;
+		input.operation.marginline.tracer = variant.tracer;
+
+		const auto has_peak_rss = ResetPeakRss();
+		std::vector<double> traced;
+		GeometryEngine engine;
+		engine.SetProgressCallback([&traced](const double* points, size_t num_points, bool is_final)
+			{
+				if (!is_final)
+				{
+					traced.insert(traced.end(), points, points + 3 * num_points);
+				}
+				return true;
+			});
+		if (engine.Initialize(input, c.V, c.F))
+		{
+			engine.Run();
+		}
+		const auto& output = engine.output();
+		result.return_code = output.return_code;
+		result.curvature_ms = output.metrics.curvature_ms;
+		result.traversal_ms = output.metrics.traversal_ms;
+		result.total_ms = output.metrics.total_ms;
+		result.arena_bytes = output.metrics.arena_bytes;
+		result.peak_rss_kb = has_peak_rss ? ReadPeakRssKb() : -1;
+		if (result.return_code != ToInt(ReturnCode::kSuccess))
+		{
+			return result;
+		}
+
+		VectorArray traced_line(static_cast<Eigen::Index>(traced.size() / 3), 3);
+		for (Eigen::Index i = 0; i < traced_line.rows(); ++i)
+		{
+			traced_line.row(i) << traced[3 * i], traced[3 * i + 1], traced[3 * i + 2];
+		}
+		result.hausdorff = Hausdorff(traced_line, c.truth);
+
+		const auto& points = output.result.marginline.points;
+		for (const auto& p : points)
+		{
+			result.mean_distance += DistanceToPolyline(Eigen::RowVector3d(p[0], p[1], p[2]), c.truth, true);
+		}
+		result.mean_distance = points.empty() ? std::numeric_limits<double>::infinity() : result.mean_distance / points.size();
+		return result;
+	}
+
+
+	/**
+	 * @brief Run all variants over all cases and print the table per case and the Pareto table per variant
+	 *        a variant is on the Pareto front when no other variant is both faster and more accurate,
+	 *        by the median total time and the median Hausdorff distance over all cases.
+	 * @param cases cases
+	 * @param options evaluation options
+	 * @return process exit code
+	 */
+	int Evaluate(const std::vector<EvalCase>& cases, const EvalOptions& options)
+	{
+		struct Summary
+		{
+			std::vector<double> total_ms, curvature_ms, traversal_ms, hausdorff, mean_distance, arena_bytes, peak_rss_kb;
+			int num_failures = 0;
+		};
+		std::vector<Summary> summaries(options.variants.size());
+		nlohmann::json report;
+
+		std::cout << std::left << std::setw(28) << "case" << std::setw(28) << "variant" << std::right
+			<< std::setw(10) << "total ms" << std::setw(12) << "hausdorff" << std::setw(12) << "mean dist" << std::setw(14) << "arena bytes" << "\n";
+		for (const auto& c : cases)
+		{
+			for (size_t k = 0; k < options.variants.size(); ++k)
+			{
+				const auto& variant = options.variants[k];
+				std::vector<RunResult> runs;
+				for (int r = 0; r < options.repeats; ++r)
+				{
+					runs.push_back(RunCase(c, variant));
+				}
+
+				// accuracy and cost are medians over the repeats: the bidirectional tracer depends on the timing of its threads,
+				// so its line may change between repeats. a variant fails when any repeat fails
+				auto run = runs.front();
+				auto& summary = summaries[k];
+				std::vector<double> total_ms, curvature_ms, traversal_ms, hausdorff, mean_distance, arena_bytes, peak_rss_kb;
+				for (const auto& r : runs)
+				{
+					if (r.return_code != ToInt(ReturnCode::kSuccess))
+					{
+						run.return_code = r.return_code;
+					}
+					total_ms.push_back(r.total_ms);
+					curvature_ms.push_back(r.curvature_ms);
+					traversal_ms.push_back(r.traversal_ms);
+					hausdorff.push_back(r.hausdorff);
+					mean_distance.push_back(r.mean_distance);
+					arena_bytes.push_back(static_cast<double>(r.arena_bytes));
+					peak_rss_kb.push_back(static_cast<double>(r.peak_rss_kb));
+				}
+				run.hausdorff = Median(hausdorff);
+				run.mean_distance = Median(mean_distance);
+				run.arena_bytes = static_cast<std::uint64_t>(Median(arena_bytes));
+				if (run.return_code != ToInt(ReturnCode::kSuccess))
+				{
+					++summary.num_failures;
+					std::cout << std::left << std::setw(28) << c.name << std::setw(28) << variant.name() << std::right
+						<< "  failed with return code " << run.return_code << "\n";
+					report["runs"].push_back({ {"case", c.name}, {"variant", variant.name()}, {"return_code", run.return_code} });
+					continue;
+				}
+				summary.total_ms.push_back(Median(total_ms));
+				summary.curvature_ms.push_back(Median(curvature_ms));
+				summary.traversal_ms.push_back(Median(traversal_ms));
+				summary.hausdorff.push_back(run.hausdorff);
+				summary.mean_distance.push_back(run.mean_distance);
+				summary.arena_bytes.push_back(static_cast<double>(run.arena_bytes));
+				summary.peak_rss_kb.push_back(Median(peak_rss_kb));
+
+				std::cout << std::left << std::setw(28) << c.name << std::setw(28) << variant.name() << std::right << std::fixed
+					<< std::setprecision(2) << std::setw(10) << Median(total_ms) << std::setprecision(4) << std::setw(12) << run.hausdorff
+					<< std::setw(12) << run.mean_distance << std::setw(14) << run.arena_bytes << "\n";
+				std::cout.unsetf(std::ios::floatfield);
+				report["runs"].push_back({
+					{"case", c.name}, {"variant", variant.name()}, {"return_code", run.return_code},
+					{"total_ms", Median(total_ms)}, {"curvature_ms", Median(curvature_ms)}, {"traversal_ms", Median(traversal_ms)},
+					{"hausdorff", run.hausdorff}, {"mean_distance", run.mean_distance},
+					{"arena_bytes", run.arena_bytes}, {"peak_rss_kb", Median(peak_rss_kb)} });
+			}
+		}
+
+		// Pareto front on the medians over the cases, failed variants are never on it
+		const auto num_variants = options.variants.size();
+		std::vector<double> latency(num_variants), error(num_variants);
+		for (size_t k = 0; k < num_variants; ++k)
+		{
+			const auto is_failed = summaries[k].num_failures > 0 || summaries[k].total_ms.empty();
+			latency[k] = is_failed ? std::numeric_limits<double>::infinity() : Median(summaries[k].total_ms);
+			error[k] = is_failed ? std::numeric_limits<double>::infinity() : Median(summaries[k].hausdorff);
+		}
+		auto is_pareto = [&](size_t k)
+			{
+				if (std::isinf(latency[k]))
+				{
+					return false;
+				}
+				for (size_t j = 0; j < num_variants; ++j)
+				{
+					if (j != k && latency[j] <= latency[k] && error[j] <= error[k] && (latency[j] < latency[k] || error[j] < error[k]))
+					{
+						return false;
+					}
+				}
+				return true;
+			};
+
+		std::cout << "\nPareto table over " << cases.size() << " cases, " << options.repeats << " runs each ('*' on the front)\n";
+		std::cout << std::left << std::setw(30) << "variant" << std::right
+			<< std::setw(10) << "total ms" << std::setw(14) << "curvature ms" << std::setw(14) << "traversal ms"
+			<< std::setw(12) << "hausdorff" << std::setw(14) << "max hausdorff" << std::setw(12) << "mean dist"
+			<< std::setw(14) << "arena bytes" << std::setw(14) << "peak rss KiB" << std::setw(10) << "failures" << "\n";
+		for (size_t k = 0; k < num_variants; ++k)
+		{
+			const auto& s = summaries[k];
+			const auto max_hausdorff = s.hausdorff.empty() ? 0.0 : *std::max_element(s.hausdorff.begin(), s.hausdorff.end());
+			const auto pareto = is_pareto(k);
+			std::cout << (pareto ? "* " : "  ") << std::left << std::setw(28) << options.variants[k].name() << std::right << std::fixed
+				<< std::setprecision(2) << std::setw(10) << Median(s.total_ms) << std::setw(14) << Median(s.curvature_ms) << std::setw(14) << Median(s.traversal_ms)
+				<< std::setprecision(4) << std::setw(12) << Median(s.hausdorff) << std::setw(14) << max_hausdorff << std::setw(12) << Median(s.mean_distance)
+				<< std::setprecision(0) << std::setw(14) << Median(s.arena_bytes) << std::setw(14) << Median(s.peak_rss_kb)
+				<< std::setw(10) << s.num_failures << "\n";
+			std::cout.unsetf(std::ios::floatfield);
+			report["variants"][options.variants[k].name()] = {
+				{"total_ms", Median(s.total_ms)}, {"curvature_ms", Median(s.curvature_ms)}, {"traversal_ms", Median(s.traversal_ms)},
+				{"hausdorff", Median(s.hausdorff)}, {"max_hausdorff", max_hausdorff}, {"mean_distance", Median(s.mean_distance)},
+				{"arena_bytes", Median(s.arena_bytes)}, {"peak_rss_kb", Median(s.peak_rss_kb)},
+				{"failures", s.num_failures}, {"pareto", pareto} };
+		}
+
+		if (!options.report.empty())
+		{
+			std::ofstream out(options.report);
+			out << report.dump(4) << "\n";
+			if (!out)
+			{
+				std::cout << "failed to save the report: " << options.report.string() << "\n";
+				return 1;
+			}
+		}
+		return 0;
+	}
+
+
+	template <typename T>
+	std::vector<T> ParseList(const std::string& text)
+	{
+		std::vector<T> values;
+		std::stringstream ss(text);
+		std::string item;
+		while (std::getline(ss, item, ','))
+		{
+			values.push_back(static_cast<T>(std::stod(item)));
+		}
+		return values;
+	}
+
+
+	void PrintUsage(const char* program)
+	{
+		std::cout << "Usage:\n"
+			<< "  " << program << " [--resolutions 64,128,256] [--waviness 0,0.5,1] [--frequencies 2,3]\n"
+			<< "      [--case <input json> <ground truth csv>]... [--no-synthetic]\n"
+			<< "      [--variants quadric/greedy,normal_cycle/ridge,...] [--samples N] [--repeats N] [--report <report json>]\n"
+			<< "variants are <curvature estimator>/<tracer>, all combinations by default.\n"
+			<< "the ground truth csv has a point x,y,z per line, a closed polyline along the margin.\n";
+	}
+}
+
+
+int main(int argc, char* argv[])
+{
+	EvalOptions options;
+	try
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			const std::string arg = argv[i];
+			if (arg == "--resolutions" && i + 1 < argc)
+			{
+				options.resolutions = ParseList<int>(argv[++i]);
+			}
+			else if (arg == "--waviness" && i + 1 < argc)
+			{
+				options.wavinesses = ParseList<double>(argv[++i]);
+			}
+			else if (arg == "--frequencies" && i + 1 < argc)
+			{
+				options.frequencies = ParseList<int>(argv[++i]);
+			}
+			else if (arg == "--case" && i + 2 < argc)
+			{
+				options.cases.emplace_back(argv[i + 1], argv[i + 2]);
+				i += 2;
+			}
+			else if (arg == "--no-synthetic")
+			{
+				options.is_synthetic = false;
+			}
+			else if (arg == "--variants" && i + 1 < argc)
+			{
+				options.variants.clear();
+				std::stringstream ss(argv[++i]);
+				std::string item;
+				while (std::getline(ss, item, ','))
+				{
+					const auto slash = item.find('/');
+					if (slash == std::string::npos)
+					{
+						std::cout << "invalid variant: " << item << " (expected: <estimator>/<tracer>)\n";
+						return 1;
+					}
+					options.variants.push_back({ item.substr(0, slash), item.substr(slash + 1) });
+				}
+			}
+			else if (arg == "--samples" && i + 1 < argc)
+			{
+				options.num_samples = std::stoi(argv[++i]);
+			}
+			else if (arg == "--repeats" && i + 1 < argc)
+			{
+				options.repeats = std::max(1, std::stoi(argv[++i]));
+			}
+			else if (arg == "--report" && i + 1 < argc)
+			{
+				options.report = argv[++i];
+			}
+			else
+			{
+				std::cout << "unknown option: " << arg << "\n";
+				PrintUsage(argv[0]);
+				return 1;
+			}
+		}
+
+		std::vector<EvalCase> cases;
+		if (options.is_synthetic)
+		{
+			MakeSyntheticCases(options, cases);
+		}
+		for (const auto& paths : options.cases)
+		{
+			EvalCase c;
+			if (!LoadCase(paths.first, paths.second, c))
+			{
+				return 1;
+			}
+			cases.push_back(std::move(c));
+		}
+		if (cases.empty() || options.variants.empty())
+		{
+			std::cout << "nothing to evaluate\n";
+			PrintUsage(argv[0]);
+			return 1;
+		}
+		return Evaluate(cases, options);
+	}
+	catch (const std::exception& e)
+	{
+		std::cout << e.what() << "\n";
+		return 1;
+	}
+}
@@ -0,0 +1,130 @@
+#include "synthetic_mesh.h"
+#include <algorithm>
+#include <cmath>
+#include <igl/PI.h>
+
+
+namespace
+{
+	/**
+	 * @brief Ring of the profile
+	 */
+	struct Ring
+	{
+		double r;	// distance from the axis
+		double z;	// height without the waves
+		double wave;	// weight of the margin waves, from 0 to 1
+	};
+
+
+	/**
+	 * @brief Add rings from a to b, excluding a
+	 * @param a first end, taken by value since it is often the last ring
+	 * @param b last end
+	 * @param spacing target distance between the rings
+	 * @param rings [o] rings
+	 */
+	void AddSegment(const Ring a, const Ring& b, double spacing, std::vector<Ring>& rings)
+	{
+		const auto length = std::hypot(b.r - a.r, b.z - a.z);
+		const auto n = std::max(2, static_cast<int>(std::ceil(length / spacing)));
+		for (int i = 1; i <= n; ++i)
+		{
+			const auto t = static_cast<double>(i) / n;
+			rings.push_back({ a.r + (b.r - a.r) * t, a.z + (b.z - a.z) * t, a.wave + (b.wave - a.wave) * t });
+		}
+	}
+
+
+	double Wave(const SyntheticPrepParams& params, double theta)
+	{
+		return params.waviness * std::sin(params.waviness_frequency * theta + params.phase);
+	}
+}
+
+
+SyntheticPrep MakeSyntheticPrep(const SyntheticPrepParams& params)
+{
+	const auto n = std::max(params.resolution, 3);
+	const auto spacing = 2.0 * igl::PI * params.radius / n;
+	const auto bevel = 0.3 * params.radius;	// radius of the rounded base
+	const auto inner = params.radius * (1.0 - params.shelf);
+
+	// profile from the bottom pole to the top pole, both excluded
+	std::vector<Ring> rings;
+	const Ring pole_bottom{ 0.0, 0.0, 0.0 };
+	AddSegment(pole_bottom, { params.radius - bevel, 0.0, 0.0 }, spacing, rings);
+	const auto num_bevel_rings = std::max(4, static_cast<int>(std::ceil(0.5 * igl::PI * bevel / spacing)));
+	for (int i = 1; i <= num_bevel_rings; ++i)
+	{
+		const auto a = 0.5 * igl::PI * i / num_bevel_rings;
+		rings.push_back({ params.radius - bevel + bevel * std::sin(a), bevel - bevel * std::cos(a), 0.0 });
+	}
+	AddSegment(rings.back(), { params.radius, params.margin_height, 1.0 }, spacing, rings);
+	const auto margin_ring = static_cast<int>(rings.size()) - 1;
+	AddSegment(rings.back(), { inner, params.margin_height, 1.0 }, spacing, rings);
+	AddSegment(rings.back(), { 0.8 * inner, params.margin_height + params.core_height, 0.0 }, spacing, rings);
+	AddSegment(rings.back(), { 0.0, params.margin_height + params.core_height, 0.0 }, spacing, rings);
+	rings.pop_back();	// the top pole is added below
+
+	SyntheticPrep prep;
+	const auto num_rings = static_cast<int>(rings.size());
+	prep.V.resize(2 + static_cast<Eigen::Index>(num_rings) * n, 3);
+	prep.V.row(0) << 0.0, 0.0, 0.0;
+	for (int k = 0; k < num_rings; ++k)
+	{
+		for (int j = 0; j < n; ++j)
+		{
+			const auto theta = 2.0 * igl::PI * j / n;
+			prep.V.row(1 + k * n + j) << rings[k].r * std::cos(theta), rings[k].r * std::sin(theta), rings[k].z + rings[k].wave * Wave(params, theta);
+		}
+	}
+	const auto top = static_cast<int>(prep.V.rows()) - 1;
+	prep.V.row(top) << 0.0, 0.0, params.margin_height + params.core_height;
+
+	// rings go around counter-clockwise seen from +z, so (along the ring) x (to the next ring) points outwards
+	auto vertex = [n](int k, int j) { return 1 + k * n + (j % n); };
+	prep.F.resize(2 * n + 2 * static_cast<Eigen::Index>(num_rings - 1) * n, 3);
+	Eigen::Index f = 0;
+	for (int j = 0; j < n; ++j)
+	{
+		prep.F.row(f++) << 0, vertex(0, j + 1), vertex(0, j);
+	}
+	for (int k = 0; k + 1 < num_rings; ++k)
+	{
+		for (int j = 0; j < n; ++j)
+		{
+			prep.F.row(f++) << vertex(k, j), vertex(k, j + 1), vertex(k + 1, j + 1);
+			prep.F.row(f++) << vertex(k, j), vertex(k + 1, j + 1), vertex(k + 1, j);
+		}
+	}
+	for (int j = 0; j < n; ++j)
+	{
+		prep.F.row(f++) << top, vertex(num_rings - 1, j), vertex(num_rings - 1, j + 1);
+	}
+
+	prep.margin_vertices.resize(n);
+	for (int j = 0; j < n; ++j)
+	{
+		prep.margin_vertices[j] = vertex(margin_ring, j);
+	}
+	prep.seed = prep.V.row(prep.margin_vertices.front());
+	return prep;
+}
+
+
+Eigen::RowVector3d SyntheticMarginPoint(const SyntheticPrepParams& params, double theta)
+{
+	return Eigen::RowVector3d(params.radius * std::cos(theta), params.radius * std::sin(theta), params.margin_height + Wave(params, theta));
+}
+
+
+PackedVectorArray SampleSyntheticMargin(const SyntheticPrepParams& params, int num_samples)
+{
+	PackedVectorArray samples(num_samples, 3);
+	for (int i = 0; i < num_samples; ++i)
+	{
+		samples.row(i) = SyntheticMarginPoint(params, 2.0 * igl::PI * i / num_samples);
+	}
+	return samples;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <vector>
+#include "type.h"
+
+
+/**
+ * @brief Shape of a synthetic preparation
+ *        a closed surface of revolution around z: a rounded base, a side wall up to the margin,
+ *        a shelf going inwards from the margin, a tapered core and a flat top.
+ *        the margin is the convex edge between the wall and the shelf, its height waves around the axis,
+ *        so the expected margin line is known exactly.
+ */
+struct SyntheticPrepParams
+{
+	int resolution = 128;	// vertices per ring around the axis
+	double radius = 5.0;	// radius of the wall, and of the margin
+	double margin_height = 4.0;	// mean height of the margin above the base
+	double core_height = 4.0;	// height of the core above the margin
+	double shelf = 0.2;	// width of the shelf relative to the radius
+	double waviness = 0.5;	// amplitude of the margin height
+	int waviness_frequency = 2;	// waves around the axis
+	double phase = 0.0;	// phase of the waves in radians
+};
+
+
+/**
+ * @brief Synthetic preparation with its known margin
+ */
+struct SyntheticPrep
+{
+	VectorArray V;
+	IndicesArray F;
+	std::vector<int> margin_vertices;	// vertices on the margin, in order around the axis
+	Eigen::RowVector3d seed;	// a point on the margin
+};
+
+
+/**
+ * @brief Build a synthetic preparation
+ *        faces are oriented outwards, the mesh is closed and manifold.
+ * @param params shape
+ * @return mesh, margin vertices and seed
+ */
+SyntheticPrep MakeSyntheticPrep(const SyntheticPrepParams& params);
+
+
+/**
+ * @brief Point of the exact margin
+ * @param params shape
+ * @param theta angle around the axis in radians
+ * @return point on the margin
+ */
+Eigen::RowVector3d SyntheticMarginPoint(const SyntheticPrepParams& params, double theta);
+
+
+/**
+ * @brief Sample the exact margin as a closed polyline
+ * @param params shape
+ * @param num_samples number of samples, evenly spaced in angle
+ * @return samples, the first one is not repeated at the end
+ */
+PackedVectorArray SampleSyntheticMargin(const SyntheticPrepParams& params, int num_samples);
@@ -4,4 +4,21 @@
 
 using ScalarArray = Eigen::VectorXd;
 using VectorArray = Eigen::MatrixXd;
-using IndicesArray = Eigen::MatrixXi;
\ No newline at end of file
+using IndicesArray = Eigen::MatrixXi;
+
+// explicit layout for hot kernels, VectorArray is column-major so each component already is a contiguous stream
+using PackedVectorArray = Eigen::Matrix<double, Eigen::Dynamic, 3, Eigen::RowMajor>;	// xyz of an element are contiguous, for random per-vertex access
+using PackedVectorView = Eigen::Ref<const PackedVectorArray>;	// read-only packed vectors, a PackedVectorArray or row-major xyz owned elsewhere, bound without a copy
+
+
+/**
+* @brief Convert a vector array to packed row-major xyz
+*        the components are interleaved, so this is a copy.
+* @param V vector array with 3 columns
+* @return packed vector array
+*/
+inline PackedVectorArray ToPacked(const VectorArray& V)
+{
+	eigen_assert(V.cols() == 3);
+	return V;
+}
@@ -0,0 +1,311 @@
+#include <algorithm>
+#include <iostream>
+#include <filesystem>
+#include <set>
+#include <string>
+#include <tuple>
+#include <igl/adjacency_list.h>
+#include <igl/avg_edge_length.h>
+#include <igl/opengl/glfw/Viewer.h>
+#include "async_writer.h"
+#include "geometry_engine.h"
+#include "return_code.h"
+#include "io_utils.h"
+#include "marginline.h"
+#include "mesh_picker.h"
+#include "smoothing.h"
+
+
+/////////////////////////////////////////////////////////////////
+// overlays
+/////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Overlay points, edges and labels accumulated in buffers that grow by doubling
+ *        they are uploaded to the viewer at most once per frame, from the pre-draw callback.
+ */
+class Overlay
+{
+	VectorArray points_;
+	VectorArray point_colors_;
+	Eigen::Index num_points_ = 0;
+
+	VectorArray edge_ends_;	// two rows per edge
+	Eigen::MatrixXi edges_;
+	VectorArray edge_colors_;
+	Eigen::Index num_edges_ = 0;
+
+	VectorArray label_positions_;
+	std::vector<std::string> labels_;
+
+	bool is_dirty_ = false;
+
+	template <typename Matrix>
+	static void Reserve(Matrix& buffer, Eigen::Index rows, Eigen::Index cols)
+	{
+		if (buffer.rows() < rows)
+		{
+			buffer.conservativeResize(std::max(rows, 2 * buffer.rows()), cols);
+		}
+	}
+
+public:
+	// room for more overlays without growing the buffers one by one
+	void ReservePoints(size_t num_points)
+	{
+		Reserve(points_, num_points_ + static_cast<Eigen::Index>(num_points), 3);
+		Reserve(point_colors_, num_points_ + static_cast<Eigen::Index>(num_points), 3);
+	}
+
+	void ReserveEdges(size_t num_edges)
+	{
+		Reserve(edge_ends_, 2 * (num_edges_ + static_cast<Eigen::Index>(num_edges)), 3);
+		Reserve(edges_, num_edges_ + static_cast<Eigen::Index>(num_edges), 2);
+		Reserve(edge_colors_, num_edges_ + static_cast<Eigen::Index>(num_edges), 3);
+	}
+
+	void ReserveLabels(size_t num_labels)
+	{
+		Reserve(label_positions_, static_cast<Eigen::Index>(labels_.size() + num_labels), 3);
+		labels_.reserve(labels_.size() + num_labels);
+	}
+
+	void AddPoint(const Eigen::RowVector3d& point, const Eigen::RowVector3d& color)
+	{
+		ReservePoints(1);
+		points_.row(num_points_) = point;
+		point_colors_.row(num_points_) = color;
+		++num_points_;
+		is_dirty_ = true;
+	}
+
+	void AddEdge(const Eigen::RowVector3d& from, const Eigen::RowVector3d& to, const Eigen::RowVector3d& color)
+	{
+		ReserveEdges(1);
+		edge_ends_.row(2 * num_edges_) = from;
+		edge_ends_.row(2 * num_edges_ + 1) = to;
+		edges_.row(num_edges_) << static_cast<int>(2 * num_edges_), static_cast<int>(2 * num_edges_ + 1);
+		edge_colors_.row(num_edges_) = color;
+		++num_edges_;
+		is_dirty_ = true;
+	}
+
+	void AddLabel(const Eigen::RowVector3d& position, std::string text)
+	{
+		const auto num_labels = static_cast<Eigen::Index>(labels_.size());
+		ReserveLabels(1);
+		label_positions_.row(num_labels) = position;
+		labels_.push_back(std::move(text));
+		is_dirty_ = true;
+	}
+
+	void ClearPoints()
+	{
+		num_points_ = 0;
+		is_dirty_ = true;
+	}
+
+	void ClearLabels()
+	{
+		labels_.clear();
+		is_dirty_ = true;
+	}
+
+	/**
+	 * @brief Upload the overlays changed since the last upload, in one batch
+	 * @param data viewer data to replace the overlays of
+	 */
+	void Upload(igl::opengl::ViewerData& data)
+	{
+		if (!is_dirty_)
+		{
+			return;
+		}
+		const auto num_labels = static_cast<Eigen::Index>(labels_.size());
+		data.set_points(points_.topRows(num_points_), point_colors_.topRows(num_points_));
+		data.set_edges(edge_ends_.topRows(2 * num_edges_), edges_.topRows(num_edges_), edge_colors_.topRows(num_edges_));
+		data.set_labels(label_positions_.topRows(num_labels), labels_);
+		is_dirty_ = false;
+	}
+};
+
+
+GeometryEngine geometry_engine;
+AsyncWriter csv_writer;	// keeps the click handler from waiting for the disk
+Overlay overlay;	// uploaded once per frame, clicks only append to it
+
+
+/////////////////////////////////////////////////////////////////
+// hydration
+/////////////////////////////////////////////////////////////////
+
+void HydrateSelectionWithCurvature(
+	igl::opengl::glfw::Viewer& viewer,
+	VectorArray& V,
+	const PackedVectorArray& packed_V,
+	IndicesArray& F,
+	std::vector<std::vector<int>>& adjacency_list,
+	const CurvatureView& curvature)
+{
+	// how to change thickness of edges as overlays: https://github.com/libigl/libigl/issues/1270
+	static const Eigen::RowVector3d SELECTED_EDGE_COLOR(0, 0, 0);
+	static const Eigen::RowVector3d SELECTED_VERTEX_COLOR(1, 0, 0);
+	static const Eigen::RowVector3d CURVATURE_EDGE_COLOR(1, 1, 0);
+
+	viewer.callback_mouse_up = [&V, &packed_V, &F, &adjacency_list, curvature](igl::opengl::glfw::Viewer& viewer, int, int) -> bool
+		{
+			// picking goes through the tree of the engine, built once for the mesh
+			PickHit hit;
+			auto x = static_cast<float>(viewer.current_mouse_x);
+			auto y = static_cast<float>(viewer.core().viewport(3) - viewer.current_mouse_y);
+			if (geometry_engine.picker().Pick(
+				Eigen::Vector2f(x, y),
+				viewer.core().view,
+				viewer.core().proj,
+				viewer.core().viewport,
+				hit))
+			{
+				// showing clicked face
+				const auto fid = hit.face;
+				overlay.AddEdge(V.row(F(fid, 0)), V.row(F(fid, 1)), SELECTED_EDGE_COLOR);
+				overlay.AddEdge(V.row(F(fid, 1)), V.row(F(fid, 2)), SELECTED_EDGE_COLOR);
+				overlay.AddEdge(V.row(F(fid, 2)), V.row(F(fid, 0)), SELECTED_EDGE_COLOR);
+
+				// get closest vertex from clicking point
+				const auto closest_vertex_index = hit.vertex;
+				overlay.AddPoint(V.row(closest_vertex_index), SELECTED_VERTEX_COLOR);
+
+				std::cout << "clicked vertex index: " << geometry_engine.original_vertex_indices()[closest_vertex_index] << "\n";
+				std::cout << "  coordinate: " << V.row(closest_vertex_index) << "\n";
+
+				std::vector<int> marginline{ static_cast<int>(closest_vertex_index) };
+				std::pmr::set<int> visited;
+				CreateMarginline(packed_V, F, adjacency_list, curvature, marginline, visited);
+				if (marginline.size() > 1)
+				{
+					for (auto& vertex_index : marginline)
+					{
+						visited.erase(vertex_index);
+					}
+					overlay.ReservePoints(marginline.size() + visited.size());
+					overlay.ReserveLabels(marginline.size());
+
+					for (size_t i = 0; i < marginline.size(); ++i)
+					{
+						overlay.AddLabel(V.row(marginline[i]), std::to_string(i));
+						overlay.AddPoint(V.row(marginline[i]), Eigen::RowVector3d(0, 0, 1));
+					}
+					for (auto vertex_index : visited)
+					{
+						overlay.AddPoint(V.row(vertex_index), Eigen::RowVector3d(0, 1, 0));
+					}
+
+					VectorArray polyline(marginline.size(), 3);
+					for (size_t i = 0; i < marginline.size(); ++i)
+					{
+						polyline.row(i) = V.row(marginline[i]);
+					}
+					csv_writer.Enqueue("polyline.csv", [polyline]() { return SaveCsv("polyline.csv", polyline); });
+					csv_writer.Enqueue("polyline_smoothed.csv", [smoothed = ChaikinSmoothing(V, marginline, 5)]() { return SaveCsv("polyline_smoothed.csv", smoothed); });
+					csv_writer.Enqueue("polyline_smoothed2.csv", [smoothed = ChaikinSmoothing2(V, marginline, 5)]() { return SaveCsv("polyline_smoothed2.csv", smoothed); });
+				}
+
+				return true;
+			}
+			return false;
+		};
+
+	viewer.callback_key_up = [](igl::opengl::glfw::Viewer& viewer, unsigned char key, int modifier) -> bool
+		{
+			if (key == 'r' || key == 'R')
+			{
+				overlay.ClearPoints();
+				overlay.ClearLabels();
+			}
+			return false;
+		};
+
+	viewer.callback_pre_draw = [](igl::opengl::glfw::Viewer& viewer) -> bool
+		{
+			overlay.Upload(viewer.data());
+			return false;
+		};
+}
+
+
+
+/////////////////////////////////////////////////////////////////
+// main function
+/////////////////////////////////////////////////////////////////
+
+int main(int argc, char *argv[])
+{
+	if (argc < 2)
+	{
+		std::cout << "Usage: " << argv[0] << " <input json path>\n";
+		return 1;
+	}
+
+	if (!geometry_engine.Initialize(argv[1]))
+	{
+		std::cout << "failed to initialize the geometry engine\n";
+		std::cout << "input.json path: " << argv[1] << "\n";
+		return static_cast<int>(geometry_engine.output().return_code);
+	}
+
+	auto& V = geometry_engine.V();
+	auto& packed_V = geometry_engine.packed_V();
+	auto& N = geometry_engine.N();
+	auto& F = geometry_engine.F();
+	auto& adjacency_list = geometry_engine.adjacency_list();
+	VectorArray C;
+
+	auto output = geometry_engine.Run();
+	if (output.return_code != ToInt(ReturnCode::kSuccess))
+	{
+		std::cout << "failed to run the geometry engine\n";
+		std::cout << output.message << "\n";
+		return static_cast<int>(geometry_engine.output().return_code);
+	}
+
+	// read through the view, curvature_info() is empty while the curvature is mapped from curvature.output
+	const auto curvature = geometry_engine.curvature();
+	ScalarArray mean(curvature.size());
+	for (Eigen::Index i = 0; i < mean.size(); ++i)
+	{
+		mean(i) = curvature.mean(static_cast<int>(i));
+	}
+
+	// curvature direction display
+	// Average edge length for sizing
+	const double avg = igl::avg_edge_length(V, F);
+	const Eigen::RowVector3d red(0.8, 0.2, 0.2), blue(0.2, 0.2, 0.8), white(1.0, 1.0, 1.0);
+
+	// Plot the mesh
+	igl::opengl::glfw::Viewer viewer;
+	viewer.data().set_mesh(V, F);
+	viewer.data().set_data(mean, -0.1, 0.1, igl::COLOR_MAP_TYPE_JET);
+	// viewer.data().set_data(info.mean);
+	viewer.data().set_face_based(true);
+	viewer.data().show_lines = false;
+
+	// principal directions of a subset of vertices on large scans, added to the overlay in one reservation
+	static const Eigen::Index MAX_DIRECTION_EDGES = 100000;
+	const auto stride = std::max<Eigen::Index>(1, (V.rows() + MAX_DIRECTION_EDGES - 1) / MAX_DIRECTION_EDGES);
+	overlay.ReserveEdges(static_cast<size_t>((V.rows() + stride - 1) / stride));
+	for (Eigen::Index i = 0; i < V.rows(); i += stride)
+	{
+		const Eigen::RowVector3d direction = curvature.principal_direction2(static_cast<int>(i)) * avg;
+		overlay.AddEdge(V.row(i) + direction, V.row(i) - direction, white);
+	}
+
+	// hydration
+	HydrateSelectionWithCurvature(viewer, V, packed_V, F, adjacency_list, curvature);
+
+	// give white color to the background
+	// viewer.core().background_color.setOnes();
+	
+	viewer.launch();
+
+	return 0;
+}